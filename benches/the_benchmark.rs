@@ -40,12 +40,26 @@ const FILES: [&str; 12] = [
     "Sony/ILCE-7RM4/DSC00395.ARW",
 ];
 
-use criterion::{criterion_group, criterion_main, Criterion};
-use libopenraw::{rawfile_from_file, LJpeg};
+use criterion::{criterion_group, criterion_main, BatchSize, Criterion};
+use libopenraw::{demosaic_bench, rawfile_from_file, LJpeg};
+
+/// The sample files root from `RAWFILES_ROOT`. The benchmarks using
+/// them are skipped if it isn't set.
+fn dataset() -> Option<std::path::PathBuf> {
+    match std::env::var("RAWFILES_ROOT") {
+        Ok(dataset) => Some(std::path::PathBuf::from(dataset)),
+        Err(_) => {
+            eprintln!("RAWFILES_ROOT not set, skipping");
+            None
+        }
+    }
+}
 
 pub fn ordiag_benchmark(c: &mut Criterion) {
-    let dataset = std::env::var("RAWFILES_ROOT").expect("RAWFILES_ROOT not set");
-    let dataset = std::path::PathBuf::from(dataset);
+    let dataset = match dataset() {
+        Some(dataset) => dataset,
+        None => return,
+    };
     for file in FILES {
         let bench_name = format!("ordiag-{file}");
         let file = dataset.join(file);
@@ -66,8 +80,10 @@ pub fn ordiag_benchmark(c: &mut Criterion) {
 }
 
 pub fn dump_benchmark(c: &mut Criterion) {
-    let dataset = std::env::var("RAWFILES_ROOT").expect("RAWFILES_ROOT not set");
-    let dataset = std::path::PathBuf::from(dataset);
+    let dataset = match dataset() {
+        Some(dataset) => dataset,
+        None => return,
+    };
     for file in FILES {
         let bench_name = format!("dump-{file}");
         let file = dataset.join(file);
@@ -92,5 +108,57 @@ fn ljpeg_benchmark(c: &mut Criterion) {
     });
 }
 
+/// Synthetic CFA data, `width` x `height`.
+fn synthetic_cfa(width: u32, height: u32) -> Vec<f32> {
+    (0..width * height)
+        .map(|v| (v.wrapping_mul(7919) % 4096) as f32 / 4095.0)
+        .collect()
+}
+
+fn demosaic_benchmark(c: &mut Criterion) {
+    let mut group = c.benchmark_group("bimedian");
+    group.sample_size(10);
+    for (name, width, height) in [("24MP", 6000, 4000), ("60MP", 9504, 6336)] {
+        let cfa = synthetic_cfa(width, height);
+        group.bench_function(format!("reference-{name}"), |b| {
+            b.iter_batched(
+                || cfa.clone(),
+                |cfa| demosaic_bench::bimedian_reference(cfa, width, height),
+                BatchSize::LargeInput,
+            )
+        });
+        group.bench_function(format!("parallel-{name}"), |b| {
+            b.iter_batched(
+                || cfa.clone(),
+                |cfa| demosaic_bench::bimedian(cfa, width, height),
+                BatchSize::LargeInput,
+            )
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("demosaic");
+    group.sample_size(10);
+    let (width, height) = (6000, 4000);
+    let cfa = synthetic_cfa(width, height);
+    group.bench_function("bimedian-24MP", |b| {
+        b.iter_batched(
+            || cfa.clone(),
+            |cfa| demosaic_bench::bimedian(cfa, width, height),
+            BatchSize::LargeInput,
+        )
+    });
+    group.bench_function("ppg-24MP", |b| {
+        b.iter_batched(
+            || cfa.clone(),
+            |cfa| demosaic_bench::ppg(cfa, width, height),
+            BatchSize::LargeInput,
+        )
+    });
+    group.finish();
+}
+
 criterion_group!(benches, ordiag_benchmark, dump_benchmark, ljpeg_benchmark);
-criterion_main!(benches);
+// The synthetic data benchmarks, that don't need `RAWFILES_ROOT`.
+criterion_group!(synthetic, demosaic_benchmark);
+criterion_main!(synthetic, benches);
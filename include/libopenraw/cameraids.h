@@ -130,7 +130,7 @@ enum _OR_TYPEID_VENDOR_CANON {
     OR_TYPEID_CANON_KISS_F = OR_TYPEID_CANON_1000D,
     OR_TYPEID_CANON_G10 = 35,
     OR_TYPEID_CANON_50D = 36,
-    OR_TYPEID_CANON_60D = 36,
+    OR_TYPEID_CANON_60D = 124,
     OR_TYPEID_CANON_S90 = 37,
     OR_TYPEID_CANON_G12 = 38,
     OR_TYPEID_CANON_S95 = 39,
@@ -937,7 +937,7 @@ enum _OR_TYPEID_VENDOR_HASSELBLAD {
     OR_TYPEID_HASSELBLAD_UNKNOWN = 0,
     OR_TYPEID_HASSELBLAD_LUNAR = 1,
     OR_TYPEID_HASSELBLAD_L1D_20C = 2,
-    OR_TYPEID_HASSELBLAD_L2D_20C = 2,
+    OR_TYPEID_HASSELBLAD_L2D_20C = 3,
 
     _OR_TYPEID_HASSELBLAD_LAST
 };
@@ -86,6 +86,9 @@ typedef enum {
     OR_DATA_TYPE_PNG = 5,            /**< PNG container */
     OR_DATA_TYPE_RAW = 6,            /**< RAW container */
     OR_DATA_TYPE_COMPRESSED_RAW = 7, /**< compressed RAW container */
+    OR_DATA_TYPE_PIXMAP_8RGBA = 8,   /**< 8bit per channel RGBA pixmap */
+    OR_DATA_TYPE_PIXMAP_PLANAR_F32 = 9, /**< 32bit float per channel planar RGB pixmap */
+    OR_DATA_TYPE_RAW_PLANES = 10,    /**< RAW data in 4 planes R, G1, G2, B */
 
     OR_DATA_TYPE_UNKNOWN = 100,
 } or_data_type;
@@ -111,10 +114,58 @@ typedef enum {
 /** @brief Options */
 typedef enum {
     OR_OPTIONS_NONE = 0x00000000, /**< No options */
-    OR_OPTIONS_DONT_DECOMPRESS = 0x00000001 /**< Don't decompress */
+    OR_OPTIONS_DONT_DECOMPRESS = 0x00000001, /**< Don't decompress */
+    OR_OPTIONS_PLANAR = 0x00000002 /**< Reorder the bayer CFA in 4 planes
+                                    * R, G1, G2 and B. */
 
 } or_options;
 
+/** @brief Rendering options.
+ * Combine one value of each group, the _MASK value selects the
+ * group. The target colour space must be set to render the colour
+ * stage.
+ */
+typedef enum {
+    OR_RENDERING_TARGET_CS_MASK = 0x0000000f, /**< Target colour space */
+    OR_RENDERING_TARGET_CAMERA_CS = 0x00000001, /**< Camera colour space */
+    OR_RENDERING_TARGET_XYZ_CS = 0x00000002, /**< XYZ */
+    OR_RENDERING_TARGET_SRGB_CS = 0x00000003, /**< sRGB */
+    OR_RENDERING_TARGET_LINEAR_SRGB_CS = 0x00000004, /**< Linear sRGB */
+    OR_RENDERING_TARGET_DISPLAY_P3_CS = 0x00000005, /**< Display P3 */
+    OR_RENDERING_TARGET_REC2020_CS = 0x00000006, /**< Linear Rec.2020 */
+    OR_RENDERING_TARGET_PROPHOTO_CS = 0x00000007, /**< ProPhoto RGB */
+
+    OR_RENDERING_STAGE_MASK = 0x00000030, /**< Rendering stage */
+    OR_RENDERING_STAGE_RAW = 0x00000000, /**< Raw data */
+    OR_RENDERING_STAGE_LINEAR = 0x00000010, /**< Linearized */
+    OR_RENDERING_STAGE_INTERP = 0x00000020, /**< Interpolated (demosaic) */
+    OR_RENDERING_STAGE_COLOUR = 0x00000030, /**< Colour corrected */
+
+    OR_RENDERING_DEMOSAIC_MASK = 0x000000c0, /**< Demosaic method */
+    OR_RENDERING_DEMOSAIC_BIMEDIAN = 0x00000000, /**< Bimedian, fast */
+    OR_RENDERING_DEMOSAIC_PPG = 0x00000040, /**< PPG, edge directed */
+
+    OR_RENDERING_SCALE_MASK = 0x00000300, /**< Scale */
+    OR_RENDERING_SCALE_FULL = 0x00000000, /**< Full size */
+    OR_RENDERING_SCALE_HALF = 0x00000100, /**< Half size */
+    OR_RENDERING_SCALE_QUARTER = 0x00000200, /**< Quarter size */
+    OR_RENDERING_SCALE_EIGHTH = 0x00000300, /**< Eighth size */
+
+    OR_RENDERING_CROP_MASK = 0x00000c00, /**< Crop */
+    OR_RENDERING_CROP_NONE = 0x00000000, /**< No crop */
+    OR_RENDERING_CROP_ACTIVE_AREA = 0x00000400, /**< Sensor active area */
+    OR_RENDERING_CROP_USER_CROP = 0x00000800, /**< User crop */
+
+    OR_RENDERING_FORMAT_MASK = 0x00003000, /**< Output pixel format */
+    OR_RENDERING_FORMAT_RGB16 = 0x00000000, /**< RGB 16 bits */
+    OR_RENDERING_FORMAT_RGB8 = 0x00001000, /**< RGB 8 bits */
+    OR_RENDERING_FORMAT_RGBA8 = 0x00002000, /**< RGBA 8 bits, opaque */
+    OR_RENDERING_FORMAT_PLANAR_F32 = 0x00003000, /**< Planar float RGB */
+
+    /** sRGB, interpolated. */
+    OR_RENDERING_OPTIONS_DEFAULT = OR_RENDERING_TARGET_SRGB_CS | OR_RENDERING_STAGE_INTERP,
+} or_rendering_options;
+
 /** @brief Where the colour matrix comes from.
  * Typically DNG is provided. The others are built-in.
  */
@@ -124,6 +175,12 @@ typedef enum {
     OR_COLOUR_MATRIX_PROVIDED = 2, /**< Colour matrix provided by file */
 } or_colour_matrix_origin;
 
+/** @brief How to bin the raw data. See or_rawdata_bin() */
+typedef enum {
+    OR_BINNING_CFA = 0, /**< Half size CFA, each colour averaged */
+    OR_BINNING_PLANES = 1, /**< Half size planes R, G1, G2, B */
+} or_binning;
+
 /** @brief This is the type ID, a combination of vendor model
  *  It maps a specific camera. Only for the NATIVE file format.
  */
@@ -61,6 +61,18 @@ extern "C" {
 	 */
 	void* or_rawdata_data(ORRawDataRef rawdata);
 
+	/** @brief Get a plane of planar RAW data
+	 *
+	 * The data must be %OR_DATA_TYPE_RAW_PLANES, see %OR_OPTIONS_PLANAR.
+	 * The pointer is owned by the RawData object.
+	 * @param rawdata The RawData.
+	 * @param index The plane: 0 to 3 for R, G1, G2 and B.
+	 * @param [out] size The number of samples in the plane.
+	 * @return The plane, or %NULL if the data isn't planar.
+	 */
+	const uint16_t* or_rawdata_plane(ORRawDataRef rawdata, uint32_t index,
+																	 size_t* size);
+
 	/** @brief Get the size of the RAW data in bytes */
 	size_t or_rawdata_data_size(ORRawDataRef rawdata);
 
@@ -213,7 +225,8 @@ extern "C" {
 	/** @brief Get the rendered image from the raw data
 	 * @param rawdata the raw data.
 	 * @param bitmapdata the preallocated bitmap data.
-	 * @param options option for rendering. Pass 0 for now.
+	 * @param options option for rendering, a combination of
+	 * %or_rendering_options.
 	 * @return an error code, %OR_ERROR_NONE in case of success.
 	 */
 	or_error
@@ -221,6 +234,106 @@ extern "C" {
 				      ORBitmapDataRef bitmapdata,
 				      uint32_t options);
 
+	/** @brief Get the rendered image of a region of the raw data
+	 * @param rawdata the raw data.
+	 * @param options option for rendering, a combination of
+	 * %or_rendering_options.
+	 * @param x, y, width, height the region, in raw pixel coordinates.
+	 * @param [out] error an error code. Pass NULL if not desired.
+	 * @return the rendered bitmap, or NULL in case of error.
+	 */
+	ORBitmapDataRef
+	or_rawdata_get_rendered_image_region(ORRawDataRef rawdata,
+					     uint32_t options,
+					     uint32_t x, uint32_t y,
+					     uint32_t width, uint32_t height,
+					     or_error *error);
+
+	/** @brief Render the raw data into a caller buffer.
+	 *
+	 * Call with a NULL buffer to get the size needed in required.
+	 * @param rawdata the raw data.
+	 * @param options option for rendering, a combination of
+	 * %or_rendering_options.
+	 * @param buffer the output buffer, aligned for the samples.
+	 * @param stride the distance between rows, in bytes. 0 if packed.
+	 * @param capacity the size of buffer, in bytes.
+	 * @param [out] width, height the rendered dimensions. Can be NULL.
+	 * @param [out] required the size needed, in bytes. Can be NULL.
+	 * @return an error code. %OR_ERROR_BUF_TOO_SMALL if buffer is NULL
+	 * or too small.
+	 */
+	or_error
+	or_rawdata_get_rendered_image_into(ORRawDataRef rawdata,
+					   uint32_t options,
+					   void *buffer, size_t stride,
+					   size_t capacity,
+					   uint32_t *width, uint32_t *height,
+					   size_t *required);
+
+	/** @brief Bin the raw data by half, the black subtracted.
+	 *
+	 * With %OR_BINNING_PLANES the data type is
+	 * %OR_DATA_TYPE_RAW_PLANES: the planes R, G1, G2 and B are one after
+	 * the other.
+	 * @param rawdata the raw data, a 2x2 bayer CFA.
+	 * @param binning an or_binning value.
+	 * @param [out] error an error code. Pass NULL if not desired.
+	 * @return the new raw data, to be released, or NULL in case of
+	 * error.
+	 */
+	ORRawDataRef
+	or_rawdata_bin(ORRawDataRef rawdata, uint32_t binning, or_error *error);
+
+	/** @brief Compute the statistics of the raw data, per CFA channel.
+	 *
+	 * For a 2x2 bayer CFA the channels are the positions, in row
+	 * order, like the levels. For other CFA they are the colours R, G
+	 * and B.
+	 * @param rawdata the raw data.
+	 * @param [out] error an error code. Pass NULL if not desired.
+	 * @return the statistics, to be released with
+	 * or_rawstatistics_release(), or NULL in case of error.
+	 */
+	ORRawStatisticsRef
+	or_rawdata_get_statistics(ORRawDataRef rawdata, or_error *error);
+
+	/** @brief Release the statistics. */
+	or_error
+	or_rawstatistics_release(ORRawStatisticsRef stats);
+
+	/** @brief The number of channels of the statistics. */
+	uint32_t
+	or_rawstatistics_channel_count(ORRawStatisticsRef stats);
+
+	/** @brief Get the statistics of a channel.
+	 *
+	 * The values are as stored, before linearization.
+	 * @param stats the statistics.
+	 * @param channel the channel index.
+	 * @param [out] min, max the minimum and maximum values.
+	 * @param [out] mean the mean value.
+	 * @param [out] clipped the count of values at or above the white.
+	 * @param [out] below_black the count of values below the black.
+	 * Any of the out parameters can be NULL.
+	 * @return an error code. %OR_ERROR_INVALID_PARAM if there is no
+	 * such channel.
+	 */
+	or_error
+	or_rawstatistics_get_channel(ORRawStatisticsRef stats, uint32_t channel,
+				     uint16_t *min, uint16_t *max, double *mean,
+				     uint64_t *clipped, uint64_t *below_black);
+
+	/** @brief Get the histogram of a channel.
+	 * @param stats the statistics.
+	 * @param channel the channel index.
+	 * @param [out] size the number of bins.
+	 * @return the histogram, owned by stats, or NULL.
+	 */
+	const uint32_t *
+	or_rawstatistics_get_histogram(ORRawStatisticsRef stats, uint32_t channel,
+				       size_t *size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -128,22 +128,117 @@ or_rawfile_get_thumbnail(ORRawFileRef rawfile, uint32_t preferred_size, or_error
  *
  * @param rawfile The RawFile.
  * @param options Some options. Pass %OR_OPTIONS_DONT_DECOMPRESS if
- * you don't want the RAW data stream to be decompressed, %OR_OPTIONS_NONE otherwise.
+ * you don't want the RAW data stream to be decompressed, %OR_OPTIONS_PLANAR
+ * to get the data as 4 planes %OR_DATA_TYPE_RAW_PLANES, %OR_OPTIONS_NONE otherwise.
  * @param error The error code. Pass %nullptr if not desired.
  * @return An %ORRawDataRef or %nullptr in case of error.
  */
 ORRawDataRef
 or_rawfile_get_rawdata(ORRawFileRef rawfile, uint32_t options, or_error *error);
 
+/** @brief Get the RAW data into a caller buffer.
+ *
+ * Call with a %nullptr buffer to get the size needed in required. It
+ * needs the raw data to be decoded: it is kept in rawfile until the
+ * next call, so that filling the buffer doesn't decode it again.
+ * @param rawfile The RawFile.
+ * @param buffer The output buffer for the 16-bit samples.
+ * @param stride The distance between rows, in samples. 0 if packed.
+ * @param capacity The size of buffer, in samples.
+ * @param [out] required The size needed, in samples. Can be %nullptr.
+ * @param error The error code. %OR_ERROR_BUF_TOO_SMALL if buffer is
+ * %nullptr or too small. Pass %nullptr if not desired.
+ * @return An %ORRawDataRef with the metadata only, or %nullptr in case
+ * of error.
+ */
+ORRawDataRef
+or_rawfile_get_rawdata_into(ORRawFileRef rawfile, uint16_t *buffer,
+                            size_t stride, size_t capacity,
+                            size_t *required, or_error *error);
+
+/** @brief The callback for or_rawfile_decode_rows().
+ *
+ * @param y The first row of the band.
+ * @param height The number of rows in the band.
+ * @param row_len The number of samples in a row.
+ * @param data The 16-bit samples, only valid during the call.
+ * @param user_data The user data passed to or_rawfile_decode_rows().
+ * @return 0 (%OR_ERROR_NONE) to continue, any other value to stop. It
+ * is returned as is in the error of or_rawfile_decode_rows().
+ */
+typedef int (*or_rows_callback)(uint32_t y, uint32_t height,
+                                size_t row_len, const uint16_t *data,
+                                void *user_data);
+
+/** @brief Decode the RAW data in bands of rows.
+ *
+ * The bands are passed to callback in order, in a buffer that is
+ * reused. Sequential decoders never hold the whole data.
+ * @param rawfile The RawFile.
+ * @param band_rows The number of rows in a band.
+ * @param callback The callback to get the bands.
+ * @param user_data The data passed to callback.
+ * @param error The error code. %OR_ERROR_INVALID_PARAM if callback is
+ * %nullptr, or the value returned by callback, unchanged. Pass %nullptr if not
+ * desired.
+ * @return An %ORRawDataRef with the metadata only, or %nullptr in case
+ * of error.
+ */
+ORRawDataRef
+or_rawfile_decode_rows(ORRawFileRef rawfile, uint32_t band_rows,
+                       or_rows_callback callback, void *user_data,
+                       or_error *error);
+
 /** @brief Get the rendered image from the raw file
  * @param rawfile The raw file.
- * @param options Option for rendering. Pass %OR_OPTIONS_NONE for now.
+ * @param options Option for rendering, a combination of
+ * %or_rendering_options.
  * @param [out] error An error code. %OR_ERROR_NOTAREF is %rawfile is NULL.
  * @return The rendered bitmap %ORBitmapDataRef
  */
 ORBitmapDataRef
 or_rawfile_get_rendered_image(ORRawFileRef rawfile, uint32_t options, or_error *error);
 
+/** @brief Get the rendered image of a region of the raw file
+ *
+ * Only the raw data needed for the region is decoded, if the format
+ * allows it.
+ * @param rawfile The raw file.
+ * @param options Option for rendering, a combination of
+ * %or_rendering_options.
+ * @param x, y, width, height The region, in raw pixel coordinates.
+ * @param [out] error An error code. %OR_ERROR_NOTAREF is %rawfile is NULL.
+ * @return The rendered bitmap %ORBitmapDataRef
+ */
+ORBitmapDataRef
+or_rawfile_get_rendered_image_region(ORRawFileRef rawfile, uint32_t options,
+                                     uint32_t x, uint32_t y,
+                                     uint32_t width, uint32_t height,
+                                     or_error *error);
+
+/** @brief Render the image from the raw file into a caller buffer.
+ *
+ * Call with a %nullptr buffer to get the size needed in required. It
+ * needs the raw data to be decoded: it is kept in rawfile until the
+ * next call, so that filling the buffer doesn't decode it again.
+ * @param rawfile The raw file.
+ * @param options Option for rendering, a combination of
+ * %or_rendering_options.
+ * @param buffer The output buffer, aligned for the samples.
+ * @param stride The distance between rows, in bytes. 0 if packed.
+ * @param capacity The size of buffer, in bytes.
+ * @param [out] width, height The rendered dimensions. Can be %nullptr.
+ * @param [out] required The size needed, in bytes. Can be %nullptr.
+ * @return An error code. %OR_ERROR_BUF_TOO_SMALL if buffer is %nullptr
+ * or too small.
+ */
+or_error
+or_rawfile_get_rendered_image_into(ORRawFileRef rawfile, uint32_t options,
+                                   void *buffer, size_t stride,
+                                   size_t capacity,
+                                   uint32_t *width, uint32_t *height,
+                                   size_t *required);
+
 
 /** @brief Get the orientation.
  *
@@ -32,6 +32,7 @@ typedef struct _RawData *ORRawDataRef; /**< @brief RawData reference */
 typedef struct _BitmapData *ORBitmapDataRef; /**< @brief BitmapData reference */
 typedef struct _Thumbnail *ORThumbnailRef; /**< @brief Thumbnail reference */
 typedef struct _IfdDir *ORIfdDirRef; /**< @brief IfdDir reference */
+typedef struct _RawStatistics *ORRawStatisticsRef; /**< @brief Raw data statistics reference */
 
 /** @} */
 
@@ -0,0 +1,232 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * libopenraw - binning.rs
+ *
+ * Copyright (C) 2025 Hubert Figuière
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+//! Raw domain 2x2 binning and decimation of a bayer CFA, for fast
+//! previews and analysis at a lower resolution.
+
+use num_enum::TryFromPrimitive;
+use rayon::prelude::*;
+
+use crate::mosaic::{Pattern, PatternColour};
+use crate::{Error, Result};
+
+#[repr(u32)]
+#[derive(Copy, Clone, Debug, Default, Eq, PartialEq, TryFromPrimitive)]
+/// How to downsample the raw data.
+pub enum Binning {
+    #[default]
+    /// Average each colour of a 4x4 block into a 2x2 CFA with the same
+    /// pattern, half the size.
+    Cfa = 0,
+    /// One value per CFA quad, in 4 planes R, G1, G2 and B, half the
+    /// size. G1 is the green on the red rows.
+    Planes = 1,
+}
+
+/// The levels to bin with.
+pub(crate) struct Levels<'a> {
+    /// The black per position of the 2x2 CFA, in row order.
+    pub blacks: [u16; 4],
+    /// The linearization table, applied before the black is
+    /// subtracted.
+    pub table: Option<&'a [u16]>,
+}
+
+impl Levels<'_> {
+    /// The value `v` at the CFA position `x`, `y` with the black
+    /// subtracted.
+    #[inline]
+    fn apply(&self, v: u16, x: usize, y: usize) -> u16 {
+        let v = match self.table {
+            Some(table) if !table.is_empty() => table[std::cmp::min(v as usize, table.len() - 1)],
+            _ => v,
+        };
+        v.saturating_sub(self.blacks[(y % 2) * 2 + x % 2])
+    }
+}
+
+/// The offset in the CFA quad of R, G1, G2 and B for the 2x2 bayer
+/// `pattern`.
+pub(crate) fn plane_offsets(pattern: &Pattern) -> Result<[(usize, usize); 4]> {
+    let find = |colour| {
+        (0..4)
+            .map(|i| (i % 2, i / 2))
+            .find(|(x, y)| pattern[(*x, *y)] == colour)
+    };
+    if pattern.width() != 2 || pattern.height() != 2 {
+        log::error!("Can't bin pattern {pattern:?}");
+        return Err(Error::InvalidFormat);
+    }
+    match (find(PatternColour::Red), find(PatternColour::Blue)) {
+        (Some((rx, ry)), Some((bx, by))) if rx != bx && ry != by => {
+            Ok([(rx, ry), (bx, ry), (rx, by), (bx, by)])
+        }
+        _ => {
+            log::error!("Can't bin pattern {pattern:?}");
+            Err(Error::InvalidFormat)
+        }
+    }
+}
+
+/// Bin the CFA `src`, `width` x `height`: each colour of a 4x4 block
+/// is averaged into a 2x2 CFA with the same pattern. Return the data
+/// and its dimensions.
+pub(crate) fn bin_cfa(
+    src: &[u16],
+    width: usize,
+    height: usize,
+    levels: &Levels,
+) -> (Vec<u16>, usize, usize) {
+    let out_w = width / 4 * 2;
+    let out_h = height / 4 * 2;
+    if out_w == 0 || out_h == 0 || src.len() < width * height {
+        return (vec![], 0, 0);
+    }
+    let mut out: Vec<u16> = uninit_vec!(out_w * out_h);
+    out.par_chunks_mut(out_w).enumerate().for_each(|(oy, row)| {
+        // The two input rows of this colour.
+        let y = oy / 2 * 4 + oy % 2;
+        let rows = [&src[y * width..], &src[(y + 2) * width..]];
+        for (ox, v) in row.iter_mut().enumerate() {
+            let x = ox / 2 * 4 + ox % 2;
+            let sum: u32 = rows
+                .iter()
+                .map(|r| levels.apply(r[x], x, y) as u32 + levels.apply(r[x + 2], x, y) as u32)
+                .sum();
+            *v = ((sum + 2) / 4) as u16;
+        }
+    });
+
+    (out, out_w, out_h)
+}
+
+/// Decimate the CFA `src`, `width` x `height`, into 4 planes R, G1, G2
+/// and B, one value per CFA quad. `offsets` are from
+/// `plane_offsets()`. Return the data, the planes one after the
+/// other, and the dimensions of a plane.
+pub(crate) fn bin_planes(
+    src: &[u16],
+    width: usize,
+    height: usize,
+    offsets: &[(usize, usize); 4],
+    levels: &Levels,
+) -> (Vec<u16>, usize, usize) {
+    let out_w = width / 2;
+    let out_h = height / 2;
+    if out_w == 0 || out_h == 0 || src.len() < width * height {
+        return (vec![], 0, 0);
+    }
+    let mut out: Vec<u16> = uninit_vec!(out_w * out_h * 4);
+    out.par_chunks_mut(out_w * out_h)
+        .zip(offsets.par_iter())
+        .for_each(|(plane, (dx, dy))| {
+            plane
+                .par_chunks_mut(out_w)
+                .enumerate()
+                .for_each(|(oy, row)| {
+                    let y = oy * 2 + dy;
+                    let src_row = &src[y * width..(y + 1) * width];
+                    for (v, s) in row.iter_mut().zip(src_row[*dx..].iter().step_by(2)) {
+                        *v = levels.apply(*s, *dx, y);
+                    }
+                });
+        });
+
+    (out, out_w, out_h)
+}
+
+#[cfg(test)]
+mod test {
+    use super::{bin_cfa, bin_planes, plane_offsets, Levels};
+    use crate::mosaic::Pattern;
+
+    #[test]
+    fn test_plane_offsets() {
+        assert_eq!(
+            plane_offsets(&Pattern::Rggb).ok(),
+            Some([(0, 0), (1, 0), (0, 1), (1, 1)])
+        );
+        assert_eq!(
+            plane_offsets(&Pattern::Gbrg).ok(),
+            Some([(0, 1), (1, 1), (0, 0), (1, 0)])
+        );
+        assert_eq!(
+            plane_offsets(&Pattern::Bggr).ok(),
+            Some([(1, 1), (0, 1), (1, 0), (0, 0)])
+        );
+        assert_eq!(
+            plane_offsets(&Pattern::Grbg).ok(),
+            Some([(1, 0), (0, 0), (1, 1), (0, 1)])
+        );
+        assert!(plane_offsets(&Pattern::Empty).is_err());
+    }
+
+    #[test]
+    fn test_bin() {
+        // RGGB, the value is 1000 * colour position + 10 * y + x.
+        let (width, height) = (9, 6);
+        let src: Vec<u16> = (0..width * height)
+            .map(|i| {
+                ((i / width % 2) * 2000 + (i % width % 2) * 1000 + i / width * 10 + i % width)
+                    as u16
+            })
+            .collect();
+        let levels = Levels {
+            blacks: [0, 100, 200, 300],
+            table: None,
+        };
+
+        let (data, w, h) = bin_cfa(&src, width, height, &levels);
+        assert_eq!((w, h), (4, 2));
+        // Block at 0, 0: R at (0,0), (2,0), (0,2), (2,2).
+        assert_eq!(data[0], 11);
+        // G1 at (1,0), (3,0), (1,2), (3,2), black 100.
+        assert_eq!(data[1], 1000 + 12 - 100);
+        // B at (1,1), (3,1), (1,3), (3,3), black 300.
+        assert_eq!(data[w + 1], 3000 + 22 - 300);
+        // Block at 4, 0.
+        assert_eq!(data[2], 15);
+
+        let offsets = plane_offsets(&Pattern::Rggb).unwrap();
+        let (data, w, h) = bin_planes(&src, width, height, &offsets, &levels);
+        assert_eq!((w, h), (4, 3));
+        assert_eq!(data.len(), 4 * 4 * 3);
+        let plane = w * h;
+        // The pixel 1, 2: the quad at 2, 4.
+        let o = 2 * w + 1;
+        assert_eq!(data[o], 42);
+        assert_eq!(data[plane + o], 1000 + 43 - 100);
+        assert_eq!(data[2 * plane + o], 2000 + 52 - 200);
+        assert_eq!(data[3 * plane + o], 3000 + 53 - 300);
+
+        // The linearization table is applied before the black.
+        let table: Vec<u16> = (0..4096).map(|v| v * 2).collect();
+        let levels = Levels {
+            blacks: [10, 10, 10, 10],
+            table: Some(&table),
+        };
+        let (data, _, _) = bin_planes(&src, width, height, &offsets, &levels);
+        assert_eq!(data[o], 84 - 10);
+
+        assert_eq!(bin_cfa(&src[..10], width, height, &levels).0.len(), 0);
+        assert_eq!(bin_cfa(&src, 3, 3, &levels).0.len(), 0);
+    }
+}
@@ -22,7 +22,10 @@
 //! Trait and types for various bitmap data, iamges, etc. and other
 //! geometry.
 
-use crate::DataType;
+use rayon::prelude::*;
+
+use crate::render::{encode_rgb, encode_row, GammaLut, OutputLayout, OutputSample, Sample};
+use crate::{DataType, Error, Result};
 
 /// An image buffer carries the data and the dimension. It is used to
 /// carry pipeline input and ouput as dimensions can change.
@@ -86,18 +89,41 @@ impl<T> ImageBuffer<T> {
     }
 }
 
-impl ImageBuffer<f64> {
-    pub(crate) fn into_u16(self) -> ImageBuffer<u16> {
-        ImageBuffer::<u16>::with_data(
-            self.data
-                .iter()
-                .map(|v| (*v * u16::MAX as f64).round() as u16)
-                .collect(),
-            self.width,
-            self.height,
-            16,
-            self.cc,
-        )
+impl<T: Sample> ImageBuffer<T> {
+    /// Encode the `0.0..1.0` samples into `out` laid out as `layout`,
+    /// gamma encoded with `gamma` if any. The buffer is either RGB, or
+    /// single component. Gamma only applies to RGB.
+    pub(crate) fn encode_into<O: OutputSample>(
+        &self,
+        gamma: Option<&GammaLut>,
+        layout: &OutputLayout,
+        out: &mut [O],
+    ) -> Result<()> {
+        let width = self.width as usize;
+        let cc = self.cc as usize;
+        if (layout.width, layout.height) != (width, self.height as usize)
+            || (cc != 3 && (cc != 1 || layout.channels != 1 || layout.planes != 1))
+        {
+            log::error!("Can't encode {width}x{} x {cc} as {layout:?}", self.height);
+            return Err(Error::InvalidParam);
+        }
+        if out.len() < layout.len() {
+            log::error!("Output buffer of {} for {layout:?}", out.len());
+            return Err(Error::BufferTooSmall);
+        }
+        layout
+            .bands(out, 1)
+            .into_par_iter()
+            .zip(self.data.par_chunks(std::cmp::max(1, width * cc)))
+            .for_each(|(mut row, values)| {
+                if cc == 1 {
+                    encode_row(values, &mut row[0][..width]);
+                } else {
+                    encode_rgb(values, gamma, layout, &mut row);
+                }
+            });
+
+        Ok(())
     }
 }
 
@@ -118,12 +144,17 @@ pub trait Bitmap {
     fn data16(&self) -> Option<&[u16]> {
         None
     }
+    /// Image data in 32 bits float. `None` by default
+    fn data_f32(&self) -> Option<&[f32]> {
+        None
+    }
 }
 
-/// Encapsulate data 8 or 16 bits
+/// Encapsulate data 8 or 16 bits, or float
 pub(crate) enum Data {
     Data8(Vec<u8>),
     Data16(Vec<u16>),
+    DataF32(Vec<f32>),
     Tiled((Vec<Vec<u8>>, (u32, u32))),
 }
 
@@ -138,6 +169,7 @@ impl std::fmt::Debug for Data {
         f.write_str(&match *self {
             Self::Data8(ref v) => format!("Data(Data8([{}]))", v.len()),
             Self::Data16(ref v) => format!("Data(Data16([{}]))", v.len()),
+            Self::DataF32(ref v) => format!("Data(DataF32([{}]))", v.len()),
             Self::Tiled((ref v, sz)) => format!("Data(Tiled([{}], {:?}))", v.len(), sz),
         })
     }
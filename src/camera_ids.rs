@@ -135,7 +135,6 @@ pub mod canon {
     pub const KISS_F: u16 = EOS_1000D;
     pub const G10: u16 = 35;
     pub const EOS_50D: u16 = 36;
-    pub const EOS_60D: u16 = 36;
     pub const S90: u16 = 37;
     pub const G12: u16 = 38;
     pub const S95: u16 = 39;
@@ -291,6 +290,7 @@ pub mod canon {
     pub const EOS_R100: u16 = 121;
     pub const EOS_R5MKII: u16 = 122;
     pub const EOS_R1: u16 = 123;
+    pub const EOS_60D: u16 = 124;
 }
 
 /// Nikon type IDs
@@ -1059,3 +1059,98 @@ pub mod pixii {
     pub const A1571: u16 = 2;
     pub const _A2572: u16 = 3;
 }
+
+#[cfg(test)]
+mod test {
+    use std::collections::HashMap;
+
+    /// The numeric IDs of each vendor module of `source`, by name.
+    fn rust_ids(source: &str) -> HashMap<String, HashMap<String, u16>> {
+        let mut ids = HashMap::new();
+        let mut vendor = None;
+        for line in source.lines() {
+            if let Some(name) = line
+                .strip_prefix("pub mod ")
+                .and_then(|l| l.strip_suffix(" {"))
+            {
+                vendor = Some(name.to_uppercase());
+            } else if let (Some(vendor), Some(decl)) =
+                (&vendor, line.trim().strip_prefix("pub const "))
+            {
+                if let Some((name, value)) = decl.split_once(": u16 = ") {
+                    if let Ok(value) = value.trim_end_matches(';').parse() {
+                        ids.entry(vendor.clone())
+                            .or_insert_with(HashMap::new)
+                            .insert(name.to_string(), value);
+                    }
+                }
+            }
+        }
+        ids
+    }
+
+    /// The numeric IDs of each vendor enum of the C `header`, by name.
+    /// Aliases are skipped.
+    fn header_ids(header: &str) -> HashMap<String, HashMap<String, u16>> {
+        let mut ids = HashMap::new();
+        let mut vendor = None;
+        let mut next = 0;
+        for line in header.lines() {
+            let line = line.split("/*").next().unwrap_or_default().trim();
+            if let Some(name) = line
+                .strip_prefix("enum _OR_TYPEID_VENDOR_")
+                .and_then(|l| l.strip_suffix(" {"))
+            {
+                vendor = Some(name.to_string());
+                next = 0;
+                continue;
+            }
+            if line.starts_with('}') {
+                vendor = None;
+                continue;
+            }
+            let (vendor, entry) = match vendor.as_ref().and_then(|vendor| {
+                line.trim_end_matches(',')
+                    .strip_prefix(&format!("OR_TYPEID_{vendor}_"))
+                    .map(|entry| (vendor, entry))
+            }) {
+                Some(entry) => entry,
+                None => continue,
+            };
+            let (name, value) = match entry.split_once(" = ") {
+                Some((name, value)) => match value.parse() {
+                    Ok(value) => (name, value),
+                    // An alias.
+                    Err(_) => continue,
+                },
+                None => (entry, next),
+            };
+            next = value + 1;
+            ids.entry(vendor.clone())
+                .or_insert_with(HashMap::new)
+                .insert(name.to_uppercase(), value);
+        }
+        ids
+    }
+
+    #[test]
+    fn test_header_ids() {
+        // The IDs in cameraids.h must match. The header may lack the
+        // newest ones.
+        let rust = rust_ids(include_str!("camera_ids.rs"));
+        let header = header_ids(include_str!("../include/libopenraw/cameraids.h"));
+        assert!(header.contains_key("CANON"));
+        for (vendor, ids) in &header {
+            let rust = match rust.get(vendor) {
+                Some(rust) => rust,
+                None => continue,
+            };
+            for (name, value) in ids {
+                let found = rust.get(name).or_else(|| rust.get(&format!("EOS_{name}")));
+                if let Some(expected) = found {
+                    assert_eq!(value, expected, "OR_TYPEID_{vendor}_{name}");
+                }
+            }
+        }
+    }
+}
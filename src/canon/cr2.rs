@@ -396,9 +396,7 @@ impl RawFileImpl for Cr2File {
         .map(|mut rawdata| {
             // Get the black and white point from the built-in matrices.
             let bpc = rawdata.bpc();
-            let (black, white) = MATRICES
-                .iter()
-                .find(|m| m.camera == type_id)
+            let (black, white) = crate::colour::find_builtin_matrix(&MATRICES, type_id)
                 .map(|m| {
                     (
                         m.black,
@@ -426,7 +424,7 @@ impl RawFileImpl for Cr2File {
     }
 
     fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
+        self.builtin_colour_matrix(&MATRICES)
     }
 }
 
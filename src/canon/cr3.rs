@@ -236,7 +236,7 @@ impl RawFileImpl for Cr3File {
     }
 
     fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
+        self.builtin_colour_matrix(&MATRICES)
     }
 }
 
@@ -392,25 +392,24 @@ impl RawFileImpl for CrwFile {
                                     .decompress(&mut view)
                                     .map(|mut rawdata| {
                                         let bpc = 10_u32;
-                                        let (black, white) = MATRICES
-                                            .iter()
-                                            .find(|m| m.camera == type_id)
-                                            .map(|m| {
-                                                (
-                                                    m.black,
-                                                    if m.white == 0 {
-                                                        // A 0 value for white isn't valid.
-                                                        let white: u32 = (1 << bpc) - 1;
-                                                        white as u16
-                                                    } else {
-                                                        m.white
-                                                    },
-                                                )
-                                            })
-                                            .unwrap_or_else(|| {
-                                                let white: u32 = (1 << bpc) - 1;
-                                                (0, white as u16)
-                                            });
+                                        let (black, white) =
+                                            crate::colour::find_builtin_matrix(&MATRICES, type_id)
+                                                .map(|m| {
+                                                    (
+                                                        m.black,
+                                                        if m.white == 0 {
+                                                            // A 0 value for white isn't valid.
+                                                            let white: u32 = (1 << bpc) - 1;
+                                                            white as u16
+                                                        } else {
+                                                            m.white
+                                                        },
+                                                    )
+                                                })
+                                                .unwrap_or_else(|| {
+                                                    let white: u32 = (1 << bpc) - 1;
+                                                    (0, white as u16)
+                                                });
 
                                         rawdata.set_whites([white; 4]);
                                         rawdata.set_blacks([black; 4]);
@@ -434,7 +433,7 @@ impl RawFileImpl for CrwFile {
     }
 
     fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
+        self.builtin_colour_matrix(&MATRICES)
     }
 }
 
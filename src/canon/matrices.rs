@@ -20,11 +20,11 @@
  */
 
 use crate::canon;
-use crate::colour::BuiltinMatrix;
+use crate::colour::{self, BuiltinMatrix};
 use crate::TypeId;
 
-lazy_static::lazy_static! {
-    pub(super) static ref MATRICES: [BuiltinMatrix; 119] = [
+#[rustfmt::skip]
+pub(super) static MATRICES: [BuiltinMatrix; 118] = colour::sorted_matrices([
     /* CRW */
     BuiltinMatrix::new( canon!(EOS_D30),
       0,
@@ -212,10 +212,6 @@ lazy_static::lazy_static! {
       0,
       0x3510,
       [ 6444, -904, -893, -4563, 12308, 2535, -903, 2016, 6728 ] ),
-    BuiltinMatrix::new( canon!(EOS_100D),
-      0,
-      0x3806,
-      [ 6602, -841, -939, -4472, 12458, 2247, -975, 2039, 6148 ] ),
     BuiltinMatrix::new( canon!(EOS_1200D), // Rebel T5
       0,
       0x37c2,
@@ -510,6 +506,4 @@ lazy_static::lazy_static! {
       0,
       0,
       [ 8971, -2022, -1242, -5405, 13249, 2380, -1280, 2483, 6072 ] ),
-    ];
-
-}
+    ]);
@@ -136,11 +136,39 @@ impl From<Error> for or_error {
     fn from(err: Error) -> or_error {
         match err {
             Error::NotFound => or_error::NOT_FOUND,
+            Error::BufferTooSmall => or_error::BUF_TOO_SMALL,
+            Error::InvalidParam => or_error::INVALID_PARAM,
+            Error::InvalidFormat => or_error::INVALID_FORMAT,
             _ => or_error::UNKNOWN,
         }
     }
 }
 
+#[cfg(feature = "capi")]
+/// Get the caller output `buffer` of `capacity` elements, where `size`
+/// elements are needed. `size` is stored at `required` if not `null`.
+/// [`BUF_TOO_SMALL`][or_error::BUF_TOO_SMALL] if `buffer` is `null` or
+/// too small.
+///
+/// # Safety
+/// `buffer` must be valid for `capacity` elements.
+pub(crate) unsafe fn output_buffer<'a, T>(
+    buffer: *mut T,
+    capacity: usize,
+    size: crate::Result<usize>,
+    required: *mut usize,
+) -> std::result::Result<&'a mut [T], or_error> {
+    let size = size.map_err(or_error::from)?;
+    if !required.is_null() {
+        *required = size;
+    }
+    if buffer.is_null() || capacity < size {
+        return Err(or_error::BUF_TOO_SMALL);
+    }
+
+    Ok(std::slice::from_raw_parts_mut(buffer, capacity))
+}
+
 impl From<or_error> for Error {
     fn from(err: or_error) -> Error {
         match err {
@@ -177,6 +205,12 @@ pub enum or_data_type {
     RAW = 6,
     /// Compressed RAW container
     COMPRESSED_RAW = 7,
+    /// 8bit per channel RGBA pixmap
+    PIXMAP_8RGBA = 8,
+    /// 32bit float per channel planar RGB pixmap
+    PIXMAP_PLANAR_F32 = 9,
+    /// RAW data in 4 planes R, G1, G2, B
+    RAW_PLANES = 10,
 
     /// Unknown data type. Unlikely.
     UNKNOWN = 100,
@@ -188,8 +222,11 @@ impl From<DataType> for or_data_type {
             DataType::Jpeg => Self::JPEG,
             DataType::PixmapRgb8 => Self::PIXMAP_8RGB,
             DataType::PixmapRgb16 => Self::PIXMAP_16RGB,
+            DataType::PixmapRgba8 => Self::PIXMAP_8RGBA,
+            DataType::PixmapPlanarF32 => Self::PIXMAP_PLANAR_F32,
             DataType::CompressedRaw => Self::COMPRESSED_RAW,
             DataType::Raw => Self::RAW,
+            DataType::RawPlanes => Self::RAW_PLANES,
             DataType::Unknown => Self::UNKNOWN,
         }
     }
@@ -237,6 +274,8 @@ pub(crate) enum or_options {
     NONE = 0,
     /// Don't decompress
     DONT_DECOMPRESS = 1,
+    /// Reorder the bayer CFA in 4 planes. See `RawImage::planar()`.
+    PLANAR = 2,
 }
 
 #[cfg(feature = "capi")]
@@ -350,9 +389,16 @@ unsafe extern "C" fn or_get_extract_rawdata(
     }
 
     let filename = unsafe { CStr::from_ptr(filename) };
-    let skip_decompression = options == or_options::DONT_DECOMPRESS as u32;
+    let skip_decompression = options & or_options::DONT_DECOMPRESS as u32 != 0;
     let rawdata_ = rawfile_from_file(OsStr::from_bytes(filename.to_bytes()), None)
         .and_then(|rawfile| rawfile.load_rawdata(skip_decompression))
+        .and_then(|rawdata| {
+            if options & or_options::PLANAR as u32 != 0 {
+                rawdata.planar()
+            } else {
+                Ok(rawdata)
+            }
+        })
         .map(Box::new)
         .map_err(or_error::from);
     if let Err(err) = rawdata_ {
@@ -58,6 +58,11 @@ extern "C" fn or_bitmapdata_data(bitmap: ORBitmapDataRef) -> *const libc::c_void
                 .data16()
                 .map(|data| data.as_ptr())
                 .unwrap_or_else(std::ptr::null) as *const libc::c_void
+        } else if bitmap.data_type() == DataType::PixmapPlanarF32 {
+            bitmap
+                .data_f32()
+                .map(|data| data.as_ptr())
+                .unwrap_or_else(std::ptr::null) as *const libc::c_void
         } else {
             bitmap
                 .data8()
@@ -83,3 +88,9 @@ extern "C" fn or_bitmapdata_dimensions(bitmap: ORBitmapDataRef, x: *mut u32, y:
         }
     })
 }
+
+#[no_mangle]
+/// Return the bits per component of `bitmap`, or 0 if there is none.
+extern "C" fn or_bitmapdata_bpc(bitmap: ORBitmapDataRef) -> u32 {
+    or_unwrap!(bitmap, 0, bitmap.bpc() as u32)
+}
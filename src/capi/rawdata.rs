@@ -21,21 +21,28 @@
 
 use num_enum::TryFromPrimitive;
 
-use super::{or_cfa_pattern, or_data_type, or_error, ORMosaicInfoRef};
+use super::{
+    or_cfa_pattern, or_data_type, or_error, output_buffer, ORBitmapDataRef, ORMosaicInfoRef,
+};
 use crate::{
     colour::ColourSpace,
     or_unwrap,
-    render::{RenderingOptions, RenderingStage},
-    AspectRatio, Bitmap, RawImage,
+    render::{DemosaicMethod, RenderingCrop, RenderingOptions, RenderingScale, RenderingStage},
+    AspectRatio, Binning, Bitmap, RawImage, Rect, Statistics,
 };
 
 /// Pointer to a [`RawImage`] object exported to the C API.
 pub type ORRawDataRef = *mut RawImage;
 
+/// Pointer to a [`Statistics`] object exported to the C API.
+pub type ORRawStatisticsRef = *mut Statistics;
+
 #[allow(dead_code)]
 /// The rendering options const for the C API.
 pub(crate) mod or_rendering_options {
-    use crate::{ColourSpace, RenderingStage};
+    use crate::{
+        ColourSpace, DemosaicMethod, RenderingCrop, RenderingFormat, RenderingScale, RenderingStage,
+    };
 
     /// The mask for the target coulour space. 16 possible values.
     pub const OR_RENDERING_TARGET_CS_MASK: u32 = 0x0000000f;
@@ -45,6 +52,14 @@ pub(crate) mod or_rendering_options {
     pub const OR_RENDERING_TARGET_XYZ_CS: u32 = ColourSpace::XYZ as u32;
     /// Render to sRGB colour space.
     pub const OR_RENDERING_TARGET_SRGB_CS: u32 = ColourSpace::SRgb as u32;
+    /// Render to linear sRGB colour space.
+    pub const OR_RENDERING_TARGET_LINEAR_SRGB_CS: u32 = ColourSpace::LinearSRgb as u32;
+    /// Render to Display P3 colour space.
+    pub const OR_RENDERING_TARGET_DISPLAY_P3_CS: u32 = ColourSpace::DisplayP3 as u32;
+    /// Render to linear Rec.2020 colour space.
+    pub const OR_RENDERING_TARGET_REC2020_CS: u32 = ColourSpace::Rec2020 as u32;
+    /// Render to ProPhoto RGB colour space.
+    pub const OR_RENDERING_TARGET_PROPHOTO_CS: u32 = ColourSpace::ProPhoto as u32;
 
     /// The mask for the stage
     pub const OR_RENDERING_STAGE_MASK: u32 = 0x00000030;
@@ -63,6 +78,65 @@ pub(crate) mod or_rendering_options {
     pub const OR_RENDERING_STAGE_COLOUR: u32 =
         (RenderingStage::Colour as u32) << OR_RENDERING_STAGE_BIT_SHIFT;
 
+    /// The mask for the demosaic method.
+    pub const OR_RENDERING_DEMOSAIC_MASK: u32 = 0x000000c0;
+    /// The number of bits to shift in or out.
+    pub const OR_RENDERING_DEMOSAIC_BIT_SHIFT: u32 = 6;
+    /// Bimedian demosaic (default).
+    pub const OR_RENDERING_DEMOSAIC_BIMEDIAN: u32 =
+        (DemosaicMethod::Bimedian as u32) << OR_RENDERING_DEMOSAIC_BIT_SHIFT;
+    /// PPG demosaic
+    pub const OR_RENDERING_DEMOSAIC_PPG: u32 =
+        (DemosaicMethod::Ppg as u32) << OR_RENDERING_DEMOSAIC_BIT_SHIFT;
+
+    /// The mask for the scale.
+    pub const OR_RENDERING_SCALE_MASK: u32 = 0x00000300;
+    /// The number of bits to shift in or out.
+    pub const OR_RENDERING_SCALE_BIT_SHIFT: u32 = 8;
+    /// Full size (default).
+    pub const OR_RENDERING_SCALE_FULL: u32 =
+        (RenderingScale::Full as u32) << OR_RENDERING_SCALE_BIT_SHIFT;
+    /// Half size.
+    pub const OR_RENDERING_SCALE_HALF: u32 =
+        (RenderingScale::Half as u32) << OR_RENDERING_SCALE_BIT_SHIFT;
+    /// Quarter size.
+    pub const OR_RENDERING_SCALE_QUARTER: u32 =
+        (RenderingScale::Quarter as u32) << OR_RENDERING_SCALE_BIT_SHIFT;
+    /// Eighth size.
+    pub const OR_RENDERING_SCALE_EIGHTH: u32 =
+        (RenderingScale::Eighth as u32) << OR_RENDERING_SCALE_BIT_SHIFT;
+
+    /// The mask for the crop.
+    pub const OR_RENDERING_CROP_MASK: u32 = 0x00000c00;
+    /// The number of bits to shift in or out.
+    pub const OR_RENDERING_CROP_BIT_SHIFT: u32 = 10;
+    /// No crop (default).
+    pub const OR_RENDERING_CROP_NONE: u32 =
+        (RenderingCrop::None as u32) << OR_RENDERING_CROP_BIT_SHIFT;
+    /// Crop to the active area.
+    pub const OR_RENDERING_CROP_ACTIVE_AREA: u32 =
+        (RenderingCrop::ActiveArea as u32) << OR_RENDERING_CROP_BIT_SHIFT;
+    /// Crop to the user crop.
+    pub const OR_RENDERING_CROP_USER_CROP: u32 =
+        (RenderingCrop::UserCrop as u32) << OR_RENDERING_CROP_BIT_SHIFT;
+
+    /// The mask for the output pixel format.
+    pub const OR_RENDERING_FORMAT_MASK: u32 = 0x00003000;
+    /// The number of bits to shift in or out.
+    pub const OR_RENDERING_FORMAT_BIT_SHIFT: u32 = 12;
+    /// 16 bits RGB (default).
+    pub const OR_RENDERING_FORMAT_RGB16: u32 =
+        (RenderingFormat::Rgb16 as u32) << OR_RENDERING_FORMAT_BIT_SHIFT;
+    /// 8 bits RGB.
+    pub const OR_RENDERING_FORMAT_RGB8: u32 =
+        (RenderingFormat::Rgb8 as u32) << OR_RENDERING_FORMAT_BIT_SHIFT;
+    /// 8 bits RGBA, with an opaque alpha.
+    pub const OR_RENDERING_FORMAT_RGBA8: u32 =
+        (RenderingFormat::Rgba8 as u32) << OR_RENDERING_FORMAT_BIT_SHIFT;
+    /// 32 bits float planar RGB.
+    pub const OR_RENDERING_FORMAT_PLANAR_F32: u32 =
+        (RenderingFormat::PlanarF32 as u32) << OR_RENDERING_FORMAT_BIT_SHIFT;
+
     /// Default is SRgb, Interpolation stage.
     pub const OR_RENDERING_OPTIONS_DEFAULT: u32 =
         OR_RENDERING_TARGET_SRGB_CS + OR_RENDERING_STAGE_INTERP;
@@ -81,6 +155,26 @@ impl From<u32> for RenderingOptions {
         ) {
             options = options.with_stage(stage);
         }
+        if let Ok(method) = DemosaicMethod::try_from_primitive(
+            (value & OR_RENDERING_DEMOSAIC_MASK) >> OR_RENDERING_DEMOSAIC_BIT_SHIFT,
+        ) {
+            options = options.with_demosaic(method);
+        }
+        if let Ok(scale) = RenderingScale::try_from_primitive(
+            (value & OR_RENDERING_SCALE_MASK) >> OR_RENDERING_SCALE_BIT_SHIFT,
+        ) {
+            options = options.with_scale(scale);
+        }
+        if let Ok(crop) = RenderingCrop::try_from_primitive(
+            (value & OR_RENDERING_CROP_MASK) >> OR_RENDERING_CROP_BIT_SHIFT,
+        ) {
+            options = options.with_crop(crop);
+        }
+        if let Ok(format) = RenderingFormat::try_from_primitive(
+            (value & OR_RENDERING_FORMAT_MASK) >> OR_RENDERING_FORMAT_BIT_SHIFT,
+        ) {
+            options = options.with_format(format);
+        }
 
         options
     }
@@ -133,6 +227,21 @@ extern "C" fn or_rawdata_data(rawdata: ORRawDataRef) -> *const libc::c_void {
     )
 }
 
+#[no_mangle]
+/// Return the plane `index` of planar raw data, R, G1, G2 and B, and
+/// its number of samples in `size`. `null` if the data isn't planar.
+extern "C" fn or_rawdata_plane(rawdata: ORRawDataRef, index: u32, size: *mut usize) -> *const u16 {
+    or_unwrap!(rawdata, std::ptr::null(), {
+        let plane = rawdata.plane(index as usize);
+        if !size.is_null() {
+            unsafe { *size = plane.map(|plane| plane.len()).unwrap_or(0) };
+        }
+        plane
+            .map(|plane| plane.as_ptr())
+            .unwrap_or_else(std::ptr::null)
+    })
+}
+
 #[no_mangle]
 /// Return the format of the raw data.
 extern "C" fn or_rawdata_format(rawdata: ORRawDataRef) -> or_data_type {
@@ -354,3 +463,260 @@ extern "C" fn or_rawdata_get_mosaicinfo(rawdata: ORRawDataRef) -> ORMosaicInfoRe
         std::ptr::null_mut()
     }
 }
+
+#[no_mangle]
+/// Get the rendered image of the region `x`, `y`, `width`, `height`,
+/// in raw pixel coordinates. Only the region is rendered. The returned
+/// ORBitmapDataRef must be freed.
+extern "C" fn or_rawdata_get_rendered_image_region(
+    rawdata: ORRawDataRef,
+    options: u32,
+    x: u32,
+    y: u32,
+    width: u32,
+    height: u32,
+    error: *mut or_error,
+) -> ORBitmapDataRef {
+    let region = Rect {
+        x,
+        y,
+        width,
+        height,
+    };
+    let options = RenderingOptions::from(options).with_region(Some(region));
+    or_unwrap!(rawdata, std::ptr::null_mut(), {
+        rawdata
+            .rendered_image(options)
+            .map(|r| Box::into_raw(Box::new(r)))
+            .unwrap_or_else(|e| {
+                if !error.is_null() {
+                    unsafe { *error = e.into() };
+                }
+                std::ptr::null_mut()
+            })
+    })
+}
+
+/// Store the rendered dimensions of `result` at `width` and `height`
+/// if not `null`, and return the error.
+pub(crate) fn rendered_dimensions(
+    result: crate::Result<(u32, u32)>,
+    width: *mut u32,
+    height: *mut u32,
+) -> or_error {
+    match result {
+        Ok((w, h)) => {
+            if !width.is_null() {
+                unsafe { *width = w };
+            }
+            if !height.is_null() {
+                unsafe { *height = h };
+            }
+            or_error::NONE
+        }
+        Err(err) => err.into(),
+    }
+}
+
+#[no_mangle]
+/// Render the raw data into the caller `buffer` of `capacity` bytes,
+/// with rows `stride` bytes apart, or packed if `stride` is 0. The
+/// size needed is stored at `required`, and
+/// [`BUF_TOO_SMALL`][or_error::BUF_TOO_SMALL] is returned if `buffer`
+/// is `null` or too small. `buffer` must be aligned for the samples.
+extern "C" fn or_rawdata_get_rendered_image_into(
+    rawdata: ORRawDataRef,
+    options: u32,
+    buffer: *mut libc::c_void,
+    stride: usize,
+    capacity: usize,
+    width: *mut u32,
+    height: *mut u32,
+    required: *mut usize,
+) -> or_error {
+    let options = RenderingOptions::from(options);
+    or_unwrap!(rawdata, or_error::NOT_AREF, {
+        let size = rawdata.rendered_buffer_size(&options, stride);
+        match unsafe { output_buffer(buffer as *mut u8, capacity, size, required) } {
+            Ok(dest) => rendered_dimensions(
+                rawdata.rendered_image_into(options, dest, stride),
+                width,
+                height,
+            ),
+            Err(err) => err,
+        }
+    })
+}
+
+#[no_mangle]
+/// Bin the raw data by half with `binning`, a `or_binning` value, the
+/// black subtracted. Return a new `ORRawDataRef` that must be freed,
+/// or `null` in case of error.
+extern "C" fn or_rawdata_bin(
+    rawdata: ORRawDataRef,
+    binning: u32,
+    error: *mut or_error,
+) -> ORRawDataRef {
+    or_unwrap!(rawdata, std::ptr::null_mut(), {
+        let binned = Binning::try_from_primitive(binning)
+            .map_err(|_| or_error::INVALID_PARAM)
+            .and_then(|binning| rawdata.binned(binning).map_err(or_error::from));
+        if !error.is_null() {
+            unsafe { *error = binned.as_ref().err().copied().unwrap_or(or_error::NONE) };
+        }
+        binned
+            .map(|binned| Box::into_raw(Box::new(binned)))
+            .unwrap_or(std::ptr::null_mut())
+    })
+}
+
+#[no_mangle]
+/// Compute the statistics of the raw data, per CFA channel. Return a
+/// `ORRawStatisticsRef` that must be freed with
+/// `or_rawstatistics_release`, or `null` in case of error.
+extern "C" fn or_rawdata_get_statistics(
+    rawdata: ORRawDataRef,
+    error: *mut or_error,
+) -> ORRawStatisticsRef {
+    or_unwrap!(rawdata, std::ptr::null_mut(), {
+        let stats = rawdata.statistics().map_err(or_error::from);
+        if !error.is_null() {
+            unsafe { *error = stats.as_ref().err().copied().unwrap_or(or_error::NONE) };
+        }
+        stats
+            .map(|stats| Box::into_raw(Box::new(stats)))
+            .unwrap_or(std::ptr::null_mut())
+    })
+}
+
+#[no_mangle]
+/// Release the statistics.
+extern "C" fn or_rawstatistics_release(stats: ORRawStatisticsRef) -> or_error {
+    if !stats.is_null() {
+        unsafe { drop(Box::from_raw(stats)) };
+        return or_error::NONE;
+    }
+    or_error::NOT_AREF
+}
+
+#[no_mangle]
+/// Return the number of channels of the statistics.
+extern "C" fn or_rawstatistics_channel_count(stats: ORRawStatisticsRef) -> u32 {
+    or_unwrap!(stats, 0, stats.channels().len() as u32)
+}
+
+#[no_mangle]
+/// Get the statistics of `channel`. Any of the out pointers can be
+/// `null`. [`INVALID_PARAM`][or_error::INVALID_PARAM] if there is no
+/// `channel`.
+extern "C" fn or_rawstatistics_get_channel(
+    stats: ORRawStatisticsRef,
+    channel: u32,
+    min: *mut u16,
+    max: *mut u16,
+    mean: *mut f64,
+    clipped: *mut u64,
+    below_black: *mut u64,
+) -> or_error {
+    or_unwrap!(stats, or_error::NOT_AREF, {
+        if let Some(channel) = stats.channels().get(channel as usize) {
+            unsafe {
+                if !min.is_null() {
+                    *min = channel.min;
+                }
+                if !max.is_null() {
+                    *max = channel.max;
+                }
+                if !mean.is_null() {
+                    *mean = channel.mean();
+                }
+                if !clipped.is_null() {
+                    *clipped = channel.clipped;
+                }
+                if !below_black.is_null() {
+                    *below_black = channel.below_black;
+                }
+            }
+            or_error::NONE
+        } else {
+            or_error::INVALID_PARAM
+        }
+    })
+}
+
+#[no_mangle]
+/// Get the histogram of `channel`, and its number of bins in `size`.
+/// The pointer is owned by the statistics. `null` if there is no
+/// `channel`.
+extern "C" fn or_rawstatistics_get_histogram(
+    stats: ORRawStatisticsRef,
+    channel: u32,
+    size: *mut libc::size_t,
+) -> *const u32 {
+    or_unwrap!(stats, std::ptr::null(), {
+        if let Some(channel) = stats.channels().get(channel as usize) {
+            if !size.is_null() {
+                unsafe { *size = channel.histogram.len() };
+            }
+            channel.histogram.as_ptr()
+        } else {
+            std::ptr::null()
+        }
+    })
+}
+
+#[cfg(test)]
+mod test {
+    use super::or_rendering_options::*;
+
+    #[test]
+    fn test_rendering_options_header() {
+        // The values in consts.h must match.
+        let header = include_str!("../../include/libopenraw/consts.h");
+        let value = |name: &str| {
+            header
+                .lines()
+                .map(str::trim)
+                .find_map(|line| line.strip_prefix(name)?.strip_prefix(" = 0x"))
+                .and_then(|v| u32::from_str_radix(&v[..8], 16).ok())
+        };
+        macro_rules! check {
+            ($($name:ident),*) => {
+                $(assert_eq!(value(stringify!($name)), Some($name), stringify!($name));)*
+            };
+        }
+        check!(
+            OR_RENDERING_TARGET_CS_MASK,
+            OR_RENDERING_TARGET_CAMERA_CS,
+            OR_RENDERING_TARGET_XYZ_CS,
+            OR_RENDERING_TARGET_SRGB_CS,
+            OR_RENDERING_TARGET_LINEAR_SRGB_CS,
+            OR_RENDERING_TARGET_DISPLAY_P3_CS,
+            OR_RENDERING_TARGET_REC2020_CS,
+            OR_RENDERING_TARGET_PROPHOTO_CS,
+            OR_RENDERING_STAGE_MASK,
+            OR_RENDERING_STAGE_RAW,
+            OR_RENDERING_STAGE_LINEAR,
+            OR_RENDERING_STAGE_INTERP,
+            OR_RENDERING_STAGE_COLOUR,
+            OR_RENDERING_DEMOSAIC_MASK,
+            OR_RENDERING_DEMOSAIC_BIMEDIAN,
+            OR_RENDERING_DEMOSAIC_PPG,
+            OR_RENDERING_SCALE_MASK,
+            OR_RENDERING_SCALE_FULL,
+            OR_RENDERING_SCALE_HALF,
+            OR_RENDERING_SCALE_QUARTER,
+            OR_RENDERING_SCALE_EIGHTH,
+            OR_RENDERING_CROP_MASK,
+            OR_RENDERING_CROP_NONE,
+            OR_RENDERING_CROP_ACTIVE_AREA,
+            OR_RENDERING_CROP_USER_CROP,
+            OR_RENDERING_FORMAT_MASK,
+            OR_RENDERING_FORMAT_RGB16,
+            OR_RENDERING_FORMAT_RGB8,
+            OR_RENDERING_FORMAT_RGBA8,
+            OR_RENDERING_FORMAT_PLANAR_F32
+        );
+        assert_eq!(OR_RENDERING_OPTIONS_DEFAULT, 0x23);
+    }
+}
@@ -21,6 +21,7 @@
 
 //! This contain all the `or_rawfile_*` APIs.
 
+use std::cell::RefCell;
 use std::ffi::{CStr, OsStr};
 use std::os::raw::c_char;
 // This is not portable to Windows
@@ -28,13 +29,17 @@ use std::os::unix::ffi::OsStrExt;
 
 use crate::render::RenderingOptions;
 use crate::tiff::exif;
-use crate::{or_unwrap, rawfile_from_file, rawfile_from_memory, RawFileHandle, Type};
+use crate::{
+    or_unwrap, rawfile_from_file, rawfile_from_memory, Error, RawFileHandle, RawImage, Rect,
+    Result, RowBand, Type,
+};
 
 use super::iterator::ORMetadataIterator;
 use super::metavalue::ORMetaValue;
+use super::rawdata::rendered_dimensions;
 use super::{
-    or_colour_matrix_origin, or_error, or_ifd_dir_type, or_options, ORBitmapDataRef, ORIfdDirRef,
-    ORMetaValueRef, ORMetadataIteratorRef, ORRawDataRef, ORThumbnailRef,
+    or_colour_matrix_origin, or_error, or_ifd_dir_type, or_options, output_buffer, ORBitmapDataRef,
+    ORIfdDirRef, ORMetaValueRef, ORMetadataIteratorRef, ORRawDataRef, ORThumbnailRef,
 };
 
 #[allow(non_camel_case_types)]
@@ -46,10 +51,59 @@ pub type or_rawfile_typeid = u32;
 /// Equivalent to [`Type`]: the type of the raw file.
 pub type or_rawfile_type = u32;
 
+#[allow(non_camel_case_types)]
+/// The callback for [`or_rawfile_decode_rows`]: it gets the first row
+/// `y`, the `height` rows of `row_len` samples at `data`, and the
+/// `user_data`. Return 0 to continue, anything else stops the decoding
+/// and is returned as the error. It is a plain integer as the caller
+/// may return any `or_error` code, or its own.
+pub type or_rows_callback = Option<
+    extern "C" fn(
+        y: u32,
+        height: u32,
+        row_len: usize,
+        data: *const u16,
+        user_data: *mut libc::c_void,
+    ) -> libc::c_int,
+>;
+
 /// Wrapper for the [RawFile] trait. This is because we can't expose
 /// traits, and also we need to refcount it.
-#[derive(Clone)]
-pub struct ORRawFile(RawFileHandle);
+///
+/// It also keeps the raw data decoded for a size query of the `*_into`
+/// functions, so that the call to fill the buffer doesn't decode it
+/// again.
+pub struct ORRawFile(RawFileHandle, RefCell<Option<RawImage>>);
+
+impl Clone for ORRawFile {
+    fn clone(&self) -> ORRawFile {
+        ORRawFile(self.0.clone(), RefCell::new(None))
+    }
+}
+
+impl ORRawFile {
+    fn new(rawfile: RawFileHandle) -> ORRawFile {
+        ORRawFile(rawfile, RefCell::new(None))
+    }
+
+    /// The decoded raw data, kept from a size query or decoded now.
+    fn take_raw_data(&self) -> Result<RawImage> {
+        self.1
+            .take()
+            .map(Ok)
+            .unwrap_or_else(|| self.0.raw_data(false))
+    }
+
+    /// Keep `rawdata` for the next call if `err` is from a size
+    /// query. Return `err`.
+    fn keep_raw_data(&self, rawdata: RawImage, err: or_error) -> or_error {
+        if err == or_error::BUF_TOO_SMALL {
+            self.1.replace(Some(rawdata));
+        }
+        err
+    }
+}
+
 /// Pointer to a [`ORRawFile`] object wrapper exported to the C API.
 pub type ORRawFileRef = *mut ORRawFile;
 
@@ -68,7 +122,7 @@ extern "C" fn or_rawfile_new(filename: *mut c_char, type_: Type) -> ORRawFileRef
         Some(type_)
     };
     if let Ok(rawfile) = rawfile_from_file(OsStr::from_bytes(filename.to_bytes()), type_) {
-        Box::into_raw(Box::new(ORRawFile(rawfile)))
+        Box::into_raw(Box::new(ORRawFile::new(rawfile)))
     } else {
         std::ptr::null_mut()
     }
@@ -89,7 +143,7 @@ extern "C" fn or_rawfile_new_from_memory(buffer: *const u8, len: u32, type_: Typ
     };
     let buffer = Vec::from(bytes);
     match rawfile_from_memory(buffer, type_) {
-        Ok(rawfile) => Box::into_raw(Box::new(ORRawFile(rawfile))),
+        Ok(rawfile) => Box::into_raw(Box::new(ORRawFile::new(rawfile))),
         Err(_) => std::ptr::null_mut(),
     }
 }
@@ -156,10 +210,17 @@ extern "C" fn or_rawfile_get_rawdata(
     error: *mut or_error,
 ) -> ORRawDataRef {
     or_unwrap!(rawfile, std::ptr::null_mut(), {
-        let skip_decompression = options == or_options::DONT_DECOMPRESS as u32;
+        let skip_decompression = options & or_options::DONT_DECOMPRESS as u32 != 0;
         rawfile
             .0
             .raw_data(skip_decompression)
+            .and_then(|rawdata| {
+                if options & or_options::PLANAR as u32 != 0 {
+                    rawdata.planar()
+                } else {
+                    Ok(rawdata)
+                }
+            })
             .map(|rawdata| {
                 if !error.is_null() {
                     unsafe { *error = or_error::NONE }
@@ -175,6 +236,96 @@ extern "C" fn or_rawfile_get_rawdata(
     })
 }
 
+#[no_mangle]
+/// Get the raw data into the caller `buffer` of `capacity` samples,
+/// with rows `stride` samples apart, or packed if `stride` is 0. The
+/// size needed is stored at `required`, and
+/// [`BUF_TOO_SMALL`][or_error::BUF_TOO_SMALL] is set if `buffer` is
+/// `null` or too small. The returned `ORRawDataRef` has no data, only
+/// the metadata, and must be freed.
+extern "C" fn or_rawfile_get_rawdata_into(
+    rawfile: ORRawFileRef,
+    buffer: *mut u16,
+    stride: usize,
+    capacity: usize,
+    required: *mut usize,
+    error: *mut or_error,
+) -> ORRawDataRef {
+    or_unwrap!(rawfile, std::ptr::null_mut(), {
+        // The size is the one of the decoded data, that may differ
+        // from what the file says.
+        let rawdata = rawfile
+            .take_raw_data()
+            .map_err(or_error::from)
+            .and_then(|rawdata| {
+                let size = rawdata.data16_buffer_size(stride);
+                match unsafe { output_buffer(buffer, capacity, size, required) } {
+                    Ok(dest) => rawdata
+                        .move_data16_into(dest, stride)
+                        .map_err(or_error::from),
+                    Err(err) => Err(rawfile.keep_raw_data(rawdata, err)),
+                }
+            });
+        if !error.is_null() {
+            unsafe { *error = rawdata.as_ref().err().copied().unwrap_or(or_error::NONE) };
+        }
+        rawdata
+            .map(|rawdata| Box::into_raw(Box::new(rawdata)))
+            .unwrap_or(std::ptr::null_mut())
+    })
+}
+
+#[no_mangle]
+/// Decode the raw data in bands of `band_rows` rows, passed to
+/// `callback` in order with `user_data`. The band buffer is only valid
+/// during the call. Sequential decoders never hold the whole data. The
+/// returned `ORRawDataRef` has no data, only the metadata, and must be
+/// freed.
+extern "C" fn or_rawfile_decode_rows(
+    rawfile: ORRawFileRef,
+    band_rows: u32,
+    callback: or_rows_callback,
+    user_data: *mut libc::c_void,
+    error: *mut or_error,
+) -> ORRawDataRef {
+    or_unwrap!(rawfile, std::ptr::null_mut(), {
+        // The code the callback stopped with, passed back as is.
+        let mut stopped = 0;
+        let rawdata = callback
+            .ok_or(or_error::INVALID_PARAM)
+            .and_then(|callback| {
+                rawfile
+                    .0
+                    .decode_rows(band_rows, &mut |band: &RowBand| match callback(
+                        band.y,
+                        band.height,
+                        band.row_len,
+                        band.data.as_ptr(),
+                        user_data,
+                    ) {
+                        0 => Ok(()),
+                        code => {
+                            stopped = code;
+                            Err(Error::Other(format!("Callback returned {code}")))
+                        }
+                    })
+                    .map_err(or_error::from)
+            });
+        if !error.is_null() {
+            let code = match &rawdata {
+                Err(_) if stopped != 0 => stopped,
+                Err(err) => *err as libc::c_int,
+                Ok(_) => or_error::NONE as libc::c_int,
+            };
+            // The callback code may not be a valid `or_error`.
+            unsafe { *(error as *mut libc::c_int) = code };
+        }
+        rawdata
+            .map(|rawdata| Box::into_raw(Box::new(rawdata)))
+            .unwrap_or(std::ptr::null_mut())
+    })
+}
+
 #[no_mangle]
 extern "C" fn or_rawfile_get_orientation(rawfile: ORRawFileRef) -> i32 {
     or_unwrap!(rawfile, 0, rawfile.0.orientation() as i32)
@@ -264,6 +415,80 @@ extern "C" fn or_rawfile_get_rendered_image(
     })
 }
 
+#[no_mangle]
+/// Get the rendered image of the region `x`, `y`, `width`, `height`,
+/// in raw pixel coordinates. Only the raw data needed is decoded if the
+/// format allows it. The returned ORBitmapDataRef must be freed.
+extern "C" fn or_rawfile_get_rendered_image_region(
+    rawfile: ORRawFileRef,
+    options: u32,
+    x: u32,
+    y: u32,
+    width: u32,
+    height: u32,
+    error: *mut or_error,
+) -> ORBitmapDataRef {
+    let region = Rect {
+        x,
+        y,
+        width,
+        height,
+    };
+    let options = RenderingOptions::from(options).with_region(Some(region));
+    or_unwrap!(rawfile, std::ptr::null_mut(), {
+        rawfile
+            .0
+            .rendered_image(options)
+            .map(|r| Box::into_raw(Box::new(r)))
+            .unwrap_or_else(|e| {
+                if !error.is_null() {
+                    unsafe { *error = e.into() };
+                }
+                std::ptr::null_mut()
+            })
+    })
+}
+
+#[no_mangle]
+/// Render the image into the caller `buffer` of `capacity` bytes, with
+/// rows `stride` bytes apart, or packed if `stride` is 0. The size
+/// needed is stored at `required`, and
+/// [`BUF_TOO_SMALL`][or_error::BUF_TOO_SMALL] is returned if `buffer`
+/// is `null` or too small. `buffer` must be aligned for the samples.
+extern "C" fn or_rawfile_get_rendered_image_into(
+    rawfile: ORRawFileRef,
+    options: u32,
+    buffer: *mut libc::c_void,
+    stride: usize,
+    capacity: usize,
+    width: *mut u32,
+    height: *mut u32,
+    required: *mut usize,
+) -> or_error {
+    let options = RenderingOptions::from(options);
+    or_unwrap!(rawfile, or_error::NOT_AREF, {
+        // The size is the one of the decoded data, that may differ
+        // from what the file says. The options have no region, the
+        // whole raw data is needed.
+        let result = rawfile
+            .take_raw_data()
+            .map_err(or_error::from)
+            .and_then(|rawdata| {
+                let size = rawdata.rendered_buffer_size(&options, stride);
+                match unsafe { output_buffer(buffer as *mut u8, capacity, size, required) } {
+                    Ok(dest) => rawdata
+                        .rendered_image_into(options, dest, stride)
+                        .map_err(or_error::from),
+                    Err(err) => Err(rawfile.keep_raw_data(rawdata, err)),
+                }
+            });
+        match result {
+            Ok(dimensions) => rendered_dimensions(Ok(dimensions), width, height),
+            Err(err) => err,
+        }
+    })
+}
+
 #[no_mangle]
 /// Get the IFD with type `ifd_type`. May return `null` if not found.
 extern "C" fn or_rawfile_get_ifd(rawfile: ORRawFileRef, ifd_type: or_ifd_dir_type) -> ORIfdDirRef {
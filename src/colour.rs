@@ -23,7 +23,9 @@
 
 mod matrix;
 
+pub(crate) use matrix::{find_builtin_matrix, sorted_matrices};
 pub use matrix::{BuiltinMatrix, ColourMatrix};
+use nalgebra::{matrix, Matrix3};
 use num_enum::TryFromPrimitive;
 
 #[repr(C)]
@@ -53,4 +55,78 @@ pub enum ColourSpace {
     XYZ = 2,
     /// Standard RGB.
     SRgb = 3,
+    /// Standard RGB primaries, linear.
+    LinearSRgb = 4,
+    /// Display P3: DCI-P3 primaries, D65 white and the sRGB transfer
+    /// function.
+    DisplayP3 = 5,
+    /// ITU-R BT.2020 primaries, linear. For HDR.
+    Rec2020 = 6,
+    /// ProPhoto RGB (ROMM RGB), D50 white.
+    ProPhoto = 7,
+}
+
+impl ColourSpace {
+    /// The matrix from XYZ with a D65 white to the colour space. For
+    /// ProPhoto it includes the Bradford adaptation to D50. `None` if
+    /// it isn't an XYZ or RGB colour space.
+    pub(crate) fn matrix_from_xyz(&self) -> Option<Matrix3<f64>> {
+        match *self {
+            Self::XYZ => Some(Matrix3::identity()),
+            // <https://en.wikipedia.org/wiki/SRGB#From_CIE_XYZ_to_sRGB>
+            Self::SRgb | Self::LinearSRgb => Some(matrix![
+                3.2406, -1.5372, -0.4986;
+                -0.9689, 1.8758, 0.0415;
+                0.0557, -0.2040, 1.0570
+            ]),
+            Self::DisplayP3 => Some(matrix![
+                2.4934969, -0.9313836, -0.4027108;
+                -0.8294890, 1.7626641, 0.0236247;
+                0.0358458, -0.0761724, 0.9568845
+            ]),
+            Self::Rec2020 => Some(matrix![
+                1.7166512, -0.3556708, -0.2533663;
+                -0.6666844, 1.6164812, 0.0157685;
+                0.0176399, -0.0427706, 0.9421031
+            ]),
+            Self::ProPhoto => Some(matrix![
+                1.4032152, -0.2231401, -0.1015530;
+                -0.5262716, 1.4816611, 0.0170313;
+                -0.0111905, 0.0182300, 0.9114427
+            ]),
+            Self::Unknown | Self::Camera => None,
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use nalgebra::Vector3;
+
+    use super::ColourSpace;
+
+    #[test]
+    fn test_matrix_from_xyz() {
+        // The D65 white is white.
+        let d65 = Vector3::new(0.95047, 1.0, 1.08883);
+        for cs in [
+            ColourSpace::SRgb,
+            ColourSpace::LinearSRgb,
+            ColourSpace::DisplayP3,
+            ColourSpace::Rec2020,
+            ColourSpace::ProPhoto,
+        ] {
+            let white = cs.matrix_from_xyz().expect("No matrix") * d65;
+            assert!(
+                white.iter().all(|v| (v - 1.0).abs() < 1e-3),
+                "{cs:?} {white:?}"
+            );
+        }
+        assert_eq!(
+            ColourSpace::XYZ.matrix_from_xyz().map(|m| m * d65),
+            Some(d65)
+        );
+        assert!(ColourSpace::Camera.matrix_from_xyz().is_none());
+        assert!(ColourSpace::Unknown.matrix_from_xyz().is_none());
+    }
 }
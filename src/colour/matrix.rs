@@ -21,11 +21,13 @@
 
 //! Deal with colour matrixes
 
+use crate::lookup::type_id_cmp;
 use crate::tiff::exif;
 use crate::TypeId;
 
 /// Builtin Colour Matrix. This is the static data for
 /// hardcoded colour matrices.
+#[derive(Clone, Copy)]
 pub struct BuiltinMatrix {
     /// The camera for which this is the matrix
     pub camera: TypeId,
@@ -33,23 +35,49 @@ pub struct BuiltinMatrix {
     pub black: u16,
     /// White value
     pub white: u16,
-    // 3x3 matrix coefficients
-    pub matrix: [f64; 9],
+    // 3x3 matrix coefficients, in 1/10_000th
+    pub matrix: [i16; 9],
 }
 
 impl BuiltinMatrix {
     /// Create a builtin matrix. Matrix is integer in 1/10_000th
-    pub fn new(camera: TypeId, black: u16, white: u16, matrix: [i16; 9]) -> Self {
+    pub const fn new(camera: TypeId, black: u16, white: u16, matrix: [i16; 9]) -> Self {
         BuiltinMatrix {
             camera,
             black,
             white,
-            matrix: matrix.map(|v| v as f64 / 10_000_f64),
+            matrix,
         }
     }
+
+    /// The 3x3 matrix coefficients.
+    pub fn coefficients(&self) -> Vec<f64> {
+        self.matrix.iter().map(|v| *v as f64 / 10_000_f64).collect()
+    }
+}
+
+/// Sort the builtin `matrices` by camera, at compile time. This is
+/// required by `find_builtin_matrix()`.
+pub(crate) const fn sorted_matrices<const N: usize>(
+    mut matrices: [BuiltinMatrix; N],
+) -> [BuiltinMatrix; N] {
+    const_sort!(matrices, camera, type_id_cmp);
+    matrices
+}
+
+/// Find the builtin matrix for `camera` in `matrices`, sorted by
+/// `sorted_matrices()`.
+pub(crate) fn find_builtin_matrix(
+    matrices: &[BuiltinMatrix],
+    camera: TypeId,
+) -> Option<&BuiltinMatrix> {
+    matrices
+        .binary_search_by(|m| type_id_cmp(m.camera, camera))
+        .ok()
+        .map(|i| &matrices[i])
 }
 
-#[derive(Debug, Default)]
+#[derive(Clone, Debug, Default)]
 pub struct ColourMatrix {
     pub illuminant: exif::LightsourceValue,
     pub matrix: Vec<f64>,
@@ -64,3 +92,33 @@ impl std::ops::Deref for ColourMatrix {
 }
 
 impl ColourMatrix {}
+
+#[cfg(test)]
+mod test {
+    use super::{find_builtin_matrix, sorted_matrices, BuiltinMatrix};
+    use crate::TypeId;
+
+    static MATRICES: [BuiltinMatrix; 3] = sorted_matrices([
+        BuiltinMatrix::new(
+            TypeId(2, 5),
+            0,
+            4095,
+            [10_000, 0, 0, 0, 10_000, 0, 0, 0, 10_000],
+        ),
+        BuiltinMatrix::new(TypeId(1, 7), 0, 0, [0; 9]),
+        BuiltinMatrix::new(TypeId(2, 1), 128, 0, [5_000; 9]),
+    ]);
+
+    #[test]
+    fn test_find_builtin_matrix() {
+        let cameras: Vec<TypeId> = MATRICES.iter().map(|m| m.camera).collect();
+        assert_eq!(cameras, [TypeId(1, 7), TypeId(2, 1), TypeId(2, 5)]);
+
+        let matrix = find_builtin_matrix(&MATRICES, TypeId(2, 1)).expect("Matrix not found");
+        assert_eq!(matrix.black, 128);
+        assert_eq!(matrix.coefficients(), vec![0.5; 9]);
+        let matrix = find_builtin_matrix(&MATRICES, TypeId(2, 5)).expect("Matrix not found");
+        assert_eq!(matrix.coefficients()[4], 1.0);
+        assert!(find_builtin_matrix(&MATRICES, TypeId(2, 2)).is_none());
+    }
+}
@@ -24,11 +24,12 @@
 use std::cell::RefMut;
 use std::io::{Read, Seek, SeekFrom};
 
-use byteorder::{BigEndian, ByteOrder, LittleEndian, NativeEndian, ReadBytesExt};
+use byteorder::{BigEndian, ByteOrder, LittleEndian, ReadBytesExt};
+use multiversion::multiversion;
 
 use crate::io::View;
 use crate::metadata;
-use crate::thumbnail::{Data, ThumbDesc, Thumbnail};
+use crate::thumbnail::{Data, DataOffset, ThumbDesc, Thumbnail};
 use crate::Result;
 use crate::Type as RawType;
 
@@ -41,6 +42,23 @@ pub enum Endian {
 }
 
 impl Endian {
+    /// The endian of the host.
+    #[cfg(target_endian = "little")]
+    pub(crate) const NATIVE: Endian = Endian::Little;
+    /// The endian of the host.
+    #[cfg(target_endian = "big")]
+    pub(crate) const NATIVE: Endian = Endian::Big;
+
+    /// Convert in place `data`, read as is with this endian, to the
+    /// native endian. Nothing is done if the endian is already native.
+    pub(crate) fn u16_slice_to_native(&self, data: &mut [u16]) {
+        match *self {
+            Endian::Unset => unreachable!("Endian undefined"),
+            e if e == Self::NATIVE => {}
+            _ => swap_bytes_u16(data),
+        }
+    }
+
     /// Read an u16 from a reader based on the endian.
     pub(crate) fn read_u16_from<R>(&self, rdr: &mut R) -> std::io::Result<u16>
     where
@@ -70,6 +88,14 @@ impl Endian {
     }
 }
 
+/// Byte swap all the `u16` in `data`.
+#[multiversion(targets("x86_64+avx+avx2", "x86_64+ssse3", "aarch64+neon"))]
+fn swap_bytes_u16(data: &mut [u16]) {
+    for v in data.iter_mut() {
+        *v = v.swap_bytes();
+    }
+}
+
 /// Allow converting a `byteorder::ByteOrder` type to a
 /// `Endian` value
 ///
@@ -110,24 +136,22 @@ pub trait RawContainer {
     fn make_thumbnail(&self, desc: &ThumbDesc) -> Result<Thumbnail> {
         let data = match desc.data {
             Data::Bytes(ref b) => b.clone(),
-            Data::Offset(ref offset) => {
-                let mut view = self.borrow_view_mut();
-                let mut len = offset.len;
-                if offset.offset + len > view.len() {
-                    // Ricoh GXR A16 have a thumbnail size that goes past EOF
-                    // Just readjust the size to go to the end and load that.
-                    // It seems to work. Worst case scenario it still doesn't.
-                    log::warn!(
-                        "Thumbnail too big. offset {:?} view len = {}. Readjusting.",
-                        offset,
-                        view.len()
-                    );
-                    len = view.len() - offset.offset;
-                }
-                let mut data = uninit_vec!(len as usize);
-                view.seek(SeekFrom::Start(offset.offset))?;
-                view.read_exact(data.as_mut_slice())?;
-                data
+            Data::Offset(ref offset) => self.load_thumbnail_bytes(offset)?,
+            #[cfg(feature = "jxl")]
+            Data::Jxl(ref offset) => {
+                let data = self.load_thumbnail_bytes(offset)?;
+                let frame = crate::decompress::jxl::Frame::decode(&data)?;
+                return Ok(Thumbnail::with_data(
+                    frame.width as u32,
+                    frame.height as u32,
+                    crate::DataType::PixmapRgb8,
+                    frame.to_rgb8(),
+                ));
+            }
+            #[cfg(not(feature = "jxl"))]
+            Data::Jxl(_) => {
+                log::error!("JPEG XL support not built");
+                return Err(crate::Error::NotSupported);
             }
         };
         Ok(Thumbnail::with_data(
@@ -138,6 +162,27 @@ pub trait RawContainer {
         ))
     }
 
+    /// Load the thumbnail bytes at `offset`.
+    fn load_thumbnail_bytes(&self, offset: &DataOffset) -> Result<Vec<u8>> {
+        let mut view = self.borrow_view_mut();
+        let mut len = offset.len;
+        if offset.offset + len > view.len() {
+            // Ricoh GXR A16 have a thumbnail size that goes past EOF
+            // Just readjust the size to go to the end and load that.
+            // It seems to work. Worst case scenario it still doesn't.
+            log::warn!(
+                "Thumbnail too big. offset {:?} view len = {}. Readjusting.",
+                offset,
+                view.len()
+            );
+            len = view.len() - offset.offset;
+        }
+        let mut data = uninit_vec!(len as usize);
+        view.seek(SeekFrom::Start(offset.offset))?;
+        view.read_exact(data.as_mut_slice())?;
+        Ok(data)
+    }
+
     /// Get the io::View for the container.
     fn borrow_view_mut(&self) -> RefMut<'_, View>;
 
@@ -164,36 +209,63 @@ pub trait RawContainer {
     /// Load an 16 bit buffer at `offset` and of `len` bytes in the native endian.
     fn load_buffer16(&self, offset: u64, len: u64) -> Vec<u16> {
         let mut view = self.borrow_view_mut();
-        load_buffer16_endian::<NativeEndian>(&mut view, offset, len)
+        load_buffer16_endian(&mut view, offset, len, Endian::NATIVE)
     }
 
     /// Load an 16 bit buffer at `offset` and of `len` bytes, from Little Endian
     fn load_buffer16_le(&self, offset: u64, len: u64) -> Vec<u16> {
         let mut view = self.borrow_view_mut();
-        load_buffer16_endian::<LittleEndian>(&mut view, offset, len)
+        load_buffer16_endian(&mut view, offset, len, Endian::Little)
     }
 
     /// Load an 16 bit buffer at `offset` and of `len` bytes, from Big Endian
     fn load_buffer16_be(&self, offset: u64, len: u64) -> Vec<u16> {
         let mut view = self.borrow_view_mut();
-        load_buffer16_endian::<BigEndian>(&mut view, offset, len)
+        load_buffer16_endian(&mut view, offset, len, Endian::Big)
     }
 }
 
-/// Load an 16 bit buffer at `offset` and of `len` bytes following endian `E`.
-fn load_buffer16_endian<E>(view: &mut View, offset: u64, len: u64) -> Vec<u16>
-where
-    E: ByteOrder,
-{
+/// Load an 16 bit buffer at `offset` and of `len` bytes following `endian`.
+/// The data is read straight into the buffer, and only byte swapped
+/// in place if `endian` isn't native.
+fn load_buffer16_endian(view: &mut View, offset: u64, len: u64, endian: Endian) -> Vec<u16> {
     let mut data = uninit_vec!((len / 2) as usize);
 
     if let Err(err) = view.seek(SeekFrom::Start(offset)) {
         log::error!("load_buffer16: Seek failed: {err}");
     }
 
-    if let Err(err) = view.read_u16_into::<E>(&mut data) {
+    if let Err(err) = view.read_endian_u16_array(&mut data, endian) {
         log::error!("load_buffer16: {err}");
     }
 
     data
 }
+
+#[cfg(test)]
+mod test {
+    use super::Endian;
+
+    #[test]
+    fn test_u16_slice_to_native() {
+        let bytes = [0x12_u8, 0x34, 0x56, 0x78, 0x9a, 0xbc];
+        let mut data: Vec<u16> = bytes
+            .chunks(2)
+            .map(|b| u16::from_ne_bytes([b[0], b[1]]))
+            .collect();
+        Endian::Big.u16_slice_to_native(&mut data);
+        assert_eq!(data, [0x1234, 0x5678, 0x9abc]);
+
+        let mut data: Vec<u16> = bytes
+            .chunks(2)
+            .map(|b| u16::from_ne_bytes([b[0], b[1]]))
+            .collect();
+        Endian::Little.u16_slice_to_native(&mut data);
+        assert_eq!(data, [0x3412, 0x7856, 0xbc9a]);
+
+        // Long enough to go through the vectorized loop.
+        let mut data: Vec<u16> = (0..1000_u16).map(|v| v.to_be()).collect();
+        Endian::Big.u16_slice_to_native(&mut data);
+        assert!(data.iter().enumerate().all(|(i, v)| *v == i as u16));
+    }
+}
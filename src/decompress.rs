@@ -22,16 +22,21 @@
 //! Decompression
 
 pub(crate) mod bit_reader;
+#[cfg(feature = "jxl")]
+pub(crate) mod jxl;
 mod ljpeg;
+mod packed;
 mod sliced_buffer;
 mod tiled;
 
 pub use ljpeg::LJpeg;
+pub(crate) use packed::{unpack_rows, unpack_rows_to, Packing};
 pub(crate) use tiled::TiledLJpeg;
 
 use std::io::{Read, Seek, SeekFrom};
 
 use crate::container::{Endian, RawContainer};
+use crate::rows::RowSink;
 use crate::tiff;
 use crate::{Error, Result};
 use bit_reader::BitReader;
@@ -40,6 +45,9 @@ use bit_reader::BitReader;
 /// out_len is the number of expected 16-bits pixel.
 /// For performance `out_data` should have reserved size
 /// Return the number of elements written.
+///
+/// This is the scalar reference for `packed::Packing::Be10` and `Be14`.
+#[cfg(test)]
 fn unpack_bento16(input: &[u8], n: u16, out_len: usize, out_data: &mut Vec<u16>) -> Result<usize> {
     if n > 16 {
         return Err(Error::InvalidParam);
@@ -130,7 +138,10 @@ pub(crate) fn unpack_be12to16(
 /// Unpack 12-bits into 16-bits values LittleEndia
 /// For performance `out_data` should have reserved size
 /// Return the number of elements written.
-pub(crate) fn unpack_le12to16(
+///
+/// This is the scalar reference for `packed::Packing::Le12`.
+#[cfg(test)]
+fn unpack_le12to16(
     input: &[u8],
     out_data: &mut Vec<u16>,
     compression: tiff::Compression,
@@ -206,6 +217,74 @@ pub(crate) fn unpack(
     )
 }
 
+/// Unpack data at `offset` into `rows`, a band at a time. See
+/// `unpack()`.
+#[allow(clippy::too_many_arguments)]
+pub(crate) fn unpack_to(
+    container: &dyn RawContainer,
+    width: u32,
+    height: u32,
+    bpc: u16,
+    compression: tiff::Compression,
+    offset: u64,
+    byte_len: usize,
+    rows: &mut RowSink,
+) -> Result<()> {
+    let block_size = block_size(width, bpc, compression)?;
+    let packing = Packing::new(bpc, compression, container.endian())?;
+    let row_values = packing.row_values(block_size, width as usize)?;
+    rows.start(row_values);
+    let byte_len = std::cmp::min(byte_len, block_size * height as usize);
+    if block_size == 0 || row_values == 0 {
+        return Ok(());
+    }
+    // Only whole rows are read.
+    let total = (byte_len + block_size - 1) / block_size;
+    let mut block = uninit_vec!(std::cmp::min(total, rows.rows_left()) * block_size);
+    let mut y = 0;
+    while y < total {
+        let n = std::cmp::min(rows.rows_left(), total - y);
+        let block = &mut block[..n * block_size];
+        {
+            // The view isn't borrowed while the band is output.
+            let mut view = container.borrow_view_mut();
+            view.seek(SeekFrom::Start(offset + (y * block_size) as u64))?;
+            view.read_exact(block)?;
+        }
+        unpack_rows(packing, block, block_size, width as usize, rows.rows_mut())?;
+        rows.advance(n)?;
+        y += n;
+    }
+
+    Ok(())
+}
+
+/// The size in bytes of a packed row of `width` pixels.
+fn block_size(width: u32, bpc: u16, compression: tiff::Compression) -> Result<usize> {
+    match bpc {
+        10 => Ok((width / 4 * 5) as usize),
+        12 => {
+            if compression == tiff::Compression::NikonPack
+                || compression == tiff::Compression::Olympus
+                || compression == tiff::Compression::PanasonicRaw1
+            {
+                Ok(((width / 2 * 3) + width / 10) as usize)
+            } else {
+                Ok((width / 2 * 3) as usize)
+            }
+        }
+        14 => Ok((width / 4 * 7) as usize),
+        _ => {
+            log::warn!("Invalid BPC {}", bpc);
+            Err(Error::InvalidFormat)
+        }
+    }
+}
+
+/// How many rows `unpack_from_reader` reads at once. The rows of a band
+/// are unpacked in parallel.
+const UNPACK_BAND_ROWS: usize = 128;
+
 /// Unpack from a reader into a 16-bits buffer. `endian` is used when
 /// compression is `None`.
 pub(crate) fn unpack_from_reader(
@@ -224,55 +303,24 @@ pub(crate) fn unpack_from_reader(
         height,
         compression
     );
-    let block_size: usize = match bpc {
-        10 => (width / 4 * 5) as usize,
-        12 => {
-            if compression == tiff::Compression::NikonPack
-                || compression == tiff::Compression::Olympus
-                || compression == tiff::Compression::PanasonicRaw1
-            {
-                ((width / 2 * 3) + width / 10) as usize
-            } else {
-                (width / 2 * 3) as usize
-            }
-        }
-        14 => (width / 4 * 7) as usize,
-        _ => {
-            log::warn!("Invalid BPC {}", bpc);
-            return Err(Error::InvalidFormat);
-        }
-    };
+    let block_size = block_size(width, bpc, compression)?;
     log::debug!("Block size = {}", block_size);
-    let mut block = vec![0; block_size];
-    let out_size = width as usize * height as usize;
-    let mut out_data = Vec::with_capacity(out_size);
-    let mut fetched = 0_usize;
+    let packing = Packing::new(bpc, compression, endian)?;
+    let row_values = packing.row_values(block_size, width as usize)?;
+    let byte_len = std::cmp::min(byte_len, block_size * height as usize);
+    if block_size == 0 || row_values == 0 {
+        return Ok(vec![]);
+    }
+    // Only whole rows are read.
+    let rows = (byte_len + block_size - 1) / block_size;
+    let mut out_data = uninit_vec!(rows * row_values);
+    let mut block = uninit_vec!(std::cmp::min(rows, UNPACK_BAND_ROWS) * block_size);
     let mut written = 0_usize;
 
-    let byte_len = std::cmp::min(byte_len, block_size * height as usize);
-    while fetched < byte_len {
-        reader.read_exact(block.as_mut_slice())?;
-        fetched += block.len();
-        match bpc {
-            n @ 10 | n @ 14 => written += unpack_bento16(&block, n, width as usize, &mut out_data)?,
-            12 => {
-                written += match compression {
-                    tiff::Compression::NikonPack | tiff::Compression::PentaxPack => {
-                        unpack_be12to16(&block, &mut out_data, compression)?
-                    }
-                    tiff::Compression::None => match endian {
-                        Endian::Little => unpack_le12to16(&block, &mut out_data, compression)?,
-                        Endian::Big => unpack_be12to16(&block, &mut out_data, compression)?,
-                        _ => unreachable!(),
-                    },
-                    tiff::Compression::Olympus | tiff::Compression::PanasonicRaw1 => {
-                        unpack_le12to16(&block, &mut out_data, compression)?
-                    }
-                    _ => unreachable!(),
-                }
-            }
-            _ => unreachable!(),
-        }
+    for band in out_data.chunks_mut(UNPACK_BAND_ROWS * row_values) {
+        let block = &mut block[..band.len() / row_values * block_size];
+        reader.read_exact(block)?;
+        written += unpack_rows(packing, block, block_size, width as usize, band)?;
     }
     log::debug!("Unpacked {} pixels", written);
 
@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * libopenraw - decompress/jxl.rs
+ *
+ * Copyright (C) 2025 Hubert Figuière
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+//! JPEG XL decompression, as found in DNG 1.7 (compression 52546).
+//!
+//! This is only built with the `jxl` feature. The decoding itself is
+//! done by `jxl-oxide`.
+
+use rayon::prelude::*;
+
+use crate::bitmap::Bitmap;
+use crate::tiff::exif;
+use crate::{DataType, Error, RawImage, Result};
+
+use super::tiled::{check_failed_tiles, RowSpans, TiledLJpeg};
+
+/// A decoded JPEG XL frame. The samples are interleaved and
+/// normalized to `[0.0, 1.0]`.
+pub(crate) struct Frame {
+    pub width: usize,
+    pub height: usize,
+    pub channels: usize,
+    pub samples: Vec<f32>,
+}
+
+impl Frame {
+    /// Decode the first frame of the JPEG XL codestream or container
+    /// in `data`.
+    pub fn decode(data: &[u8]) -> Result<Frame> {
+        let image = jxl_oxide::JxlImage::builder()
+            .read(std::io::Cursor::new(data))
+            .map_err(|err| {
+                log::error!("JPEG XL header error: {err}");
+                Error::Decompression(err.to_string())
+            })?;
+        let render = image.render_frame(0).map_err(|err| {
+            log::error!("JPEG XL decoding error: {err}");
+            Error::Decompression(err.to_string())
+        })?;
+        let buffer = render.image_all_channels();
+
+        Ok(Frame {
+            width: buffer.width(),
+            height: buffer.height(),
+            channels: buffer.channels(),
+            samples: buffer.buf().to_vec(),
+        })
+    }
+
+    /// Convert to a RGB8 pixmap. Alpha is dropped and grey is expanded.
+    pub fn to_rgb8(&self) -> Vec<u8> {
+        let mut rgb = Vec::with_capacity(self.width * self.height * 3);
+        for pixel in self.samples.chunks_exact(self.channels) {
+            let to_u8 = |v: f32| (v * 255.0).round().clamp(0.0, 255.0) as u8;
+            if self.channels < 3 {
+                let v = to_u8(pixel[0]);
+                rgb.extend_from_slice(&[v, v, v]);
+            } else {
+                rgb.extend(pixel[..3].iter().map(|v| to_u8(*v)));
+            }
+        }
+        rgb
+    }
+}
+
+/// Scale the normalized `src` samples to `max` into `dest`.
+fn scale_row(src: &[f32], max: f32, dest: &mut [u16]) {
+    dest.iter_mut()
+        .zip(src.iter())
+        .for_each(|(d, s)| *d = (s * max).round().clamp(0.0, max) as u16);
+}
+
+/// Decode a single JPEG XL raw frame, either the whole image or a
+/// tile, into the `rows` of the output. The raw data is either a CFA
+/// with a single component, or LinearRaw with `channels`
+/// components, interleaved. The samples are one stream with `stride`
+/// pixels per row of the output, whatever the frame width.
+fn decode_into(
+    data: &[u8],
+    max: f32,
+    channels: usize,
+    rows: &mut [&mut [u16]],
+    stride: usize,
+) -> Result<()> {
+    let frame = Frame::decode(data)?;
+    if frame.channels != channels {
+        log::error!(
+            "JPEG XL raw with {} channels, expected {channels}",
+            frame.channels
+        );
+        return Err(Error::NotSupported);
+    }
+    scale_into(
+        &frame.samples,
+        max,
+        &mut RowSpans::new(rows, stride * channels),
+    );
+
+    Ok(())
+}
+
+/// Scale the normalized `src` samples to `max` into `rows`.
+fn scale_into(mut src: &[f32], max: f32, rows: &mut RowSpans) {
+    while !src.is_empty() {
+        let (span, n) = rows.next_span(src.len());
+        if let Some(span) = span {
+            scale_row(&src[..span.len()], max, span);
+        }
+        src = &src[n..];
+    }
+}
+
+/// Decompress the JPEG XL compressed `rawdata`. Tiles are decoded in
+/// parallel in place in the final buffer. A tile that fails is left
+/// black, unless all do.
+pub(crate) fn decompress(rawdata: RawImage) -> Result<RawImage> {
+    let width = rawdata.width() as usize;
+    let height = rawdata.height() as usize;
+    if width == 0 || height == 0 {
+        log::error!("Invalid dimensions for JPEG XL: {width}x{height}");
+        return Err(Error::InvalidFormat);
+    }
+    let bpc = match rawdata.bpc() {
+        bpc @ 1..=16 => bpc,
+        _ => 16,
+    };
+    let max = ((1_u32 << bpc) - 1) as f32;
+    let channels = match rawdata.photometric_interpretation() {
+        exif::PhotometricInterpretation::LinearRaw => 3,
+        _ => 1,
+    };
+    let row_len = width * channels;
+    let mut data = vec![0_u16; row_len * height];
+
+    if let Some(tiles) = rawdata.tile_data() {
+        let (tile_width, tile_height) = rawdata.tile_size().ok_or(Error::InvalidFormat)?;
+        let spans = TiledLJpeg::tile_spans(
+            &mut data,
+            row_len,
+            tile_width as usize * channels,
+            tile_height as usize,
+        );
+        if spans.len() != tiles.len() {
+            log::warn!("Expected {} tiles, got {}", spans.len(), tiles.len());
+        }
+        let decoded = tiles
+            .iter()
+            .take(spans.len())
+            .filter(|tile| !tile.is_empty())
+            .count();
+        let failed: usize = tiles
+            .par_iter()
+            .zip(spans.into_par_iter())
+            .map(|(tile, mut rows)| {
+                if tile.is_empty() {
+                    // Dropped by `RawImage::retain_tiles()`.
+                    0
+                } else if let Err(err) =
+                    decode_into(tile, max, channels, &mut rows, tile_width as usize)
+                {
+                    log::error!("JPEG XL tile decompression failed: {err}");
+                    1
+                } else {
+                    0
+                }
+            })
+            .sum();
+        check_failed_tiles(failed, decoded)?;
+    } else if let Some(buffer) = rawdata.data8() {
+        let mut rows: Vec<&mut [u16]> = data.chunks_mut(row_len).collect();
+        decode_into(buffer, max, channels, &mut rows, width)?;
+    } else {
+        log::error!("No data to decompress JPEG XL");
+        return Ok(rawdata);
+    }
+
+    let mut rawdata = rawdata.replace_data(data);
+    rawdata.set_data_type(DataType::Raw);
+
+    Ok(rawdata)
+}
+
+#[cfg(test)]
+mod test {
+    use super::{decompress, scale_into, scale_row, Frame};
+    use crate::bitmap::Bitmap;
+    use crate::decompress::tiled::{RowSpans, TiledLJpeg};
+    use crate::mosaic::Pattern;
+    use crate::tiff::exif;
+    use crate::{DataType, RawImage};
+
+    /// The 12 bits samples of the `test/jxl-*12.jxl` fixtures,
+    /// interleaved. Channel `c` of pixel `i` is `1024 + (331c + 97i) % 1024`.
+    fn fixture_samples(pixels: usize, channels: usize) -> Vec<u16> {
+        (0..pixels * channels)
+            .map(|n| 1024 + ((n % channels) * 331 + (n / channels) * 97) as u16 % 1024)
+            .collect()
+    }
+
+    #[test]
+    fn test_decompress() {
+        let data = std::fs::read("test/jxl-grey12.jxl").expect("Couldn't read file");
+        let frame = Frame::decode(&data).expect("JPEG XL decoding failed");
+        assert_eq!((frame.width, frame.height, frame.channels), (6, 4, 1));
+
+        let rawdata = RawImage::with_data8(6, 4, 12, DataType::CompressedRaw, data, Pattern::Rggb);
+        let rawdata = decompress(rawdata).expect("Decompression failed");
+        assert_eq!(rawdata.data16(), Some(fixture_samples(6 * 4, 1).as_slice()));
+
+        // LinearRaw has its 3 channels interleaved.
+        let data = std::fs::read("test/jxl-rgb12.jxl").expect("Couldn't read file");
+        let mut rawdata =
+            RawImage::with_data8(4, 2, 12, DataType::CompressedRaw, data, Pattern::Empty);
+        rawdata.set_photometric_interpretation(exif::PhotometricInterpretation::LinearRaw);
+        let rawdata = decompress(rawdata).expect("Decompression failed");
+        assert_eq!(rawdata.data16(), Some(fixture_samples(4 * 2, 3).as_slice()));
+    }
+
+    #[test]
+    fn test_scale_row() {
+        let mut dest = [0_u16; 4];
+        scale_row(&[0.0, 0.5, 1.0, 1.5], 4095.0, &mut dest);
+        assert_eq!(dest, [0, 2048, 4095, 4095]);
+
+        // A 4 x 2 frame for 2 x 4 tiles, the right one partial.
+        let mut buffer = vec![0_u16; 3 * 4];
+        let mut spans = TiledLJpeg::tile_spans(&mut buffer, 3, 2, 4);
+        let src: Vec<f32> = (1..=8).map(|v| v as f32 / 10.0).collect();
+        scale_into(&src, 10.0, &mut RowSpans::new(&mut spans[1], 2));
+        drop(spans);
+        #[rustfmt::skip]
+        assert_eq!(buffer, [0, 0, 1, 0, 0, 3, 0, 0, 5, 0, 0, 7]);
+    }
+
+    #[test]
+    fn test_to_rgb8() {
+        let frame = Frame {
+            width: 2,
+            height: 1,
+            channels: 4,
+            samples: vec![1.0, 0.0, 0.5, 1.0, 0.0, 1.0, 0.0, 0.0],
+        };
+        assert_eq!(frame.to_rgb8(), vec![255, 0, 128, 0, 255, 0]);
+
+        let frame = Frame {
+            width: 2,
+            height: 1,
+            channels: 1,
+            samples: vec![1.0, 0.0],
+        };
+        assert_eq!(frame.to_rgb8(), vec![255, 255, 255, 0, 0, 0]);
+    }
+}
@@ -58,7 +58,9 @@
 
 use super::bit_reader::{BitReader, LJpegBitReader};
 use super::sliced_buffer::SlicedBuffer;
+use super::tiled::RowSpans;
 use crate::bitmap::ImageBuffer;
+use crate::rows::RowSink;
 use crate::{Error, Result};
 
 const M_SOF0: u8 = 0xc0;
@@ -107,7 +109,8 @@ const MIN_PRECISION_BITS: u8 = 2;
 const MAX_PRECISION_BITS: u8 = 16;
 
 type ComponentType = u16;
-type Mcu = Vec<ComponentType>;
+/// One MCU. At most 4 components per scan.
+type Mcu = [ComponentType; 4];
 
 /// A tile
 pub struct Tile {
@@ -173,21 +176,7 @@ impl LJpeg {
         let mut dc_info = DecompressInfo::default();
 
         let mut bit_reader = LJpegBitReader::new(buffer);
-        self.read_file_header(&mut dc_info, &mut bit_reader)?;
-        self.read_scan_header(&mut dc_info, &mut bit_reader)?;
-
-        if dc_info.image_width == 0 || dc_info.image_height == 0 {
-            return Err(Error::JpegFormat(format!(
-                "LJPEG: incorrect dimensions {}x{}",
-                dc_info.image_width, dc_info.image_height
-            )));
-        }
-        if dc_info.num_components > 4 {
-            return Err(Error::JpegFormat(format!(
-                "LJPEG: unsupported number of components {}",
-                dc_info.num_components
-            )));
-        }
+        self.read_headers(&mut dc_info, &mut bit_reader)?;
         let bpc = dc_info.data_precision;
         let mut output: SlicedBuffer<ComponentType> = SlicedBuffer::new(
             dc_info.image_width as u32 * dc_info.num_components as u32,
@@ -252,6 +241,57 @@ impl LJpeg {
         })
     }
 
+    /// Decompress the LJPEG stream of a tile straight into `rows`, the
+    /// row spans of the destination of the tile. The decoded values are
+    /// one stream, with `stride` values per row of the tile, whatever
+    /// the LJPEG row width. The values falling outside of the spans are
+    /// dropped: edge tiles are usually larger than the image.
+    pub(crate) fn decompress_into(
+        &mut self,
+        buffer: &[u8],
+        rows: &mut [&mut [u16]],
+        stride: usize,
+    ) -> Result<()> {
+        let mut dc_info = DecompressInfo::default();
+
+        let mut bit_reader = LJpegBitReader::new(buffer);
+        self.read_headers(&mut dc_info, &mut bit_reader)?;
+        self.decoder_struct_init(&mut dc_info)?;
+        self.huff_decoder_init(&mut dc_info, &mut bit_reader)?;
+        self.decode_image(
+            &mut dc_info,
+            &mut bit_reader,
+            &mut RowSpans::new(rows, stride),
+        )
+    }
+
+    /// Decompress the LJPEG stream into `rows`, a band at a time,
+    /// without holding the image. Return the width, height and bits
+    /// per component. Canon slices and the 4 components CR2 layout
+    /// aren't row ordered and are unsupported.
+    pub(crate) fn decompress_rows(
+        &mut self,
+        buffer: &[u8],
+        rows: &mut RowSink,
+    ) -> Result<(u32, u32, u16)> {
+        let mut dc_info = DecompressInfo::default();
+
+        let mut bit_reader = LJpegBitReader::new(buffer);
+        self.read_headers(&mut dc_info, &mut bit_reader)?;
+        if self.slices.is_some() || (self.is_raw && dc_info.num_components == 4) {
+            log::error!("LJPEG: can't decompress slices by rows");
+            return Err(Error::NotSupported);
+        }
+        let width = dc_info.image_width as u32 * dc_info.num_components as u32;
+        let height = dc_info.image_height as u32;
+        rows.start(width as usize);
+        self.decoder_struct_init(&mut dc_info)?;
+        self.huff_decoder_init(&mut dc_info, &mut bit_reader)?;
+        self.decode_image(&mut dc_info, &mut bit_reader, rows)?;
+
+        Ok((width, height, dc_info.data_precision as u16))
+    }
+
     #[cfg(any(feature = "fuzzing", feature = "bench"))]
     /// Used to fuzz or bench the decompressor that is otherwise crate only.
     pub fn discard_decompress(&mut self, buffer: &[u8]) -> Result<()> {
@@ -278,6 +318,27 @@ impl LJpeg {
         ))
     }
 
+    /// Read the file and scan headers, and check the dimensions.
+    fn read_headers(&self, dc: &mut DecompressInfo, reader: &mut LJpegBitReader) -> Result<()> {
+        self.read_file_header(dc, reader)?;
+        self.read_scan_header(dc, reader)?;
+
+        if dc.image_width == 0 || dc.image_height == 0 {
+            return Err(Error::JpegFormat(format!(
+                "LJPEG: incorrect dimensions {}x{}",
+                dc.image_width, dc.image_height
+            )));
+        }
+        if dc.num_components > 4 {
+            return Err(Error::JpegFormat(format!(
+                "LJPEG: unsupported number of components {}",
+                dc.num_components
+            )));
+        }
+
+        Ok(())
+    }
+
     fn read_file_header(&self, dc: &mut DecompressInfo, reader: &mut LJpegBitReader) -> Result<()> {
         // Demand an SOI marker at the start of the file --- otherwise it's
         // probably not a JPEG file at all.
@@ -347,13 +408,17 @@ impl LJpeg {
 
         // Initialize mucROW1 and mcuROW2 which buffer two rows of
         // pixels for predictor calculation.
-        // XXX Turn this into a single buffer per row.
+        // The rows are reused across calls, so that a decompressor can
+        // decode many tiles without allocating.
         // XXX Currently this statically uses 4 components even if
         // XXX our use case is 2.
-        self.mcu_row.push(vec![]);
-        self.mcu_row[0].resize(dc.image_width as usize, vec![0; 4]);
-        self.mcu_row.push(vec![]);
-        self.mcu_row[1].resize(dc.image_width as usize, vec![0; 4]);
+        self.mcu_row.resize(2, vec![]);
+        for row in self.mcu_row.iter_mut() {
+            row.clear();
+            row.resize(dc.image_width as usize, [0; 4]);
+        }
+        self.cur_row = 0;
+        self.prev_row = 1;
 
         Ok(())
     }
@@ -392,11 +457,11 @@ impl LJpeg {
         Ok(())
     }
 
-    fn decode_image(
+    fn decode_image<O: RowOutput>(
         &mut self,
         dc: &mut DecompressInfo,
         reader: &mut LJpegBitReader,
-        output: &mut SlicedBuffer<ComponentType>,
+        output: &mut O,
     ) -> Result<()> {
         let image_width = dc.image_width;
         let num_col = image_width;
@@ -409,13 +474,7 @@ impl LJpeg {
         // turn this row into a previous row for later predictor
         // calculation.
         self.decode_first_row(dc, reader)?;
-        Self::pm_put_row(
-            &self.mcu_row[self.cur_row],
-            comps_in_scan,
-            num_col,
-            pt,
-            output,
-        );
+        output.put_row(&self.mcu_row[self.cur_row], comps_in_scan, num_col, pt)?;
         std::mem::swap(&mut self.cur_row, &mut self.prev_row);
 
         for _ in 1..num_row {
@@ -426,13 +485,7 @@ impl LJpeg {
 
                     // Reset predictors at restart
                     self.decode_first_row(dc, reader)?;
-                    Self::pm_put_row(
-                        &self.mcu_row[self.cur_row],
-                        comps_in_scan,
-                        num_col,
-                        pt,
-                        output,
-                    );
+                    output.put_row(&self.mcu_row[self.cur_row], comps_in_scan, num_col, pt)?;
                     std::mem::swap(&mut self.cur_row, &mut self.prev_row);
                     continue;
                 }
@@ -489,13 +542,7 @@ impl LJpeg {
                     }
                 }
             }
-            Self::pm_put_row(
-                &self.mcu_row[self.cur_row],
-                comps_in_scan,
-                num_col,
-                pt,
-                output,
-            );
+            output.put_row(&self.mcu_row[self.cur_row], comps_in_scan, num_col, pt)?;
             std::mem::swap(&mut self.cur_row, &mut self.prev_row);
         }
 
@@ -674,22 +721,60 @@ impl LJpeg {
             }
         }
     }
+}
+
+/// The destination of the decoded rows.
+trait RowOutput {
+    /// Output one row of pixels stored in `row_buf`.
+    fn put_row(&mut self, row_buf: &[Mcu], num_comp: u16, num_col: u16, pt: u8) -> Result<()>;
+}
 
-    /// Output one row of pixels stored in RowBuf.
-    fn pm_put_row(
-        row_buf: &[Mcu],
-        num_comp: u16,
-        num_col: u16,
-        pt: u8,
-        output: &mut SlicedBuffer<ComponentType>,
-    ) {
+impl RowOutput for SlicedBuffer<ComponentType> {
+    fn put_row(&mut self, row_buf: &[Mcu], num_comp: u16, num_col: u16, pt: u8) -> Result<()> {
         for col in 0..num_col {
-            output.extend(
+            self.extend(
                 row_buf[col as usize][0..num_comp as usize]
                     .iter()
                     .map(|v| v << pt),
             );
         }
+
+        Ok(())
+    }
+}
+
+impl RowOutput for RowSink<'_> {
+    fn put_row(&mut self, row_buf: &[Mcu], num_comp: u16, num_col: u16, pt: u8) -> Result<()> {
+        let values = row_buf[0..num_col as usize]
+            .iter()
+            .flat_map(|mcu| mcu[0..num_comp as usize].iter().map(|v| v << pt));
+        self.rows_mut()
+            .iter_mut()
+            .zip(values)
+            .for_each(|(out, v)| *out = v);
+        self.advance(1)
+    }
+}
+
+impl RowOutput for RowSpans<'_, '_> {
+    fn put_row(&mut self, row_buf: &[Mcu], num_comp: u16, num_col: u16, pt: u8) -> Result<()> {
+        let mut values = row_buf[0..num_col as usize]
+            .iter()
+            .flat_map(|mcu| mcu[0..num_comp as usize].iter().map(|v| v << pt));
+        let mut count = num_col as usize * num_comp as usize;
+        while count > 0 {
+            let (span, n) = self.next_span(count);
+            let mut chunk = values.by_ref().take(n);
+            if let Some(span) = span {
+                span.iter_mut()
+                    .zip(&mut chunk)
+                    .for_each(|(out, v)| *out = v);
+            }
+            chunk.for_each(drop);
+            count -= n;
+        }
+
+        Ok(())
     }
 }
 
@@ -1125,7 +1210,10 @@ fn extend(x: u16, s: u8) -> i32 {
 mod test {
     use std::io::Read;
 
+    use crate::mosaic::Pattern;
+    use crate::rows::{RowBand, RowSink};
     use crate::utils;
+    use crate::{DataType, RawImage};
 
     use super::LJpeg;
 
@@ -1156,5 +1244,48 @@ mod test {
         let crc = raw_checksum(buf);
 
         assert_eq!(crc, 0x20cc);
+
+        // Decompress into row spans and compare.
+        let width = rawdata.width as usize;
+        let mut buffer = vec![0_u16; width * rawdata.height as usize];
+        let mut rows: Vec<&mut [u16]> = buffer.chunks_mut(width).collect();
+        let mut decompressor = LJpeg::new(false);
+        assert!(decompressor
+            .decompress_into(&data, &mut rows, width)
+            .is_ok());
+        assert_eq!(buffer, rawdata.data);
+
+        // Reusing the decompressor must yield the same result.
+        buffer.fill(0);
+        let mut rows: Vec<&mut [u16]> = buffer.chunks_mut(width).collect();
+        assert!(decompressor
+            .decompress_into(&data, &mut rows, width)
+            .is_ok());
+        assert_eq!(buffer, rawdata.data);
+        assert_eq!(decompressor.mcu_row.len(), 2);
+
+        // Decompress in bands of rows.
+        let mut banded = vec![];
+        let mut callback = |band: &RowBand| {
+            assert!(band.height <= 16);
+            banded.extend_from_slice(band.data);
+            Ok(())
+        };
+        let mut rows = RowSink::new(16, &mut callback);
+        assert_eq!(
+            decompressor.decompress_rows(&data, &mut rows).ok(),
+            Some((rawdata.width, rawdata.height, rawdata.bpc))
+        );
+        let image = RawImage::with_data16(
+            rawdata.width,
+            rawdata.height,
+            rawdata.bpc,
+            DataType::Raw,
+            vec![],
+            Pattern::Rggb,
+        );
+        assert!(rows.finish(image).is_ok());
+        drop(rows);
+        assert_eq!(banded, rawdata.data);
     }
 }
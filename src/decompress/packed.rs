@@ -0,0 +1,443 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * libopenraw - decompress/packed.rs
+ *
+ * Copyright (C) 2025 Hubert Figuière
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+//! Unpacking of packed 10, 12 and 14 bits rows.
+//!
+//! The kernels work on whole rows, over fixed size groups of bytes so
+//! that the compiler can vectorize them. They are dispatched at runtime
+//! with `multiversion`. Rows are independent and unpacked in parallel.
+
+use multiversion::multiversion;
+use rayon::prelude::*;
+
+use crate::container::Endian;
+use crate::rows::RowSink;
+use crate::tiff;
+use crate::{Error, Result};
+
+/// The layout of the packed data in a row.
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub(crate) enum Packing {
+    /// 10 bits, big endian bit stream.
+    Be10,
+    /// 14 bits, big endian bit stream.
+    Be14,
+    /// 12 bits big endian. `true` if one padding byte follows every
+    /// 15 bytes (Nikon).
+    Be12(bool),
+    /// 12 bits little endian. `true` if one padding byte follows every
+    /// 15 bytes (Olympus, Panasonic).
+    Le12(bool),
+}
+
+impl Packing {
+    /// Determine the packing from `bpc` and `compression`. `endian`
+    /// is used when compression is `None`.
+    pub(crate) fn new(bpc: u16, compression: tiff::Compression, endian: Endian) -> Result<Packing> {
+        match bpc {
+            10 => Ok(Packing::Be10),
+            14 => Ok(Packing::Be14),
+            12 => match compression {
+                tiff::Compression::NikonPack => Ok(Packing::Be12(true)),
+                tiff::Compression::PentaxPack => Ok(Packing::Be12(false)),
+                tiff::Compression::None => match endian {
+                    Endian::Little => Ok(Packing::Le12(false)),
+                    Endian::Big => Ok(Packing::Be12(false)),
+                    Endian::Unset => Err(Error::InvalidParam),
+                },
+                tiff::Compression::Olympus | tiff::Compression::PanasonicRaw1 => {
+                    Ok(Packing::Le12(true))
+                }
+                _ => {
+                    log::error!("Unsupported compression {:?} for 12 bits", compression);
+                    Err(Error::InvalidFormat)
+                }
+            },
+            _ => {
+                log::warn!("Invalid BPC {}", bpc);
+                Err(Error::InvalidFormat)
+            }
+        }
+    }
+
+    /// Number of values unpacked from a row of `row_len` bytes
+    /// holding `width` pixels. Error if the row can't be unpacked.
+    pub(crate) fn row_values(&self, row_len: usize, width: usize) -> Result<usize> {
+        match *self {
+            Packing::Be10 | Packing::Be14 => {
+                let bits = if *self == Packing::Be10 { 10 } else { 14 };
+                if row_len * 8 < width * bits {
+                    return Err(Error::Decompression(format!(
+                        "{width} pixels don't fit in {row_len} bytes for {self:?}."
+                    )));
+                }
+                Ok(width)
+            }
+            Packing::Be12(pad) | Packing::Le12(pad) => {
+                let pad = pad as usize;
+                if pad != 0 && (row_len % 16) != 0 {
+                    log::error!("{:?} incorrect padding.", self);
+                    return Err(Error::Decompression(format!("{self:?} incorrect padding.")));
+                }
+                let rest = row_len % (15 + pad);
+                if (rest % 3) != 0 {
+                    log::error!("{:?} incorrect rest.", self);
+                    return Err(Error::Decompression(format!("{self:?} incorrect rest.")));
+                }
+                Ok(row_len / (15 + pad) * 10 + rest / 3 * 2)
+            }
+        }
+    }
+
+    /// Unpack one row. `out` must be `row_values()` long.
+    fn unpack_row(&self, input: &[u8], out: &mut [u16]) {
+        match *self {
+            Packing::Be10 => unpack_be10(input, out),
+            Packing::Be14 => unpack_be14(input, out),
+            Packing::Be12(false) => unpack_be12(input, out),
+            Packing::Be12(true) => unpack_be12_padded(input, out),
+            Packing::Le12(false) => unpack_le12(input, out),
+            Packing::Le12(true) => unpack_le12_padded(input, out),
+        }
+    }
+}
+
+/// Unpack the rows of `row_len` bytes from `input` into `out`, in
+/// parallel. `width` is the number of pixels in a row. Trailing bytes
+/// that don't make a whole row are ignored.
+///
+/// Return the number of values written.
+pub(crate) fn unpack_rows(
+    packing: Packing,
+    input: &[u8],
+    row_len: usize,
+    width: usize,
+    out: &mut [u16],
+) -> Result<usize> {
+    let row_values = packing.row_values(row_len, width)?;
+    if row_len == 0 || row_values == 0 {
+        return Ok(0);
+    }
+    let rows = input.len() / row_len;
+    if out.len() < rows * row_values {
+        return Err(Error::BufferTooSmall);
+    }
+    input
+        .par_chunks_exact(row_len)
+        .zip(out.par_chunks_exact_mut(row_values))
+        .for_each(|(row, out)| packing.unpack_row(row, out));
+
+    Ok(rows * row_values)
+}
+
+/// Unpack the rows of `row_len` bytes from `input` into `rows`, a band
+/// at a time. See `unpack_rows()`.
+pub(crate) fn unpack_rows_to(
+    packing: Packing,
+    mut input: &[u8],
+    row_len: usize,
+    width: usize,
+    rows: &mut RowSink,
+) -> Result<()> {
+    let row_values = packing.row_values(row_len, width)?;
+    rows.start(row_values);
+    if row_len == 0 || row_values == 0 {
+        return Ok(());
+    }
+    while input.len() >= row_len {
+        let n = std::cmp::min(rows.rows_left(), input.len() / row_len);
+        let (band, rest) = input.split_at(n * row_len);
+        unpack_rows(packing, band, row_len, width, rows.rows_mut())?;
+        rows.advance(n)?;
+        input = rest;
+    }
+
+    Ok(())
+}
+
+/// Extract `n` bits at bit position `pos` of a big endian bit stream.
+fn be_bits_at(input: &[u8], pos: usize, n: usize) -> u16 {
+    let mut v = 0_u32;
+    for bit in pos..pos + n {
+        v = (v << 1) | ((input[bit / 8] >> (7 - bit % 8)) & 1) as u32;
+    }
+    v as u16
+}
+
+/// 10 bits: 5 bytes make 4 values.
+#[multiversion(targets("x86_64+avx+avx2", "x86_64+ssse3", "aarch64+neon"))]
+fn unpack_be10(input: &[u8], out: &mut [u16]) {
+    let groups = out.len() / 4;
+    for (i, o) in input
+        .chunks_exact(5)
+        .zip(out.chunks_exact_mut(4))
+        .take(groups)
+    {
+        let v = ((i[0] as u64) << 32)
+            | ((i[1] as u64) << 24)
+            | ((i[2] as u64) << 16)
+            | ((i[3] as u64) << 8)
+            | i[4] as u64;
+        o[0] = ((v >> 30) & 0x3ff) as u16;
+        o[1] = ((v >> 20) & 0x3ff) as u16;
+        o[2] = ((v >> 10) & 0x3ff) as u16;
+        o[3] = (v & 0x3ff) as u16;
+    }
+    for (idx, o) in out.iter_mut().enumerate().skip(groups * 4) {
+        *o = be_bits_at(input, idx * 10, 10);
+    }
+}
+
+/// 14 bits: 7 bytes make 4 values.
+#[multiversion(targets("x86_64+avx+avx2", "x86_64+ssse3", "aarch64+neon"))]
+fn unpack_be14(input: &[u8], out: &mut [u16]) {
+    let groups = out.len() / 4;
+    for (i, o) in input
+        .chunks_exact(7)
+        .zip(out.chunks_exact_mut(4))
+        .take(groups)
+    {
+        let v = ((i[0] as u64) << 48)
+            | ((i[1] as u64) << 40)
+            | ((i[2] as u64) << 32)
+            | ((i[3] as u64) << 24)
+            | ((i[4] as u64) << 16)
+            | ((i[5] as u64) << 8)
+            | i[6] as u64;
+        o[0] = ((v >> 42) & 0x3fff) as u16;
+        o[1] = ((v >> 28) & 0x3fff) as u16;
+        o[2] = ((v >> 14) & 0x3fff) as u16;
+        o[3] = (v & 0x3fff) as u16;
+    }
+    for (idx, o) in out.iter_mut().enumerate().skip(groups * 4) {
+        *o = be_bits_at(input, idx * 14, 14);
+    }
+}
+
+/// 12 bits big endian: 3 bytes make 2 values.
+#[inline(always)]
+fn be12(i: &[u8], o: &mut [u16]) {
+    let i0 = i[0] as u16;
+    let i1 = i[1] as u16;
+    let i2 = i[2] as u16;
+    o[0] = (i0 << 4) | (i1 >> 4);
+    o[1] = ((i1 & 0xf) << 8) | i2;
+}
+
+/// 12 bits little endian: 3 bytes make 2 values.
+#[inline(always)]
+fn le12(i: &[u8], o: &mut [u16]) {
+    let b1 = i[0] as u16;
+    let b2 = i[1] as u16;
+    let b3 = i[2] as u16;
+    o[0] = ((b2 & 0xf) << 8) | b1;
+    o[1] = (b3 << 4) | (b2 >> 4);
+}
+
+#[multiversion(targets("x86_64+avx+avx2", "x86_64+ssse3", "aarch64+neon"))]
+fn unpack_be12(input: &[u8], out: &mut [u16]) {
+    for (i, o) in input.chunks_exact(3).zip(out.chunks_exact_mut(2)) {
+        be12(i, o);
+    }
+}
+
+#[multiversion(targets("x86_64+avx+avx2", "x86_64+ssse3", "aarch64+neon"))]
+fn unpack_le12(input: &[u8], out: &mut [u16]) {
+    for (i, o) in input.chunks_exact(3).zip(out.chunks_exact_mut(2)) {
+        le12(i, o);
+    }
+}
+
+/// 16 bytes, the last one being padding, make 10 values.
+#[multiversion(targets("x86_64+avx+avx2", "x86_64+ssse3", "aarch64+neon"))]
+fn unpack_be12_padded(input: &[u8], out: &mut [u16]) {
+    for (i, o) in input.chunks_exact(16).zip(out.chunks_exact_mut(10)) {
+        for (i, o) in i[..15].chunks_exact(3).zip(o.chunks_exact_mut(2)) {
+            be12(i, o);
+        }
+    }
+}
+
+/// 16 bytes, the last one being padding, make 10 values.
+#[multiversion(targets("x86_64+avx+avx2", "x86_64+ssse3", "aarch64+neon"))]
+fn unpack_le12_padded(input: &[u8], out: &mut [u16]) {
+    for (i, o) in input.chunks_exact(16).zip(out.chunks_exact_mut(10)) {
+        for (i, o) in i[..15].chunks_exact(3).zip(o.chunks_exact_mut(2)) {
+            le12(i, o);
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::{unpack_rows, unpack_rows_to, Packing};
+    use crate::container::Endian;
+    use crate::decompress::{unpack_be12to16, unpack_bento16, unpack_le12to16};
+    use crate::mosaic::Pattern;
+    use crate::rows::{RowBand, RowSink};
+    use crate::tiff;
+    use crate::{DataType, RawImage};
+
+    /// Fill a buffer with pseudo random bytes.
+    fn random_bytes(len: usize, seed: u32) -> Vec<u8> {
+        let mut state = seed | 1;
+        (0..len)
+            .map(|_| {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                (state >> 24) as u8
+            })
+            .collect()
+    }
+
+    /// Unpack a row with the scalar code.
+    fn scalar_row(packing: Packing, input: &[u8], width: usize) -> crate::Result<Vec<u16>> {
+        let mut out = vec![];
+        match packing {
+            Packing::Be10 => unpack_bento16(input, 10, width, &mut out),
+            Packing::Be14 => unpack_bento16(input, 14, width, &mut out),
+            Packing::Be12(pad) => unpack_be12to16(
+                input,
+                &mut out,
+                if pad {
+                    tiff::Compression::NikonPack
+                } else {
+                    tiff::Compression::None
+                },
+            ),
+            Packing::Le12(pad) => unpack_le12to16(
+                input,
+                &mut out,
+                if pad {
+                    tiff::Compression::Olympus
+                } else {
+                    tiff::Compression::None
+                },
+            ),
+        }
+        .map(|_| out)
+    }
+
+    /// Row length in bytes like `unpack_from_reader` calculate it.
+    fn row_len(packing: Packing, width: usize) -> usize {
+        match packing {
+            Packing::Be10 => width / 4 * 5,
+            Packing::Be14 => width / 4 * 7,
+            Packing::Be12(true) | Packing::Le12(true) => width / 2 * 3 + width / 10,
+            Packing::Be12(false) | Packing::Le12(false) => width / 2 * 3,
+        }
+    }
+
+    #[test]
+    fn test_packing_new() {
+        use tiff::Compression;
+
+        assert_eq!(
+            Packing::new(12, Compression::NikonPack, Endian::Little).unwrap(),
+            Packing::Be12(true)
+        );
+        assert_eq!(
+            Packing::new(12, Compression::None, Endian::Little).unwrap(),
+            Packing::Le12(false)
+        );
+        assert_eq!(
+            Packing::new(12, Compression::PanasonicRaw1, Endian::Big).unwrap(),
+            Packing::Le12(true)
+        );
+        assert_eq!(
+            Packing::new(14, Compression::None, Endian::Big).unwrap(),
+            Packing::Be14
+        );
+        assert!(Packing::new(16, Compression::None, Endian::Big).is_err());
+    }
+
+    #[test]
+    fn test_unpack_equivalence() {
+        let packings = [
+            Packing::Be10,
+            Packing::Be14,
+            Packing::Be12(false),
+            Packing::Be12(true),
+            Packing::Le12(false),
+            Packing::Le12(true),
+        ];
+        let widths = (1..=160).chain([4288, 6032, 6048, 8256]);
+        for packing in packings {
+            for width in widths.clone() {
+                for extra in 0..3 {
+                    // Also check with trailing bytes in the row.
+                    let len = row_len(packing, width) + extra;
+                    let input = random_bytes(len, (width * 3 + extra) as u32);
+                    let expected = scalar_row(packing, &input, width);
+                    let values = packing.row_values(len, width);
+                    assert_eq!(
+                        expected.is_ok(),
+                        values.is_ok(),
+                        "{packing:?} width {width} len {len}"
+                    );
+                    if let Ok(expected) = expected {
+                        let mut out = vec![0_u16; values.unwrap()];
+                        let written = unpack_rows(packing, &input, len, width, &mut out);
+                        assert!(written.is_ok());
+                        assert_eq!(written.unwrap(), expected.len());
+                        assert_eq!(out, expected, "{packing:?} width {width} len {len}");
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_unpack_rows() {
+        let width = 320;
+        let height = 300;
+        let packing = Packing::Be12(true);
+        let len = row_len(packing, width);
+        let input = random_bytes(len * height, 42);
+
+        let mut out = vec![0_u16; width * height];
+        let written = unpack_rows(packing, &input, len, width, &mut out);
+        assert_eq!(written.unwrap(), width * height);
+        for (row, out) in input.chunks(len).zip(out.chunks(width)) {
+            assert_eq!(out, scalar_row(packing, row, width).unwrap().as_slice());
+        }
+
+        let mut out = vec![0_u16; width * height - 1];
+        assert!(unpack_rows(packing, &input, len, width, &mut out).is_err());
+
+        // In bands.
+        let mut banded = vec![];
+        let mut callback = |band: &RowBand| {
+            assert!(band.height <= 64 && band.row_len == width);
+            banded.extend_from_slice(band.data);
+            Ok(())
+        };
+        let mut rows = RowSink::new(64, &mut callback);
+        assert!(unpack_rows_to(packing, &input, len, width, &mut rows).is_ok());
+        let rawdata = RawImage::with_data16(320, 300, 12, DataType::Raw, vec![], Pattern::Rggb);
+        assert!(rows.finish(rawdata).is_ok());
+        drop(rows);
+        out.push(0);
+        unpack_rows(packing, &input, len, width, &mut out).unwrap();
+        assert_eq!(banded, out);
+    }
+}
@@ -24,9 +24,77 @@
 use rayon::prelude::*;
 
 use crate::bitmap::Bitmap;
-use crate::{DataType, RawImage, Result};
+use crate::{DataType, Error, RawImage, Result};
 
-use super::ljpeg::{LJpeg, Tile};
+use super::ljpeg::LJpeg;
+
+thread_local! {
+    /// The tile decompressor of the worker thread. It is reused for
+    /// all the tiles the thread decodes, so that its row buffers are
+    /// only allocated once.
+    // Tiles should be fine to have `is_raw` set to false.
+    static TILE_DECOMPRESSOR: std::cell::RefCell<LJpeg> =
+        std::cell::RefCell::new(LJpeg::new(false));
+}
+
+/// The row spans of a tile in a bigger buffer, to output the decoded
+/// tile. The decoded values are one stream with `stride` values per
+/// tile row, like in dcraw `lossless_dng_load_raw()`. Rows past the
+/// last span, and values past the end of a span, are dropped.
+pub(crate) struct RowSpans<'a, 'b> {
+    rows: &'a mut [&'b mut [u16]],
+    /// The number of values per row of the tile.
+    stride: usize,
+    /// The position of the next value in the stream.
+    pos: usize,
+}
+
+impl<'a, 'b> RowSpans<'a, 'b> {
+    pub(crate) fn new(rows: &'a mut [&'b mut [u16]], stride: usize) -> Self {
+        RowSpans {
+            rows,
+            stride: std::cmp::max(stride, 1),
+            pos: 0,
+        }
+    }
+
+    /// Get the destination for the next `count` values of the stream,
+    /// at most up to the end of the tile row. Return it, if the values
+    /// aren't dropped, and the number of values it stands for. The
+    /// destination may be shorter at the edge of the image.
+    pub(crate) fn next_span(&mut self, count: usize) -> (Option<&mut [u16]>, usize) {
+        let row = self.pos / self.stride;
+        let col = self.pos % self.stride;
+        let n = std::cmp::min(count, self.stride - col);
+        self.pos += n;
+        let span = self
+            .rows
+            .get_mut(row)
+            .filter(|span| col < span.len())
+            .map(|span| {
+                let end = std::cmp::min(col + n, span.len());
+                &mut span[col..end]
+            });
+
+        (span, n)
+    }
+}
+
+/// Check the outcome of decoding `decoded` tiles, `failed` of which
+/// failed. The failed tiles are left black in the image, it is only
+/// an error if none could be decoded.
+pub(crate) fn check_failed_tiles(failed: usize, decoded: usize) -> Result<()> {
+    if failed == 0 {
+        Ok(())
+    } else if failed == decoded {
+        Err(Error::Decompression(format!(
+            "All {failed} tiles failed to decompress"
+        )))
+    } else {
+        log::warn!("{failed} of {decoded} tiles failed to decompress, left black");
+        Ok(())
+    }
+}
 
 pub struct TiledLJpeg {}
 
@@ -35,49 +103,45 @@ impl TiledLJpeg {
         TiledLJpeg {}
     }
 
-    /// Combine tiles into the final buffer. `width` and `height` are the final dimensions.
-    fn combine_tiles(width: usize, height: usize, tiles: &[Option<Tile>]) -> Vec<u16> {
-        let data_size = width * height;
-        let mut buffer = uninit_vec!(data_size);
-
-        let mut first_row = 0_usize;
-        let mut first_col = 0_usize;
-
-        let buf_slice = buffer.as_mut_slice();
-        for tile in tiles {
-            if tile.is_none() {
-                log::error!("tile is none");
-                continue;
-            }
-            let tile = tile.as_ref().unwrap();
-            // Edge tiles might be wider than necessary, ie width
-            // isn't a multiple of the image width.
-            let row_len = std::cmp::min(tile.u_width as usize, width - first_col);
-            for r in 0..tile.u_height as usize {
-                if first_row + r >= height {
-                    // We are past the last row. This is because the
-                    // tiles aren't necessarily a multiple of the
-                    // image size. Mostly in DNG converted.
-                    break;
-                }
-                let pos = (first_row + r) * width + first_col;
-                let tile_pos = r * tile.u_width as usize;
-                buf_slice[pos..][..row_len].copy_from_slice(&tile.buf[tile_pos..][..row_len]);
-            }
-            first_col += tile.u_width as usize;
-            if first_col >= width {
-                first_col = 0;
-                first_row += tile.u_height as usize;
-                if first_row >= height {
-                    break;
+    /// Split `buffer`, an image `width` pixels wide, into the row spans
+    /// of each tile of `tile_width` x `tile_height`. The tiles are in
+    /// file order, ie left to right, top to bottom. Edge tiles get
+    /// shorter spans, or fewer rows, as the image dimensions aren't
+    /// necessarily a multiple of the tile size.
+    pub(super) fn tile_spans(
+        buffer: &mut [u16],
+        width: usize,
+        tile_width: usize,
+        tile_height: usize,
+    ) -> Vec<Vec<&mut [u16]>> {
+        if width == 0 || tile_width == 0 || tile_height == 0 {
+            return vec![];
+        }
+        let tiles_across = (width + tile_width - 1) / tile_width;
+        let mut spans = vec![];
+        for band in buffer.chunks_mut(width * tile_height) {
+            let mut band_spans: Vec<Vec<&mut [u16]>> = (0..tiles_across)
+                .map(|_| Vec::with_capacity(tile_height))
+                .collect();
+            for mut row in band.chunks_mut(width) {
+                for tile in band_spans.iter_mut() {
+                    let len = std::cmp::min(tile_width, row.len());
+                    let (span, rest) = std::mem::take(&mut row).split_at_mut(len);
+                    tile.push(span);
+                    row = rest;
                 }
             }
+            spans.extend(band_spans);
         }
 
-        buffer
+        spans
     }
 
     /// Decompress the RawImage into a new RawImage.
+    ///
+    /// Each tile is decompressed in parallel directly at its place in
+    /// the final buffer. A tile that fails is left black, unless all
+    /// do. See `check_failed_tiles()`.
     pub fn decompress(
         &self,
         rawdata: RawImage,
@@ -85,38 +149,46 @@ impl TiledLJpeg {
     ) -> Result<RawImage> {
         if let Some(tiles) = rawdata.tile_data() {
             probe!(probe, "ljpeg.tiled", "true");
-            let tile_size = rawdata.tile_size();
-            let dec_tiles: Vec<Option<Tile>> = tiles
+            let (tile_width, tile_height) = rawdata.tile_size().ok_or(Error::InvalidFormat)?;
+            let width = rawdata.width() as usize;
+            let height = rawdata.height() as usize;
+            let mut data = vec![0_u16; width * height];
+
+            let spans =
+                Self::tile_spans(&mut data, width, tile_width as usize, tile_height as usize);
+            if spans.len() != tiles.len() {
+                log::warn!("Expected {} tiles, got {}", spans.len(), tiles.len());
+            }
+            let decoded = tiles
+                .iter()
+                .take(spans.len())
+                .filter(|tile| !tile.is_empty())
+                .count();
+            let failed: usize = tiles
                 .par_iter()
-                .map(|tile| {
+                .zip(spans.into_par_iter())
+                .map(|(tile, mut rows)| {
+                    if tile.is_empty() {
+                        // Dropped by `RawImage::retain_tiles()`.
+                        return 0;
+                    }
                     log::debug!("Decompressing tile");
-                    // Tiles should be fine to have `is_raw` set to false.
-                    let mut decompressor = LJpeg::new(false);
-                    decompressor
-                        .decompress_buffer(
+                    let result = TILE_DECOMPRESSOR.with(|decompressor| {
+                        decompressor.borrow_mut().decompress_into(
                             tile.as_slice(),
-                            true,
-                            #[cfg(feature = "probe")]
-                            &None,
+                            &mut rows,
+                            tile_width as usize,
                         )
-                        .ok()
+                    });
+                    if let Err(err) = result {
+                        log::error!("Tile decompression failed: {err}");
+                        1
+                    } else {
+                        0
+                    }
                 })
-                .map(|tile| {
-                    tile.map(|mut tile| {
-                        if let Some(tile_size) = tile_size {
-                            tile.u_width = tile_size.0;
-                            tile.u_height = tile_size.1;
-                        }
-                        tile
-                    })
-                })
-                .collect();
-
-            let data = Self::combine_tiles(
-                rawdata.width() as usize,
-                rawdata.height() as usize,
-                &dec_tiles,
-            );
+                .sum();
+            check_failed_tiles(failed, decoded)?;
 
             let mut rawdata = rawdata.replace_data(data);
             rawdata.set_data_type(DataType::Raw);
@@ -130,54 +202,143 @@ impl TiledLJpeg {
 
 #[cfg(test)]
 mod test {
+    use std::io::Read;
+
+    use super::{check_failed_tiles, TiledLJpeg};
+    use crate::bitmap::Bitmap;
+    use crate::decompress::ljpeg::LJpeg;
+    use crate::mosaic::Pattern;
+    use crate::{DataType, RawImage};
+
+    #[test]
+    fn test_tile_spans() {
+        let width = 5_usize;
+        let height = 5_usize;
+        let mut buffer = vec![0_u16; width * height];
+
+        let mut spans = TiledLJpeg::tile_spans(&mut buffer, width, 2, 2);
+        // 3 x 3 tiles, the right and bottom ones being partial.
+        assert_eq!(spans.len(), 9);
+        assert_eq!(spans[0].len(), 2);
+        assert_eq!(spans[0][0].len(), 2);
+        assert_eq!(spans[2][0].len(), 1);
+        assert_eq!(spans[6].len(), 1);
+        assert_eq!(spans[8].len(), 1);
+        assert_eq!(spans[8][0].len(), 1);
+        for (idx, tile) in spans.iter_mut().enumerate() {
+            for row in tile.iter_mut() {
+                row.fill(idx as u16 + 1);
+            }
+        }
 
-    use super::TiledLJpeg;
-    use crate::decompress::ljpeg::Tile;
+        #[rustfmt::skip]
+        assert_eq!(
+            buffer,
+            [
+                1, 1, 2, 2, 3,
+                1, 1, 2, 2, 3,
+                4, 4, 5, 5, 6,
+                4, 4, 5, 5, 6,
+                7, 7, 8, 8, 9,
+            ]
+        );
+    }
 
     #[test]
-    fn test_combine_tiles() {
-        let width = 4_usize;
-        let height = 4_usize;
-        let tiles = vec![
-            Some(Tile {
-                width: 2,
-                height: 2,
-                u_width: 2,
-                u_height: 2,
-                bpc: 16,
-                buf: vec![100; 4],
-            }),
-            Some(Tile {
-                width: 2,
-                height: 2,
-                u_width: 2,
-                u_height: 2,
-                bpc: 16,
-                buf: vec![200; 4],
-            }),
-            Some(Tile {
-                width: 2,
-                height: 2,
-                u_width: 2,
-                u_height: 2,
-                bpc: 16,
-                buf: vec![300; 4],
-            }),
-            Some(Tile {
-                width: 2,
-                height: 2,
-                u_width: 2,
-                u_height: 2,
-                bpc: 16,
-                buf: vec![400; 4],
-            }),
-        ];
-
-        let output = TiledLJpeg::combine_tiles(width, height, &tiles);
-        assert_eq!(output[0], 100);
-        assert_eq!(output[2], 200);
-        assert_eq!(output[4], 100);
-        assert_eq!(output[8], 300);
-        assert_eq!(output[10], 400);
+    fn test_tile_row_width() {
+        let mut data = Vec::<u8>::default();
+        std::fs::File::open("test/ljpegtest1.jpg")
+            .and_then(|mut io| io.read_to_end(&mut data))
+            .expect("Couldn't read");
+        let decoded = LJpeg::new(false)
+            .decompress(&data, &None)
+            .expect("Decompression failed");
+        // The LJPEG rows are 240 values wide: 2 components of 120.
+        assert_eq!((decoded.width, decoded.height), (240, 272));
+
+        // Tiles 120 wide: each LJPEG row is 2 tile rows. The image is
+        // 2 x 2 tiles, the right and bottom ones partial. The stream
+        // rows past the tile height are dropped.
+        let (tile_width, tile_height) = (120, 240);
+        let (width, height) = (127, 250);
+        let mut buffer = vec![0_u16; width * height];
+        let mut spans = TiledLJpeg::tile_spans(&mut buffer, width, tile_width, tile_height);
+        assert_eq!(spans.len(), 4);
+        for tile in spans.iter_mut().take(2) {
+            LJpeg::new(false)
+                .decompress_into(&data, tile, tile_width)
+                .expect("Tile decompression failed");
+        }
+        drop(spans);
+
+        for y in 0..tile_height {
+            let row = &buffer[y * width..][..width];
+            let tile_row = &decoded.data[y * tile_width..][..tile_width];
+            assert_eq!(&row[..tile_width], tile_row);
+            // The edge tile only gets the start of its rows.
+            assert_eq!(&row[tile_width..], &tile_row[..width - tile_width]);
+        }
+        assert!(buffer[tile_height * width..].iter().all(|v| *v == 0));
+    }
+
+    #[test]
+    fn test_failed_tiles() {
+        assert!(check_failed_tiles(0, 0).is_ok());
+        assert!(check_failed_tiles(1, 2).is_ok());
+        assert!(check_failed_tiles(2, 2).is_err());
+
+        let mut data = Vec::<u8>::default();
+        std::fs::File::open("test/ljpegtest1.jpg")
+            .and_then(|mut io| io.read_to_end(&mut data))
+            .expect("Couldn't read");
+        let decoded = LJpeg::new(false)
+            .decompress(&data, &None)
+            .expect("Decompression failed");
+
+        // The right tile is corrupt: it is left black.
+        let (tile_width, tile_height) = (120, 272);
+        let tiles = vec![data.clone(), vec![0; 16]];
+        let rawdata = RawImage::new_tiled(
+            240,
+            272,
+            16,
+            DataType::CompressedRaw,
+            tiles,
+            (tile_width as u32, tile_height as u32),
+            Pattern::Rggb,
+        );
+        let rawdata = TiledLJpeg::new()
+            .decompress(
+                rawdata,
+                #[cfg(feature = "probe")]
+                &None,
+            )
+            .expect("Decompression failed");
+        let buffer = rawdata.data16().expect("No data");
+        for (y, row) in buffer.chunks(240).enumerate() {
+            assert_eq!(
+                &row[..tile_width],
+                &decoded.data[y * tile_width..][..tile_width]
+            );
+            assert!(row[tile_width..].iter().all(|v| *v == 0));
+        }
+
+        // All the tiles are corrupt.
+        let rawdata = RawImage::new_tiled(
+            240,
+            272,
+            16,
+            DataType::CompressedRaw,
+            vec![vec![0; 16], vec![0; 16]],
+            (tile_width as u32, tile_height as u32),
+            Pattern::Rggb,
+        );
+        assert!(TiledLJpeg::new()
+            .decompress(
+                rawdata,
+                #[cfg(feature = "probe")]
+                &None,
+            )
+            .is_err());
     }
 }
@@ -21,14 +21,13 @@
 
 //! Epson ERF support.
 
-use std::collections::HashMap;
 use std::rc::Rc;
 
 use once_cell::unsync::OnceCell;
 
 use crate::camera_ids;
 use crate::camera_ids::vendor;
-use crate::colour::BuiltinMatrix;
+use crate::colour::{self, BuiltinMatrix};
 use crate::container::RawContainer;
 use crate::io::Viewer;
 use crate::rawfile::RawFileHandleType;
@@ -54,9 +53,9 @@ macro_rules! epson {
     };
 }
 
-lazy_static::lazy_static! {
-    /// EPSON built-in colour matrices
-    static ref MATRICES: [BuiltinMatrix; 3] = [
+/// EPSON built-in colour matrices
+#[rustfmt::skip]
+static MATRICES: [BuiltinMatrix; 3] = colour::sorted_matrices([
         BuiltinMatrix::new(
             epson!(RD1), 0, 0,
             [ 6827, -1878, -732, -8429, 16012, 2564, -704, 592, 7145 ]
@@ -69,15 +68,14 @@ lazy_static::lazy_static! {
             epson!(RD1X), 0, 0,
             [ 6827, -1878, -732, -8429, 16012, 2564, -704, 592, 7145 ]
         ),
-    ];
-
-    /// Make to TypeId map for ERF files.
-    static ref MAKE_TO_ID_MAP: tiff::MakeToIdMap = HashMap::from([
-        epson!("R-D1", RD1),
-        epson!("R-D1s", RD1S),
-        epson!("R-D1x", RD1X),
     ]);
-}
+
+/// Make to TypeId map for ERF files.
+static MAKE_TO_ID_MAP: tiff::MakeToIdMap<3> = tiff::MakeToIdMap::new([
+    epson!("R-D1", RD1),
+    epson!("R-D1s", RD1S),
+    epson!("R-D1x", RD1X),
+]);
 
 #[derive(Debug)]
 /// ERF RAW file support
@@ -224,7 +222,7 @@ impl RawFileImpl for ErfFile {
     }
 
     fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
+        self.builtin_colour_matrix(&MATRICES)
     }
 }
 
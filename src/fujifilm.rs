@@ -25,7 +25,6 @@ mod decompress;
 mod matrices;
 mod raf;
 
-use std::collections::HashMap;
 use std::convert::{TryFrom, TryInto};
 use std::io::{Seek, SeekFrom};
 use std::rc::Rc;
@@ -46,7 +45,7 @@ use crate::tiff::{exif, Ifd};
 use crate::utils;
 use crate::{
     AspectRatio, Context, DataType, Dump, Error, Point, RawFile, RawFileHandle, RawFileImpl,
-    RawImage, Rect, Result, Size, Type, TypeId,
+    RawImage, Rect, RenderingCrop, Result, Size, Type, TypeId,
 };
 
 use matrices::MATRICES;
@@ -75,85 +74,83 @@ macro_rules! fuji {
 pub use tiff::exif::generated::MNOTE_FUJIFILM_RAWIFD_TAG_NAMES;
 pub use tiff::exif::generated::MNOTE_FUJIFILM_TAG_NAMES as MNOTE_TAG_NAMES;
 
-lazy_static::lazy_static! {
-    /// Make to TypeId map for RAF files.
-    static ref MAKE_TO_ID_MAP: tiff::MakeToIdMap = HashMap::from([
-        fuji!("GFX 50S", GFX50S),
-        fuji!("GFX50S II", GFX50S_II),
-        fuji!("GFX 50R", GFX50R),
-        fuji!("GFX 100", GFX100),
-        fuji!("GFX100 II", GFX100_II),
-        fuji!("GFX100S", GFX100S),
-        fuji!("GFX100RF", GFX100RF),
-        fuji!("FinePix F550EXR", F550EXR),
-        fuji!("FinePix F700  ", F700),
-        fuji!("FinePix F810   ", F810),
-        fuji!("FinePix E900   ", E900),
-        fuji!("FinePixS2Pro", S2PRO),
-        fuji!("FinePix S3Pro  ", S3PRO),
-        fuji!("FinePix S5Pro  ", S5PRO),
-        fuji!("FinePix S5000 ", S5000),
-        fuji!("FinePix S5600  ", S5600),
-        fuji!("FinePix S6000fd", S6000FD),
-        fuji!("FinePix S6500fd", S6500FD),
-        fuji!("FinePix S9500  ", S9500),
-        fuji!("FinePix SL1000", SL1000),
-        fuji!("FinePix HS10 HS11", HS10),
-        fuji!("FinePix HS30EXR", HS30EXR),
-        fuji!("FinePix HS33EXR", HS33EXR),
-        fuji!("FinePix HS50EXR", HS50EXR),
-        fuji!("FinePix S100FS ", S100FS),
-        fuji!("FinePix S200EXR", S200EXR),
-        fuji!("FinePix X100", X100),
-        fuji!("X10", X10),
-        fuji!("X20", X20),
-        fuji!("X30", X30),
-        fuji!("X70", X70),
-        fuji!("X-Pro1", XPRO1),
-        fuji!("X-Pro2", XPRO2),
-        fuji!("X-Pro3", XPRO3),
-        fuji!("X-S1", XS1),
-        fuji!("X-S10", XS10),
-        fuji!("X-S20", XS20),
-        fuji!("X-A1", XA1),
-        fuji!("X-A10", XA10),
-        fuji!("X-A2", XA2),
-        fuji!("X-A3", XA3),
-        fuji!("X-A5", XA5),
-        fuji!("X-A7", XA7),
-        fuji!("XQ1", XQ1),
-        fuji!("XQ2", XQ2),
-        fuji!("X-E1", XE1),
-        fuji!("X-E2", XE2),
-        fuji!("X-E2S", XE2S),
-        fuji!("X-E3", XE3),
-        fuji!("X-E4", XE4),
-        fuji!("X-M1", XM1),
-        fuji!("X-M5", XM5),
-        fuji!("X-T1", XT1),
-        fuji!("X-T10", XT10),
-        fuji!("X-T100", XT100),
-        fuji!("X-T2", XT2),
-        fuji!("X-T20", XT20),
-        fuji!("X-T200", XT200),
-        fuji!("X-T3", XT3),
-        fuji!("X-T30", XT30),
-        fuji!("X-T30 II", XT30_II),
-        fuji!("X-T4", XT4),
-        fuji!("X-T5", XT5),
-        fuji!("X-T50", XT50),
-        fuji!("XF1", XF1),
-        fuji!("XF10", XF10),
-        fuji!("X100S", X100S),
-        fuji!("X100T", X100T),
-        fuji!("X100F", X100F),
-        fuji!("X100V", X100V),
-        fuji!("X100VI", X100VI),
-        fuji!("X-H1", XH1),
-        fuji!("X-H2", XH2),
-        fuji!("X-H2S", XH2S),
-    ]);
-}
+/// Make to TypeId map for RAF files.
+static MAKE_TO_ID_MAP: tiff::MakeToIdMap<74> = tiff::MakeToIdMap::new([
+    fuji!("GFX 50S", GFX50S),
+    fuji!("GFX50S II", GFX50S_II),
+    fuji!("GFX 50R", GFX50R),
+    fuji!("GFX 100", GFX100),
+    fuji!("GFX100 II", GFX100_II),
+    fuji!("GFX100S", GFX100S),
+    fuji!("GFX100RF", GFX100RF),
+    fuji!("FinePix F550EXR", F550EXR),
+    fuji!("FinePix F700  ", F700),
+    fuji!("FinePix F810   ", F810),
+    fuji!("FinePix E900   ", E900),
+    fuji!("FinePixS2Pro", S2PRO),
+    fuji!("FinePix S3Pro  ", S3PRO),
+    fuji!("FinePix S5Pro  ", S5PRO),
+    fuji!("FinePix S5000 ", S5000),
+    fuji!("FinePix S5600  ", S5600),
+    fuji!("FinePix S6000fd", S6000FD),
+    fuji!("FinePix S6500fd", S6500FD),
+    fuji!("FinePix S9500  ", S9500),
+    fuji!("FinePix SL1000", SL1000),
+    fuji!("FinePix HS10 HS11", HS10),
+    fuji!("FinePix HS30EXR", HS30EXR),
+    fuji!("FinePix HS33EXR", HS33EXR),
+    fuji!("FinePix HS50EXR", HS50EXR),
+    fuji!("FinePix S100FS ", S100FS),
+    fuji!("FinePix S200EXR", S200EXR),
+    fuji!("FinePix X100", X100),
+    fuji!("X10", X10),
+    fuji!("X20", X20),
+    fuji!("X30", X30),
+    fuji!("X70", X70),
+    fuji!("X-Pro1", XPRO1),
+    fuji!("X-Pro2", XPRO2),
+    fuji!("X-Pro3", XPRO3),
+    fuji!("X-S1", XS1),
+    fuji!("X-S10", XS10),
+    fuji!("X-S20", XS20),
+    fuji!("X-A1", XA1),
+    fuji!("X-A10", XA10),
+    fuji!("X-A2", XA2),
+    fuji!("X-A3", XA3),
+    fuji!("X-A5", XA5),
+    fuji!("X-A7", XA7),
+    fuji!("XQ1", XQ1),
+    fuji!("XQ2", XQ2),
+    fuji!("X-E1", XE1),
+    fuji!("X-E2", XE2),
+    fuji!("X-E2S", XE2S),
+    fuji!("X-E3", XE3),
+    fuji!("X-E4", XE4),
+    fuji!("X-M1", XM1),
+    fuji!("X-M5", XM5),
+    fuji!("X-T1", XT1),
+    fuji!("X-T10", XT10),
+    fuji!("X-T100", XT100),
+    fuji!("X-T2", XT2),
+    fuji!("X-T20", XT20),
+    fuji!("X-T200", XT200),
+    fuji!("X-T3", XT3),
+    fuji!("X-T30", XT30),
+    fuji!("X-T30 II", XT30_II),
+    fuji!("X-T4", XT4),
+    fuji!("X-T5", XT5),
+    fuji!("X-T50", XT50),
+    fuji!("XF1", XF1),
+    fuji!("XF10", XF10),
+    fuji!("X100S", X100S),
+    fuji!("X100T", X100T),
+    fuji!("X100F", X100F),
+    fuji!("X100V", X100V),
+    fuji!("X100VI", X100VI),
+    fuji!("X-H1", XH1),
+    fuji!("X-H2", XH2),
+    fuji!("X-H2S", XH2S),
+]);
 
 #[derive(Debug)]
 pub(crate) struct RafFile {
@@ -291,6 +288,27 @@ impl RawFileImpl for RafFile {
     }
 
     fn load_rawdata(&self, skip_decompress: bool) -> Result<RawImage> {
+        self.load_rawdata_columns(skip_decompress, None)
+    }
+
+    fn load_rawdata_region(&self, region: &Rect, crop: RenderingCrop) -> Result<RawImage> {
+        self.load_rawdata_columns(false, Some((region, crop)))
+    }
+
+    fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
+        self.builtin_colour_matrix(&MATRICES)
+    }
+}
+
+impl RafFile {
+    /// Load the raw data. If `region` is set, relative to the crop,
+    /// only the compressed strips intersecting its columns are
+    /// decompressed.
+    fn load_rawdata_columns(
+        &self,
+        skip_decompress: bool,
+        region: Option<(&Rect, RenderingCrop)>,
+    ) -> Result<RawImage> {
         self.container()?;
         let raw_container = self.container.get().unwrap();
         raw_container
@@ -342,6 +360,14 @@ impl RawFileImpl for RafFile {
                         .as_ref()
                         .map(|user_crop| aspect_ratio.crop_into(user_crop))
                 });
+                let columns = region.map(|(region, rendering_crop)| {
+                    let x = rendering_crop
+                        .rect(active_area.as_ref(), crop.as_ref())
+                        .map(|rect| rect.x)
+                        .unwrap_or(0)
+                        .saturating_add(region.x) as usize;
+                    x..x + region.width as usize
+                });
                 let raw_props = container
                     .value(raf::TAG_RAW_INFO)
                     .and_then(|v| match v {
@@ -519,6 +545,7 @@ impl RawFileImpl for RafFile {
                             raw_size.width as usize,
                             raw_size.height as usize,
                             &mosaic,
+                            columns,
                         )
                         .ok();
                     }
@@ -570,10 +597,6 @@ impl RawFileImpl for RafFile {
                 Ok(rawdata)
             })
     }
-
-    fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
-    }
 }
 
 impl RawFile for RafFile {
@@ -226,6 +226,13 @@ impl Header {
     }
 }
 
+thread_local! {
+    /// The decoding block, kept per worker thread so that the line
+    /// buffers are allocated once and reused across strips and files.
+    static STRIP_BLOCK: std::cell::RefCell<Option<CompressedBlock>> =
+        std::cell::RefCell::new(None);
+}
+
 impl Strip {
     fn decompress_strip(
         &self,
@@ -235,7 +242,25 @@ impl Strip {
         q_bases: Option<&[u8]>,
         out: &mut ImageBuffer<u16>,
     ) {
-        let mut info_block = CompressedBlock::new(header, params);
+        STRIP_BLOCK.with(|block| {
+            let mut block = block.borrow_mut();
+            match block.as_mut() {
+                Some(block) => block.reset(header, params),
+                None => *block = Some(CompressedBlock::new(header, params)),
+            }
+            self.decompress_strip_with(block.as_mut().unwrap(), src, header, params, q_bases, out)
+        })
+    }
+
+    fn decompress_strip_with(
+        &self,
+        info_block: &mut CompressedBlock,
+        src: &[u8],
+        header: &Header,
+        params: &Params,
+        q_bases: Option<&[u8]>,
+        out: &mut ImageBuffer<u16>,
+    ) {
         log::debug!("Fuji strip offset: {}, len: {}", self.offset, self.size);
 
         let mut pump = if self.offset + self.size == src.len() {
@@ -329,11 +354,15 @@ impl Strip {
 /// Each reader needs a litte bit more overhead at the end.
 /// For the final strip, we need the extra bytes from the buffer
 /// to prevent out-of-range errors in BitReader.
+///
+/// If `columns` is set, only the strips intersecting these columns are
+/// decompressed, the others are left black.
 pub(super) fn decompress_fuji(
     buf: &[u8],
     width: usize,
     height: usize,
     corrected_cfa: &Pattern,
+    columns: Option<std::ops::Range<usize>>,
 ) -> Result<ImageBuffer<u16>> {
     let mut stream = std::io::Cursor::new(buf);
     let header = Header {
@@ -412,15 +441,22 @@ pub(super) fn decompress_fuji(
     let out = SharedPix2D::new(ImageBuffer::new(width as u32, height as u32, 16, 1));
 
     // Process each strip
-    strips.par_iter().for_each(|strip| {
-        let line_step = (header.total_lines as usize + 0xF) & !0xF;
-        // Each strip has it's own q_bases
-        let q_bases_strip = q_bases.as_ref().map(|buf| &buf[strip.n * line_step..]);
-        // DANGEROUS: We need multiple mut refs here. This should be
-        // safe as be only write pixels to pre-allocated memory.
-        let outbuf = unsafe { out.inner_mut() };
-        strip.decompress_strip(buf, &header, &params, q_bases_strip, outbuf);
-    });
+    strips
+        .par_iter()
+        .filter(|strip| {
+            columns.as_ref().map_or(true, |columns| {
+                strip.offset_x() < columns.end && strip.offset_x() + strip.width() > columns.start
+            })
+        })
+        .for_each(|strip| {
+            let line_step = (header.total_lines as usize + 0xF) & !0xF;
+            // Each strip has it's own q_bases
+            let q_bases_strip = q_bases.as_ref().map(|buf| &buf[strip.n * line_step..]);
+            // DANGEROUS: We need multiple mut refs here. This should be
+            // safe as be only write pixels to pre-allocated memory.
+            let outbuf = unsafe { out.inner_mut() };
+            strip.decompress_strip(buf, &header, &params, q_bases_strip, outbuf);
+        });
 
     Ok(out.into_inner())
 }
@@ -465,6 +501,16 @@ impl Colours {
     }
 }
 
+impl GradientList {
+    /// Reset all the gradients to their default value.
+    fn reset(&mut self) {
+        self.lossless_grads.fill(Default::default());
+        for grads in self.lossy_grads.iter_mut() {
+            grads.fill(Default::default());
+        }
+    }
+}
+
 impl Default for GradientList {
     fn default() -> Self {
         Self {
@@ -489,10 +535,29 @@ struct CompressedBlock {
 impl CompressedBlock {
     /// Create and initialize new compression block.
     fn new(header: &Header, params: &Params) -> Self {
-        let linebuf = vec![vec![0; params.line_width + 2]; XT_LINE_TOTAL];
+        let mut block = Self {
+            grad_even: Default::default(),
+            grad_odd: Default::default(),
+            linebuf: vec![],
+        };
+        block.reset(header, params);
+        block
+    }
 
-        let mut grad_even: [GradientList; 3] = Default::default();
-        let mut grad_odd: [GradientList; 3] = Default::default();
+    /// Reinitialize the compression block for a new strip, reusing
+    /// the line buffers allocations.
+    fn reset(&mut self, header: &Header, params: &Params) {
+        self.linebuf.resize(XT_LINE_TOTAL, vec![]);
+        for line in self.linebuf.iter_mut() {
+            line.clear();
+            line.resize(params.line_width + 2, 0);
+        }
+
+        for grads in self.grad_even.iter_mut().chain(self.grad_odd.iter_mut()) {
+            grads.reset();
+        }
+        let grad_even = &mut self.grad_even;
+        let grad_odd = &mut self.grad_odd;
 
         if header.is_lossless() {
             let max_diff = 2.max((params.qtables[0].total_values + 0x20) >> 6);
@@ -521,12 +586,6 @@ impl CompressedBlock {
                 }
             }
         }
-
-        Self {
-            grad_even,
-            grad_odd,
-            linebuf,
-        }
     }
 
     /// Copy line from decoding buffer to output
@@ -21,12 +21,12 @@
 
 //! Fujifilm colour matrices
 
-use crate::colour::BuiltinMatrix;
+use crate::colour::{self, BuiltinMatrix};
 use crate::fuji;
 use crate::TypeId;
 
-lazy_static::lazy_static! {
-    pub(super) static ref MATRICES: [BuiltinMatrix; 73] = [
+#[rustfmt::skip]
+pub(super) static MATRICES: [BuiltinMatrix; 73] = colour::sorted_matrices([
         BuiltinMatrix::new(
             fuji!(F550EXR),
             0,
@@ -395,5 +395,4 @@ lazy_static::lazy_static! {
             0,
             0,
             [ 12806, -5779, -1110, -3546, 11507, 2318, -177, 995, 5715 ] ),
-    ];
-}
+    ]);
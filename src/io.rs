@@ -174,21 +174,19 @@ impl View {
         }
     }
 
-    /// Read an array of `u16` with endian
+    /// Read an array of `u16` with endian. The bytes are read
+    /// directly into `arr` and swapped in place if needed.
     pub fn read_endian_u16_array(
         &mut self,
         arr: &mut [u16],
         endian: Endian,
     ) -> std::io::Result<()> {
+        if endian == Endian::Unset {
+            unreachable!("endian unset");
+        }
         let bytes = utils::to_u8_slice_mut(arr);
         self.read_exact(bytes)?;
-        match endian {
-            Endian::Little => LittleEndian::from_slice_u16(arr),
-            Endian::Big => BigEndian::from_slice_u16(arr),
-            Endian::Unset => {
-                unreachable!("endian unset");
-            }
-        }
+        endian.u16_slice_to_native(arr);
         Ok(())
     }
 
@@ -286,6 +284,7 @@ mod test {
     use std::io::{Read, Seek};
 
     use super::Viewer;
+    use crate::container::Endian;
 
     #[test]
     fn test_view() {
@@ -307,4 +306,20 @@ mod test {
         assert_eq!(r.unwrap(), 4);
         assert_eq!(&buf, b"ijkl");
     }
+
+    #[test]
+    fn test_read_endian_u16_array() {
+        let buffer = [0x12_u8, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0];
+
+        let io = Box::new(std::io::Cursor::new(buffer.to_vec()));
+        let viewer = Viewer::new(io, buffer.len() as u64);
+        let mut view = Viewer::create_view(&viewer, 0).unwrap();
+
+        let mut arr = [0_u16; 2];
+        view.read_endian_u16_array(&mut arr, Endian::Big).unwrap();
+        assert_eq!(arr, [0x1234, 0x5678]);
+        assert!(view.read_endian_u16_array(&mut arr, Endian::Little).is_ok());
+        assert_eq!(arr, [0xbc9a, 0xf0de]);
+        assert!(view.read_endian_u16_array(&mut arr, Endian::Big).is_err());
+    }
 }
@@ -32,6 +32,8 @@ use once_cell::sync::Lazy;
 mod dump;
 #[macro_use]
 mod utils;
+#[macro_use]
+mod lookup;
 #[cfg(feature = "probe")]
 #[macro_use]
 mod probe;
@@ -45,6 +47,7 @@ mod probe {
 }
 
 mod apple;
+mod binning;
 mod bitmap;
 mod camera_ids;
 mod canon;
@@ -73,11 +76,15 @@ mod rawfile;
 mod rawimage;
 mod render;
 mod ricoh;
+mod rows;
+mod session;
 mod sigma;
 mod sony;
+mod statistics;
 mod thumbnail;
 pub mod tiff;
 
+pub use binning::Binning;
 pub use bitmap::Bitmap;
 pub use colour::ColourSpace;
 pub use dump::Dump;
@@ -87,7 +94,13 @@ pub use mosaic::Pattern as CfaPattern;
 pub use probe::Probe;
 pub use rawfile::{RawFile, RawFileHandle, RawFileImpl};
 pub use rawimage::RawImage;
-pub use render::{RenderingOptions, RenderingStage};
+pub use render::{
+    DemosaicMethod, RenderingCrop, RenderingFormat, RenderingOptions, RenderingPrecision,
+    RenderingScale, RenderingStage,
+};
+pub use rows::RowBand;
+pub use session::DecodeSession;
+pub use statistics::{ChannelStatistics, Statistics};
 pub use thumbnail::Thumbnail;
 pub use tiff::Ifd;
 
@@ -97,6 +110,8 @@ pub use canon::print_models as canon_print_models;
 pub use decompress::LJpeg;
 #[cfg(any(feature = "fuzzing", feature = "bench"))]
 pub use olympus::decompress::decompress_olympus;
+#[cfg(feature = "bench")]
+pub use render::demosaic::bench as demosaic_bench;
 
 pub use rawfile::rawfile_from_file;
 pub use rawfile::rawfile_from_io;
@@ -190,12 +205,18 @@ pub enum DataType {
     Jpeg,
     /// RGB8 Pixmap
     PixmapRgb8,
-    /// RGB8 Pixmap
+    /// RGB16 Pixmap
     PixmapRgb16,
+    /// RGBA8 Pixmap
+    PixmapRgba8,
+    /// Planar float RGB Pixmap
+    PixmapPlanarF32,
     /// RAW data compressed. (undetermined codec)
     CompressedRaw,
     /// RAW data uncompressed
     Raw,
+    /// RAW data uncompressed, in 4 planes R, G1, G2 and B
+    RawPlanes,
     /// Unknown type
     #[default]
     Unknown,
@@ -207,8 +228,11 @@ impl From<&str> for DataType {
             "JPEG" => Self::Jpeg,
             "8RGB" => Self::PixmapRgb8,
             "16RGB" => Self::PixmapRgb16,
+            "8RGBA" => Self::PixmapRgba8,
+            "F32PLANAR" => Self::PixmapPlanarF32,
             "COMP_RAW" => Self::CompressedRaw,
             "RAW" => Self::Raw,
+            "RAW_PLANES" => Self::RawPlanes,
             _ => Self::Unknown,
         }
     }
@@ -219,8 +243,11 @@ impl From<DataType> for String {
         match t {
             DataType::Jpeg => "JPEG",
             DataType::Raw => "RAW",
+            DataType::RawPlanes => "RAW_PLANES",
             DataType::PixmapRgb8 => "8RGB",
             DataType::PixmapRgb16 => "16RGB",
+            DataType::PixmapRgba8 => "8RGBA",
+            DataType::PixmapPlanarF32 => "F32PLANAR",
             DataType::CompressedRaw => "COMP_RAW",
             DataType::Unknown => "UNKNOWN",
         }
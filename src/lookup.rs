@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * libopenraw - lookup.rs
+ *
+ * Copyright (C) 2025 Hubert Figuière
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+//! Static lookup tables, sorted at compile time and searched by
+//! bisection. Nothing is built at runtime on first use.
+
+use std::borrow::Borrow;
+use std::cmp::Ordering;
+
+use crate::TypeId;
+
+/// Sort the array `$entries` in place by the field `$key`, compared
+/// with the const fn `$cmp`. This is a binary insertion sort, to be
+/// used in a const fn: the tables are small. Panic on a duplicate key,
+/// which is a compile time error.
+macro_rules! const_sort {
+    ( $entries:ident, $key:tt, $cmp:path ) => {{
+        let mut i = 1;
+        while i < $entries.len() {
+            let entry = $entries[i];
+            let mut lo = 0;
+            let mut hi = i;
+            while lo < hi {
+                let mid = (lo + hi) / 2;
+                match $cmp($entries[mid].$key, entry.$key) {
+                    ::std::cmp::Ordering::Less => lo = mid + 1,
+                    ::std::cmp::Ordering::Greater => hi = mid,
+                    ::std::cmp::Ordering::Equal => panic!("Duplicate key in lookup table"),
+                }
+            }
+            let mut j = i;
+            while j > lo {
+                $entries[j] = $entries[j - 1];
+                j -= 1;
+            }
+            $entries[lo] = entry;
+            i += 1;
+        }
+    }};
+}
+
+/// Compare two strings, bytewise like `Ord`, in a const fn.
+pub(crate) const fn str_cmp(a: &str, b: &str) -> Ordering {
+    let a = a.as_bytes();
+    let b = b.as_bytes();
+    let mut i = 0;
+    while i < a.len() && i < b.len() {
+        if a[i] != b[i] {
+            return if a[i] < b[i] {
+                Ordering::Less
+            } else {
+                Ordering::Greater
+            };
+        }
+        i += 1;
+    }
+    u32_cmp(a.len() as u32, b.len() as u32)
+}
+
+/// Compare two u32 in a const fn.
+pub(crate) const fn u32_cmp(a: u32, b: u32) -> Ordering {
+    if a < b {
+        Ordering::Less
+    } else if a > b {
+        Ordering::Greater
+    } else {
+        Ordering::Equal
+    }
+}
+
+/// Compare two `TypeId`, vendor first, in a const fn.
+pub(crate) const fn type_id_cmp(a: TypeId, b: TypeId) -> Ordering {
+    u32_cmp(
+        ((a.0 as u32) << 16) | a.1 as u32,
+        ((b.0 as u32) << 16) | b.1 as u32,
+    )
+}
+
+/// A static map of `K` to `TypeId`, for camera identification. It is
+/// sorted by key when created, at compile time.
+pub(crate) struct TypeIdMap<K, const N: usize>([(K, TypeId); N]);
+
+/// Map of the numeric model id found in the maker note to `TypeId`.
+pub(crate) type ModelIdMap<const N: usize> = TypeIdMap<u32, N>;
+
+impl<const N: usize> TypeIdMap<&'static str, N> {
+    /// Create the map from the `entries`, keyed by name.
+    pub const fn new(mut entries: [(&'static str, TypeId); N]) -> Self {
+        const_sort!(entries, 0, str_cmp);
+        TypeIdMap(entries)
+    }
+}
+
+impl<const N: usize> TypeIdMap<u32, N> {
+    /// Create the map from the `entries`, keyed by numeric id.
+    pub const fn new(mut entries: [(u32, TypeId); N]) -> Self {
+        const_sort!(entries, 0, u32_cmp);
+        TypeIdMap(entries)
+    }
+}
+
+impl<K: Ord, const N: usize> TypeIdMap<K, N> {
+    /// Get the `TypeId` for `key`.
+    pub fn get<Q>(&self, key: &Q) -> Option<&TypeId>
+    where
+        K: Borrow<Q>,
+        Q: Ord + ?Sized,
+    {
+        self.0
+            .binary_search_by(|(k, _)| k.borrow().cmp(key))
+            .ok()
+            .map(|i| &self.0[i].1)
+    }
+
+    /// Iterate the entries, in key order.
+    pub fn iter(&self) -> impl Iterator<Item = &(K, TypeId)> {
+        self.0.iter()
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use std::cmp::Ordering;
+
+    use super::{str_cmp, ModelIdMap, TypeIdMap};
+    use crate::TypeId;
+
+    static MAP: TypeIdMap<&str, 4> = TypeIdMap::<&str, 4>::new([
+        ("NIKON D70", TypeId(3, 1)),
+        ("Canon EOS 10D", TypeId(2, 2)),
+        ("NIKON D700", TypeId(3, 2)),
+        ("Canon EOS 1D", TypeId(2, 1)),
+    ]);
+
+    #[test]
+    fn test_type_id_map() {
+        assert_eq!(str_cmp("abc", "abd"), Ordering::Less);
+        assert_eq!(str_cmp("abc", "ab"), Ordering::Greater);
+        assert_eq!(str_cmp("abc", "abc"), Ordering::Equal);
+
+        let keys: Vec<&str> = MAP.iter().map(|e| e.0).collect();
+        assert_eq!(
+            keys,
+            ["Canon EOS 10D", "Canon EOS 1D", "NIKON D70", "NIKON D700"]
+        );
+        assert_eq!(MAP.get("NIKON D70"), Some(&TypeId(3, 1)));
+        assert_eq!(MAP.get(&"Canon EOS 1D"), Some(&TypeId(2, 1)));
+        assert_eq!(MAP.get("NIKON"), None);
+
+        let map = ModelIdMap::new([(30, TypeId(1, 3)), (10, TypeId(1, 1)), (20, TypeId(1, 2))]);
+        assert_eq!(map.get(&20), Some(&TypeId(1, 2)));
+        assert_eq!(map.get(&25), None);
+    }
+}
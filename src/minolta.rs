@@ -25,14 +25,13 @@
 //! post Minolta acquisition cameras like the Sony A100.
 
 use std::cell::{RefCell, RefMut};
-use std::collections::HashMap;
 use std::io::{Read, Seek, SeekFrom};
 use std::rc::Rc;
 
 use byteorder::{BigEndian, LittleEndian, ReadBytesExt};
 use once_cell::unsync::OnceCell;
 
-use crate::colour::BuiltinMatrix;
+use crate::colour::{self, BuiltinMatrix};
 use crate::container::{Endian, RawContainer};
 use crate::decompress;
 use crate::io::{View, Viewer};
@@ -66,8 +65,8 @@ macro_rules! minolta {
 
 pub use tiff::exif::generated::MNOTE_MINOLTA_TAG_NAMES as MNOTE_TAG_NAMES;
 
-lazy_static::lazy_static! {
-    pub(super) static ref MATRICES: [BuiltinMatrix; 9] = [
+#[rustfmt::skip]
+pub(super) static MATRICES: [BuiltinMatrix; 9] = colour::sorted_matrices([
         BuiltinMatrix::new(
             minolta!(MAXXUM_5D),
             0, 0xffb,
@@ -113,20 +112,19 @@ lazy_static::lazy_static! {
             0, 0,
             [ 8560, -2487, -986, -8112, 15535, 2771, -1209, 1324, 7743 ]
         ),
-    ];
-
-    static ref MODEL_ID_MAP: HashMap<&'static str, TypeId> = HashMap::from([
-        minolta!("21860002", MAXXUM_5D),
-        minolta!("21810002", MAXXUM_7D),
-        minolta!("27730001", DIMAGE5),
-        minolta!("27660001", DIMAGE7),
-        minolta!("27790001", DIMAGE7I),
-        minolta!("27780001", DIMAGE7HI),
-        minolta!("27820001", A1),
-        minolta!("27200001", A2),
-        minolta!("27470002", A200),
     ]);
-}
+
+static MODEL_ID_MAP: tiff::MakeToIdMap<9> = tiff::MakeToIdMap::new([
+    minolta!("21860002", MAXXUM_5D),
+    minolta!("21810002", MAXXUM_7D),
+    minolta!("27730001", DIMAGE5),
+    minolta!("27660001", DIMAGE7),
+    minolta!("27790001", DIMAGE7I),
+    minolta!("27780001", DIMAGE7HI),
+    minolta!("27820001", A1),
+    minolta!("27200001", A2),
+    minolta!("27470002", A200),
+]);
 
 #[derive(Debug)]
 /// The MRW file format was produced by Minolta cameras until
@@ -297,10 +295,8 @@ impl RawFileImpl for MrwFile {
                 )
             };
             let id = self.type_id()?;
-            if let Some((black, white)) = MATRICES
-                .iter()
-                .find(|m| m.camera == id)
-                .map(|m| (m.black, m.white))
+            if let Some((black, white)) =
+                colour::find_builtin_matrix(&MATRICES, id).map(|m| (m.black, m.white))
             {
                 probe!(self.probe, "mrw.whites_blacks", "true");
                 rawdata.set_whites([white; 4]);
@@ -318,7 +314,7 @@ impl RawFileImpl for MrwFile {
     }
 
     fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
+        self.builtin_colour_matrix(&MATRICES)
     }
 }
 
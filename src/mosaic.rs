@@ -183,6 +183,44 @@ impl Pattern {
             Self::NonRgb22(ref p) => p,
         }
     }
+
+    /// The pattern of the image cropped at `x`, `y`.
+    pub fn shifted(&self, x: usize, y: usize) -> Pattern {
+        let width = self.width();
+        let height = self.height();
+        if width == 0 || self.pattern().len() != width * height {
+            return self.clone();
+        }
+        let colours: Vec<u8> = (0..height)
+            .flat_map(|row| {
+                (0..width).map(move |col| self[((col + x) % width, (row + y) % height)] as u8)
+            })
+            .collect();
+        Pattern::try_from(colours.as_slice()).unwrap_or_else(|_| self.clone())
+    }
+
+    /// Map `levels` given per colour, in R, G1, G2, B order, to the
+    /// positions of the 2x2 pattern, in row order. G1 is the first
+    /// green of the pattern. Other patterns get `levels` as is.
+    pub(crate) fn levels_from_rggb(&self, levels: [u16; 4]) -> [u16; 4] {
+        let colours = self.pattern();
+        if colours.len() != 4 {
+            return levels;
+        }
+        let mut greens = 0;
+        let mut positions = levels;
+        for (position, colour) in positions.iter_mut().zip(colours.iter()) {
+            *position = match colour {
+                PatternColour::Red => levels[0],
+                PatternColour::Blue => levels[3],
+                _ => {
+                    greens += 1;
+                    levels[std::cmp::min(greens, 2)]
+                }
+            };
+        }
+        positions
+    }
 }
 
 impl std::ops::Index<(usize, usize)> for Pattern {
@@ -255,4 +293,37 @@ mod test {
         ];
         assert!(Pattern::try_from(pattern.as_slice()).is_err());
     }
+
+    #[test]
+    fn test_pattern_shifted() {
+        assert_eq!(Pattern::Rggb.shifted(0, 0), Pattern::Rggb);
+        assert_eq!(Pattern::Rggb.shifted(1, 0), Pattern::Grbg);
+        assert_eq!(Pattern::Rggb.shifted(0, 1), Pattern::Gbrg);
+        assert_eq!(Pattern::Rggb.shifted(1, 1), Pattern::Bggr);
+        assert_eq!(Pattern::Rggb.shifted(2, 4), Pattern::Rggb);
+        assert_eq!(Pattern::Empty.shifted(1, 1), Pattern::Empty);
+
+        let pattern = Pattern::NonRgb22(
+            [Red, Green, Blue, Green, Green, Green, Blue]
+                .iter()
+                .cycle()
+                .take(36)
+                .copied()
+                .collect(),
+        );
+        let shifted = pattern.shifted(1, 2);
+        assert_eq!(shifted[(0, 0)], pattern[(1, 2)]);
+        assert_eq!(shifted[(5, 5)], pattern[(0, 1)]);
+        assert_eq!(shifted.shifted(5, 4), pattern);
+    }
+
+    #[test]
+    fn test_levels_from_rggb() {
+        let levels = [1, 2, 3, 4];
+        assert_eq!(Pattern::Rggb.levels_from_rggb(levels), [1, 2, 3, 4]);
+        assert_eq!(Pattern::Bggr.levels_from_rggb(levels), [4, 2, 3, 1]);
+        assert_eq!(Pattern::Grbg.levels_from_rggb(levels), [2, 1, 4, 3]);
+        assert_eq!(Pattern::Gbrg.levels_from_rggb(levels), [2, 4, 1, 3]);
+        assert_eq!(Pattern::Empty.levels_from_rggb(levels), levels);
+    }
 }
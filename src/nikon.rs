@@ -25,7 +25,6 @@ mod diffiterator;
 mod huffman;
 mod matrices;
 
-use std::collections::HashMap;
 use std::io::{Seek, SeekFrom};
 use std::rc::Rc;
 
@@ -37,6 +36,7 @@ use crate::container::RawContainer;
 use crate::decompress;
 use crate::io::Viewer;
 use crate::rawfile::{RawFileHandleType, ThumbnailStorage};
+use crate::rows::RowSink;
 use crate::tiff;
 use crate::tiff::exif;
 use crate::tiff::{Dir, Ifd};
@@ -73,103 +73,101 @@ pub use tiff::exif::generated::MNOTE_NIKON2_TAG_NAMES as MNOTE_TAG_NAMES_2;
 /// Nikon1 MakerNote tag names
 pub use tiff::exif::generated::MNOTE_NIKON_TAG_NAMES as MNOTE_TAG_NAMES;
 
-lazy_static::lazy_static! {
-    static ref MAKE_TO_ID_MAP: tiff::MakeToIdMap = HashMap::from([
-        nikon!("NIKON D1 ", D1),
-        nikon!("NIKON D100 ", D100),
-        nikon!("NIKON D1H", D1H),
-        nikon!("NIKON D1X", D1X),
-        nikon!("NIKON D200", D200),
-        nikon!("NIKON D2H", D2H),
-        nikon!("NIKON D2Hs", D2HS),
-        nikon!("NIKON D2X", D2X),
-        nikon!("NIKON D2Xs", D2XS ),
-        nikon!("NIKON D3", D3),
-        nikon!("NIKON D3S", D3S),
-        nikon!("NIKON D3X", D3X),
-        nikon!("NIKON D300", D300),
-        nikon!("NIKON D300S", D300S),
-        nikon!("NIKON D3000", D3000),
-        nikon!("NIKON D3100", D3100),
-        nikon!("NIKON D3200", D3200),
-        nikon!("NIKON D3300", D3300),
-        nikon!("NIKON D3400", D3400),
-        nikon!("NIKON D3500", D3500),
-        nikon!("NIKON D4", D4),
-        nikon!("NIKON D4S", D4S),
-        nikon!("NIKON D40", D40),
-        nikon!("NIKON D40X", D40X),
-        nikon!("NIKON D5", D5),
-        nikon!("NIKON D50", D50),
-        nikon!("NIKON D500", D500),
-        nikon!("NIKON D5000", D5000),
-        nikon!("NIKON D5100", D5100),
-        nikon!("NIKON D5200", D5200),
-        nikon!("NIKON D5300", D5300),
-        nikon!("NIKON D5500", D5500),
-        nikon!("NIKON D5600", D5600),
-        nikon!("NIKON D6", D6),
-        nikon!("NIKON D60",   D60),
-        nikon!("NIKON D600", D600),
-        nikon!("NIKON D610", D610),
-        nikon!("NIKON D70", D70),
-        nikon!("NIKON D70s", D70S),
-        nikon!("NIKON D700", D700),
-        nikon!("NIKON D7000", D7000),
-        nikon!("NIKON D7100", D7100),
-        nikon!("NIKON D7200", D7200),
-        nikon!("NIKON D750", D750),
-        nikon!("NIKON D7500", D7500),
-        nikon!("NIKON D780", D780),
-        nikon!("NIKON D80", D80),
-        nikon!("NIKON D800", D800),
-        nikon!("NIKON D800E", D800E),
-        nikon!("NIKON D810", D810),
-        nikon!("NIKON D850", D850),
-        nikon!("NIKON D90", D90),
-        nikon!("NIKON Df", DF),
-        nikon!("NIKON Z 30", Z30),
-        nikon!("NIKON Z 6", Z6),
-        nikon!("NIKON Z 6_2", Z6_2),
-        nikon!("NIKON Z6_3", Z6_3),
-        nikon!("NIKON Z 7", Z7),
-        nikon!("NIKON Z 7_2", Z7_2),
-        nikon!("NIKON Z 50", Z50),
-        nikon!("NIKON Z50_2", Z50_2),
-        nikon!("NIKON Z 5", Z5),
-        nikon!("NIKON Z 8", Z8),
-        nikon!("NIKON Z 9", Z9),
-        nikon!("NIKON Z fc", ZFC),
-        nikon!("NIKON Z f", ZF),
-        nikon!("E5400", E5400),
-        nikon!("E5700", E5700),
-        nikon!("E8400", E8400),
-        nikon!("E8800", E8800),
-        nikon!("COOLPIX B700", COOLPIX_B700),
-        nikon!("COOLPIX P330", COOLPIX_P330),
-        nikon!("COOLPIX P340", COOLPIX_P340),
-        nikon!("COOLPIX P950", COOLPIX_P950),
-        nikon!("COOLPIX P1000", COOLPIX_P1000),
-        nikon!("COOLPIX P6000", COOLPIX_P6000),
-        nikon!("COOLPIX P7000", COOLPIX_P7000),
-        nikon!("COOLPIX P7100", COOLPIX_P7100),
-        nikon!("COOLPIX P7700", COOLPIX_P7700),
-        nikon!("COOLPIX P7800", COOLPIX_P7800),
-        nikon!("COOLPIX A", COOLPIX_A),
-        nikon!("COOLPIX A1000", COOLPIX_A1000),
-        nikon!("NIKON 1 J1", NIKON1_J1),
-        nikon!("NIKON 1 J2", NIKON1_J2),
-        nikon!("NIKON 1 J3", NIKON1_J3),
-        nikon!("NIKON 1 J4", NIKON1_J4),
-        nikon!("NIKON 1 J5", NIKON1_J5),
-        nikon!("NIKON 1 V1", NIKON1_V1),
-        nikon!("NIKON 1 V2", NIKON1_V2),
-        nikon!("NIKON 1 V3", NIKON1_V3),
-        nikon!("NIKON 1 S1", NIKON1_S1),
-        nikon!("NIKON 1 S2", NIKON1_S2),
-        nikon!("NIKON 1 AW1", NIKON1_AW1),
-    ]);
-}
+static MAKE_TO_ID_MAP: tiff::MakeToIdMap<93> = tiff::MakeToIdMap::new([
+    nikon!("NIKON D1 ", D1),
+    nikon!("NIKON D100 ", D100),
+    nikon!("NIKON D1H", D1H),
+    nikon!("NIKON D1X", D1X),
+    nikon!("NIKON D200", D200),
+    nikon!("NIKON D2H", D2H),
+    nikon!("NIKON D2Hs", D2HS),
+    nikon!("NIKON D2X", D2X),
+    nikon!("NIKON D2Xs", D2XS),
+    nikon!("NIKON D3", D3),
+    nikon!("NIKON D3S", D3S),
+    nikon!("NIKON D3X", D3X),
+    nikon!("NIKON D300", D300),
+    nikon!("NIKON D300S", D300S),
+    nikon!("NIKON D3000", D3000),
+    nikon!("NIKON D3100", D3100),
+    nikon!("NIKON D3200", D3200),
+    nikon!("NIKON D3300", D3300),
+    nikon!("NIKON D3400", D3400),
+    nikon!("NIKON D3500", D3500),
+    nikon!("NIKON D4", D4),
+    nikon!("NIKON D4S", D4S),
+    nikon!("NIKON D40", D40),
+    nikon!("NIKON D40X", D40X),
+    nikon!("NIKON D5", D5),
+    nikon!("NIKON D50", D50),
+    nikon!("NIKON D500", D500),
+    nikon!("NIKON D5000", D5000),
+    nikon!("NIKON D5100", D5100),
+    nikon!("NIKON D5200", D5200),
+    nikon!("NIKON D5300", D5300),
+    nikon!("NIKON D5500", D5500),
+    nikon!("NIKON D5600", D5600),
+    nikon!("NIKON D6", D6),
+    nikon!("NIKON D60", D60),
+    nikon!("NIKON D600", D600),
+    nikon!("NIKON D610", D610),
+    nikon!("NIKON D70", D70),
+    nikon!("NIKON D70s", D70S),
+    nikon!("NIKON D700", D700),
+    nikon!("NIKON D7000", D7000),
+    nikon!("NIKON D7100", D7100),
+    nikon!("NIKON D7200", D7200),
+    nikon!("NIKON D750", D750),
+    nikon!("NIKON D7500", D7500),
+    nikon!("NIKON D780", D780),
+    nikon!("NIKON D80", D80),
+    nikon!("NIKON D800", D800),
+    nikon!("NIKON D800E", D800E),
+    nikon!("NIKON D810", D810),
+    nikon!("NIKON D850", D850),
+    nikon!("NIKON D90", D90),
+    nikon!("NIKON Df", DF),
+    nikon!("NIKON Z 30", Z30),
+    nikon!("NIKON Z 6", Z6),
+    nikon!("NIKON Z 6_2", Z6_2),
+    nikon!("NIKON Z6_3", Z6_3),
+    nikon!("NIKON Z 7", Z7),
+    nikon!("NIKON Z 7_2", Z7_2),
+    nikon!("NIKON Z 50", Z50),
+    nikon!("NIKON Z50_2", Z50_2),
+    nikon!("NIKON Z 5", Z5),
+    nikon!("NIKON Z 8", Z8),
+    nikon!("NIKON Z 9", Z9),
+    nikon!("NIKON Z fc", ZFC),
+    nikon!("NIKON Z f", ZF),
+    nikon!("E5400", E5400),
+    nikon!("E5700", E5700),
+    nikon!("E8400", E8400),
+    nikon!("E8800", E8800),
+    nikon!("COOLPIX B700", COOLPIX_B700),
+    nikon!("COOLPIX P330", COOLPIX_P330),
+    nikon!("COOLPIX P340", COOLPIX_P340),
+    nikon!("COOLPIX P950", COOLPIX_P950),
+    nikon!("COOLPIX P1000", COOLPIX_P1000),
+    nikon!("COOLPIX P6000", COOLPIX_P6000),
+    nikon!("COOLPIX P7000", COOLPIX_P7000),
+    nikon!("COOLPIX P7100", COOLPIX_P7100),
+    nikon!("COOLPIX P7700", COOLPIX_P7700),
+    nikon!("COOLPIX P7800", COOLPIX_P7800),
+    nikon!("COOLPIX A", COOLPIX_A),
+    nikon!("COOLPIX A1000", COOLPIX_A1000),
+    nikon!("NIKON 1 J1", NIKON1_J1),
+    nikon!("NIKON 1 J2", NIKON1_J2),
+    nikon!("NIKON 1 J3", NIKON1_J3),
+    nikon!("NIKON 1 J4", NIKON1_J4),
+    nikon!("NIKON 1 J5", NIKON1_J5),
+    nikon!("NIKON 1 V1", NIKON1_V1),
+    nikon!("NIKON 1 V2", NIKON1_V2),
+    nikon!("NIKON 1 V3", NIKON1_V3),
+    nikon!("NIKON 1 S1", NIKON1_S1),
+    nikon!("NIKON 1 S2", NIKON1_S2),
+    nikon!("NIKON 1 AW1", NIKON1_AW1),
+]);
 
 struct CompressionInfo {
     vpred: [[u16; 2]; 2],
@@ -237,8 +235,97 @@ impl NefFile {
         is_d100
     }
 
-    /// Unpack Nikon.
-    fn unpack_nikon(&self, rawdata: RawImage) -> Result<RawImage> {
+    /// Load the raw data. If `rows` is passed, the data is output into
+    /// it instead, when it can be decoded by rows.
+    fn load_rawdata_with(
+        &self,
+        skip_decompress: bool,
+        mut rows: Option<&mut RowSink>,
+    ) -> Result<RawImage> {
+        self.ifd(tiff::IfdType::Raw)
+            .ok_or_else(|| {
+                log::error!("CFA not found");
+                Error::NotFound
+            })
+            .and_then(|dir| {
+                tiff::tiff_get_rawdata_rows(
+                    self.container.get().unwrap(),
+                    dir,
+                    self.type_(),
+                    rows.as_deref_mut(),
+                )
+                .map_err(|err| {
+                    log::error!("NEF get rawdata failed {}", err);
+                    err
+                })
+                .and_then(|rawdata| {
+                    let compression = rawdata.compression();
+                    probe!(self.probe, "nef.compression", &format!("{compression:?}"));
+                    if self.is_d100() {
+                        self.unpack_nikon(rawdata, rows)
+                    } else if compression == tiff::Compression::None {
+                        Ok(rawdata)
+                    } else if compression == tiff::Compression::NikonQuantized {
+                        if !skip_decompress {
+                            log::debug!("Nikon quantized");
+                            self.decompress_nikon_quantized(rawdata, rows)
+                                .map_err(|err| {
+                                    log::error!("NEF quantized {}", err);
+                                    err
+                                })
+                        } else {
+                            Ok(rawdata)
+                        }
+                    } else if self.is_nrw() {
+                        // XXX decompression not yet supported
+                        // is this a thing?
+                        probe!(self.probe, "nef.is_nrw_compression", "true");
+                        log::error!("NRW compression unsupported");
+                        Ok(rawdata)
+                    } else {
+                        log::error!("Invalid compression {:?}", compression);
+                        Ok(rawdata)
+                    }
+                })
+                .map(|mut rawdata| {
+                    if let Some(blacks) = self
+                        .ifd(tiff::IfdType::MakerNote)
+                        .and_then(|dir| dir.uint_value_array(exif::MNOTE_NIKON_BLACK_LEVEL))
+                    {
+                        probe!(self.probe, "nef.blacks.mnote", true);
+                        // In R, G1, G2, B order.
+                        let blacks = rawdata
+                            .mosaic_pattern()
+                            .levels_from_rggb(utils::to_quad(&blacks));
+                        rawdata.set_blacks(blacks);
+                    }
+                    if let Some(wb) = self.white_balance() {
+                        rawdata.set_as_shot_neutral(&wb);
+                    }
+
+                    let user_crop = self
+                        .maker_note_ifd()
+                        .and_then(|dir| dir.uint_value_array(exif::MNOTE_NIKON_CROP_AREA))
+                        .map(|user_crop| Rect {
+                            x: user_crop[0],
+                            y: user_crop[1],
+                            width: user_crop[2],
+                            height: user_crop[3],
+                        });
+                    rawdata.set_user_crop(user_crop, None);
+                    rawdata.set_active_area(Some(Rect {
+                        x: 0,
+                        y: 0,
+                        width: rawdata.width(),
+                        height: rawdata.height(),
+                    }));
+                    rawdata
+                })
+            })
+    }
+
+    /// Unpack Nikon. If `rows` is passed, the data is output into it.
+    fn unpack_nikon(&self, rawdata: RawImage, rows: Option<&mut RowSink>) -> Result<RawImage> {
         let mut width = rawdata.width();
         if self.is_d100() {
             width += 6;
@@ -257,20 +344,23 @@ impl NefFile {
 
         let data = rawdata.data8().ok_or(Error::NotFound)?;
 
-        let out_size = width as usize * height as usize;
-        let mut out_data = Vec::with_capacity(out_size);
-        let mut fetched = 0_usize;
-        let mut written = 0_usize;
-
-        let byte_len = std::cmp::min(data.len(), block_size * height as usize);
-        while fetched < byte_len {
-            let block = &data[fetched..fetched + block_size];
-            fetched += block.len();
-
-            written +=
-                decompress::unpack_be12to16(block, &mut out_data, tiff::Compression::NikonPack)?;
-        }
-        log::debug!("Unpacked {} pixels", written);
+        let packing = decompress::Packing::Be12(true);
+        let row_values = packing.row_values(block_size, width as usize)?;
+        let height = std::cmp::min(
+            data.len().checked_div(block_size).unwrap_or(0),
+            height as usize,
+        );
+        let data = &data[..height * block_size];
+        let out_data = if let Some(rows) = rows {
+            decompress::unpack_rows_to(packing, data, block_size, width as usize, rows)?;
+            vec![]
+        } else {
+            let mut out_data = uninit_vec!(height * row_values);
+            let written =
+                decompress::unpack_rows(packing, data, block_size, width as usize, &mut out_data)?;
+            log::debug!("Unpacked {} pixels", written);
+            out_data
+        };
 
         let mut rawdata = rawdata.replace_data(out_data);
         rawdata.set_data_type(DataType::Raw);
@@ -412,7 +502,13 @@ impl NefFile {
             })
     }
 
-    fn decompress_nikon_quantized(&self, mut rawdata: RawImage) -> Result<RawImage> {
+    /// Decompress the Nikon quantized data. If `rows` is passed, the
+    /// data is output into it.
+    fn decompress_nikon_quantized(
+        &self,
+        mut rawdata: RawImage,
+        rows: Option<&mut RowSink>,
+    ) -> Result<RawImage> {
         let new_data = self
             .get_compression_curve(&mut rawdata)
             .map_err(|err| {
@@ -421,7 +517,7 @@ impl NefFile {
             })
             .and_then(|curve| {
                 probe!(self.probe, "nef.compress_quantized", "true");
-                let rows = rawdata.height() as usize;
+                let height = rawdata.height() as usize;
                 let raw_columns = rawdata.width() as usize;
                 // XXX not always true
                 let columns = raw_columns - 1;
@@ -434,20 +530,34 @@ impl NefFile {
                     DiffIterator::new(curve.huffman.unwrap(), rawdata.data8().as_ref().unwrap());
                 let mut iter = CfaIterator::new(diffs, raw_columns, curve.vpred);
 
-                // Using uninit_vec! here is slower.
-                let mut new_data = vec![0; rows * columns];
-                for i in 0..rows {
+                let shift: u16 = 16 - rawdata.bpc();
+                let mut decode_row = |out: &mut [u16]| -> Result<()> {
                     for j in 0..raw_columns {
                         let t = iter.get().map_err(|err| {
                             log::error!("Error get");
                             err
                         })?;
                         if j < columns {
-                            let shift: u16 = 16 - rawdata.bpc();
-                            new_data[i * columns + j] = curve.curve[t as usize & 0x3fff] << shift;
+                            out[j] = curve.curve[t as usize & 0x3fff] << shift;
                         }
                     }
-                }
+                    Ok(())
+                };
+                let new_data = if let Some(rows) = rows {
+                    rows.start(columns);
+                    for _ in 0..height {
+                        decode_row(&mut rows.rows_mut()[..columns])?;
+                        rows.advance(1)?;
+                    }
+                    vec![]
+                } else {
+                    // Using uninit_vec! here is slower.
+                    let mut new_data = vec![0; height * columns];
+                    for i in 0..height {
+                        decode_row(&mut new_data[i * columns..(i + 1) * columns])?;
+                    }
+                    new_data
+                };
                 rawdata.set_width(columns as u32);
                 rawdata.set_whites([(1 << rawdata.bpc()) - 1; 4]);
                 Ok(new_data)
@@ -627,80 +737,15 @@ impl RawFileImpl for NefFile {
     }
 
     fn load_rawdata(&self, skip_decompress: bool) -> Result<RawImage> {
-        self.ifd(tiff::IfdType::Raw)
-            .ok_or_else(|| {
-                log::error!("CFA not found");
-                Error::NotFound
-            })
-            .and_then(|dir| {
-                tiff::tiff_get_rawdata(self.container.get().unwrap(), dir, self.type_())
-                    .map_err(|err| {
-                        log::error!("NEF get rawdata failed {}", err);
-                        err
-                    })
-                    .and_then(|rawdata| {
-                        let compression = rawdata.compression();
-                        probe!(self.probe, "nef.compression", &format!("{compression:?}"));
-                        if self.is_d100() {
-                            self.unpack_nikon(rawdata)
-                        } else if compression == tiff::Compression::None {
-                            Ok(rawdata)
-                        } else if compression == tiff::Compression::NikonQuantized {
-                            if !skip_decompress {
-                                log::debug!("Nikon quantized");
-                                self.decompress_nikon_quantized(rawdata).map_err(|err| {
-                                    log::error!("NEF quantized {}", err);
-                                    err
-                                })
-                            } else {
-                                Ok(rawdata)
-                            }
-                        } else if self.is_nrw() {
-                            // XXX decompression not yet supported
-                            // is this a thing?
-                            probe!(self.probe, "nef.is_nrw_compression", "true");
-                            log::error!("NRW compression unsupported");
-                            Ok(rawdata)
-                        } else {
-                            log::error!("Invalid compression {:?}", compression);
-                            Ok(rawdata)
-                        }
-                    })
-                    .map(|mut rawdata| {
-                        if let Some(blacks) = self
-                            .ifd(tiff::IfdType::MakerNote)
-                            .and_then(|dir| dir.uint_value_array(exif::MNOTE_NIKON_BLACK_LEVEL))
-                        {
-                            probe!(self.probe, "nef.blacks.mnote", true);
-                            rawdata.set_blacks(utils::to_quad(&blacks));
-                        }
-                        if let Some(wb) = self.white_balance() {
-                            rawdata.set_as_shot_neutral(&wb);
-                        }
+        self.load_rawdata_with(skip_decompress, None)
+    }
 
-                        let user_crop = self
-                            .maker_note_ifd()
-                            .and_then(|dir| dir.uint_value_array(exif::MNOTE_NIKON_CROP_AREA))
-                            .map(|user_crop| Rect {
-                                x: user_crop[0],
-                                y: user_crop[1],
-                                width: user_crop[2],
-                                height: user_crop[3],
-                            });
-                        rawdata.set_user_crop(user_crop, None);
-                        rawdata.set_active_area(Some(Rect {
-                            x: 0,
-                            y: 0,
-                            width: rawdata.width(),
-                            height: rawdata.height(),
-                        }));
-                        rawdata
-                    })
-            })
+    fn load_rawdata_rows(&self, rows: &mut RowSink) -> Result<RawImage> {
+        self.load_rawdata_with(false, Some(rows))
     }
 
     fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
+        self.builtin_colour_matrix(&MATRICES)
     }
 }
 
@@ -21,12 +21,12 @@
 
 //! Nikon xyz to rgb matrices.
 
-use crate::colour::BuiltinMatrix;
+use crate::colour::{self, BuiltinMatrix};
 use crate::nikon;
 use crate::TypeId;
 
-lazy_static::lazy_static! {
-    pub(super) static ref MATRICES: [BuiltinMatrix; 92] = [
+#[rustfmt::skip]
+pub(super) static MATRICES: [BuiltinMatrix; 92] = colour::sorted_matrices([
         BuiltinMatrix::new(
             nikon!(D1),
             0,
@@ -579,6 +579,4 @@ lazy_static::lazy_static! {
             0,
             [10601, -3487, -1127, -2931, 11443, 1676, -587, 1740, 5278],
         ),
-    ];
-
-}
+    ]);
@@ -72,77 +72,76 @@ macro_rules! olympus {
     };
 }
 
-lazy_static::lazy_static! {
-
-    static ref MAKE_TO_ID_MAP: tiff::MakeToIdMap = HashMap::from([
-        olympus!("E-1             ", E1),
-        olympus!("E-10        "    , E10),
-        olympus!("E-3             ", E3),
-        olympus!("E-30            ", E30),
-        olympus!("E-5             ", E5),
-        olympus!("E-300           ", E300),
-        olympus!("E-330           ", E330),
-        olympus!("E-400           ", E400),
-        olympus!("E-410           ", E410),
-        olympus!("E-420           ", E420),
-        olympus!("E-450           ", E450),
-        olympus!("E-500           ", E500),
-        olympus!("E-510           ", E510),
-        olympus!("E-520           ", E520),
-        olympus!("E-600           ", E600),
-        olympus!("E-620           ", E620),
-        olympus!("SP350"           , SP350),
-        olympus!("SP500UZ"         , SP500UZ),
-        olympus!("SP510UZ"         , SP510UZ),
-        olympus!("SP550UZ                ", SP550UZ),
-        olympus!("SP565UZ                ", SP565UZ),
-        olympus!("SP570UZ                ", SP570UZ),
-        olympus!("E-P1            ", EP1),
-        olympus!("E-P2            ", EP2),
-        olympus!("E-P3            ", EP3),
-        olympus!("E-P5            ", EP5),
-        olympus!("E-P7            ", EP7),
-        olympus!("E-PL1           ", EPL1),
-        olympus!("E-PL2           ", EPL2),
-        olympus!("E-PL3           ", EPL3),
-        olympus!("E-PL5           ", EPL5),
-        olympus!("E-PL6           ", EPL6),
-        olympus!("E-PL7           ", EPL7),
-        olympus!("E-PL8           ", EPL8),
-        olympus!("E-PL9           ", EPL9),
-        olympus!("E-PL10          ", EPL10),
-        olympus!("E-PM1           ", EPM1),
-        olympus!("E-PM2           ", EPM2),
-        olympus!("XZ-1            ", XZ1),
-        olympus!("XZ-10           ", XZ10),
-        olympus!("XZ-2            ", XZ2),
-        olympus!("E-M5            ", EM5),
-        olympus!("E-M5MarkII      ", EM5II),
-        olympus!("E-M5MarkIII     ", EM5III),
-        olympus!("E-M1            ", EM1),
-        olympus!("E-M1MarkII      ", EM1II),
-        olympus!("E-M1MarkIII     ", EM1III),
-        olympus!("E-M1X           ", EM1X),
-        olympus!("E-M10           ", EM10),
-        olympus!("E-M10MarkII     ", EM10II),
-        olympus!("E-M10 Mark III  ", EM10III),
-        olympus!("E-M10MarkIIIS   ", EM10IIIS),
-        olympus!("E-M10MarkIV     ", EM10IV),
-        olympus!("OM-1            ", OM1),
-        olympus!("OM-1MarkII      ", OM1II),
-        olympus!("OM-3            ", OM3),
-        olympus!("OM-5            ", OM5),
-        olympus!("STYLUS1         ", STYLUS1),
-        olympus!("STYLUS1,1s      ", STYLUS1_1S),
-        olympus!("PEN-F           ", PEN_F),
-        olympus!("SH-2            ", SH2),
-        olympus!("TG-4            ", TG4),
-        olympus!("TG-5            ", TG5),
-        olympus!("TG-6            ", TG6),
-        olympus!("TG-7            ", TG7),
-        olympus!("C5060WZ", C5060WZ),
-    ]);
+static MAKE_TO_ID_MAP: tiff::MakeToIdMap<66> = tiff::MakeToIdMap::new([
+    olympus!("E-1             ", E1),
+    olympus!("E-10        ", E10),
+    olympus!("E-3             ", E3),
+    olympus!("E-30            ", E30),
+    olympus!("E-5             ", E5),
+    olympus!("E-300           ", E300),
+    olympus!("E-330           ", E330),
+    olympus!("E-400           ", E400),
+    olympus!("E-410           ", E410),
+    olympus!("E-420           ", E420),
+    olympus!("E-450           ", E450),
+    olympus!("E-500           ", E500),
+    olympus!("E-510           ", E510),
+    olympus!("E-520           ", E520),
+    olympus!("E-600           ", E600),
+    olympus!("E-620           ", E620),
+    olympus!("SP350", SP350),
+    olympus!("SP500UZ", SP500UZ),
+    olympus!("SP510UZ", SP510UZ),
+    olympus!("SP550UZ                ", SP550UZ),
+    olympus!("SP565UZ                ", SP565UZ),
+    olympus!("SP570UZ                ", SP570UZ),
+    olympus!("E-P1            ", EP1),
+    olympus!("E-P2            ", EP2),
+    olympus!("E-P3            ", EP3),
+    olympus!("E-P5            ", EP5),
+    olympus!("E-P7            ", EP7),
+    olympus!("E-PL1           ", EPL1),
+    olympus!("E-PL2           ", EPL2),
+    olympus!("E-PL3           ", EPL3),
+    olympus!("E-PL5           ", EPL5),
+    olympus!("E-PL6           ", EPL6),
+    olympus!("E-PL7           ", EPL7),
+    olympus!("E-PL8           ", EPL8),
+    olympus!("E-PL9           ", EPL9),
+    olympus!("E-PL10          ", EPL10),
+    olympus!("E-PM1           ", EPM1),
+    olympus!("E-PM2           ", EPM2),
+    olympus!("XZ-1            ", XZ1),
+    olympus!("XZ-10           ", XZ10),
+    olympus!("XZ-2            ", XZ2),
+    olympus!("E-M5            ", EM5),
+    olympus!("E-M5MarkII      ", EM5II),
+    olympus!("E-M5MarkIII     ", EM5III),
+    olympus!("E-M1            ", EM1),
+    olympus!("E-M1MarkII      ", EM1II),
+    olympus!("E-M1MarkIII     ", EM1III),
+    olympus!("E-M1X           ", EM1X),
+    olympus!("E-M10           ", EM10),
+    olympus!("E-M10MarkII     ", EM10II),
+    olympus!("E-M10 Mark III  ", EM10III),
+    olympus!("E-M10MarkIIIS   ", EM10IIIS),
+    olympus!("E-M10MarkIV     ", EM10IV),
+    olympus!("OM-1            ", OM1),
+    olympus!("OM-1MarkII      ", OM1II),
+    olympus!("OM-3            ", OM3),
+    olympus!("OM-5            ", OM5),
+    olympus!("STYLUS1         ", STYLUS1),
+    olympus!("STYLUS1,1s      ", STYLUS1_1S),
+    olympus!("PEN-F           ", PEN_F),
+    olympus!("SH-2            ", SH2),
+    olympus!("TG-4            ", TG4),
+    olympus!("TG-5            ", TG5),
+    olympus!("TG-6            ", TG6),
+    olympus!("TG-7            ", TG7),
+    olympus!("C5060WZ", C5060WZ),
+]);
 
+lazy_static::lazy_static! {
     static ref MNOTE_TAG_TO_DIRID: HashMap<u16, &'static str> = HashMap::from([
         (exif::ORF_TAG_CAMERA_SETTINGS, "Exif.OlympusCs"),
         (exif::ORF_TAG_IMAGE_PROCESSING, "Exif.OlympusIp"),
@@ -611,7 +610,7 @@ impl RawFileImpl for OrfFile {
     }
 
     fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
+        self.builtin_colour_matrix(&MATRICES)
     }
 }
 
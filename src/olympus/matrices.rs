@@ -20,12 +20,12 @@
 
 //! Olympus matrices
 
-use crate::colour::BuiltinMatrix;
+use crate::colour::{self, BuiltinMatrix};
 use crate::olympus;
 use crate::TypeId;
 
-lazy_static::lazy_static! {
-    pub(super) static ref MATRICES: [BuiltinMatrix; 66] = [
+#[rustfmt::skip]
+pub(super) static MATRICES: [BuiltinMatrix; 66] = colour::sorted_matrices([
     BuiltinMatrix::new( olympus!(E1),
       0,
       0,
@@ -290,5 +290,4 @@ lazy_static::lazy_static! {
       0,
       0,
       [ 10445, -3362, -1307, -7662, 15690, 2058, -1135, 1176, 7602 ] ),
-    ];
-}
+    ]);
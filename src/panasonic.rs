@@ -23,13 +23,12 @@
 
 pub mod decompress;
 
-use std::collections::HashMap;
 use std::rc::Rc;
 
 use num_enum::FromPrimitive;
 use once_cell::unsync::OnceCell;
 
-use crate::colour::BuiltinMatrix;
+use crate::colour::{self, BuiltinMatrix};
 use crate::container::{Endian, RawContainer};
 use crate::io::Viewer;
 use crate::jpeg;
@@ -67,152 +66,151 @@ pub use tiff::exif::generated::MNOTE_PANASONIC_TAG_NAMES as MNOTE_TAG_NAMES;
 use tiff::exif::generated::RAW_PANASONIC_CAMERAIFD_TAG_NAMES as RAW_CAMERAIFD_TAG_NAMES;
 pub use tiff::exif::generated::RAW_PANASONIC_TAG_NAMES as RAW_TAG_NAMES;
 
-lazy_static::lazy_static! {
-    static ref MAKE_TO_ID_MAP: tiff::MakeToIdMap = HashMap::from([
-        panasonic!("DMC-CM1", CM1),
-        panasonic!("DMC-GF1", GF1),
-        panasonic!("DMC-GF2", GF2),
-        panasonic!("DMC-GF3", GF3),
-        panasonic!("DMC-GF5", GF5),
-        panasonic!("DMC-GF6", GF6),
-        panasonic!("DMC-GF7", GF7),
-        panasonic!("DMC-GF8", GF8),
-        panasonic!("DC-GF10", GF10),
-        panasonic!("DMC-GX1", GX1),
-        panasonic!("DMC-GX7", GX7),
-        panasonic!("DMC-GX7MK2", GX7MK2),
-        panasonic!("DC-GX7MK3", GX7MK3),
-        panasonic!("DMC-GX8", GX8),
-        panasonic!("DMC-GX80", GX80),
-        panasonic!("DMC-GX85", GX85),
-        panasonic!("DC-GX800", GX800),
-        panasonic!("DC-GX850", GX850),
-        panasonic!("DC-GX880", GX880),
-        panasonic!("DC-GX9", GX9),
-        panasonic!("DMC-FX150", FX150),
-        panasonic!("DMC-FZ8", FZ8),
-        panasonic!("DMC-FZ1000", DMC_FZ1000),
-        panasonic!("DC-FZ10002", DC_FZ1000M2),
-        panasonic!("DC-FZ1000M2", DC_FZ1000M2),
-        panasonic!("DMC-FZ18", FZ18),
-        panasonic!("DMC-FZ150", FZ150),
-        panasonic!("DMC-FZ28", FZ28),
-        panasonic!("DMC-FZ30", FZ30),
-        panasonic!("DMC-FZ300", FZ300),
-        panasonic!("DMC-FZ35", FZ35),
-        panasonic!("DMC-FZ38", FZ38),
-        panasonic!("DMC-FZ40", DMC_FZ40),
-        panasonic!("DMC-FZ45", DMC_FZ45),
-        // Not the same as above
-        panasonic!("DC-FZ45", DC_FZ45),
-        panasonic!("DMC-FZ50", FZ50),
-        panasonic!("DMC-FZ70", FZ70),
-        panasonic!("DMC-FZ72", FZ72),
-        panasonic!("DMC-FZ100", FZ100),
-        panasonic!("DMC-FZ200", FZ200),
-        panasonic!("DMC-FZ2500", FZ2500),
-        // Alias to DMC-FZ2500
-        panasonic!("DMC-FZ2000", FZ2000),
-        panasonic!("DMC-FZ330", FZ330),
-        panasonic!("DC-FZ80", FZ80),
-        panasonic!("DC-FZ82", FZ82),
-        panasonic!("DMC-G1", G1),
-        panasonic!("DMC-G2", G2),
-        panasonic!("DMC-G3", G3),
-        panasonic!("DMC-G5", G5),
-        panasonic!("DMC-G6", G6),
-        panasonic!("DMC-G7", G7),
-        panasonic!("DMC-G70", G70),
-        panasonic!("DMC-G10", G10),
-        panasonic!("DMC-G80", G80),
-        panasonic!("DMC-G81", G81),
-        panasonic!("DC-G9", G9),
-        panasonic!("DC-G9M2", G9M2),
-        panasonic!("DC-G90", DC_G90),
-        panasonic!("DC-G91", DC_G91),
-        panasonic!("DC-G95", DC_G95),
-        panasonic!("DC-G95D", DC_G95D),
-        panasonic!("DC-G99", DC_G99),
-        panasonic!("DC-G100", DC_G100),
-        panasonic!("DC-G100D", DC_G100D),
-        panasonic!("DC-G110", DC_G110),
-        panasonic!("DMC-GH1", GH1),
-        panasonic!("DMC-GH2", GH2),
-        panasonic!("DMC-GH3", GH3),
-        panasonic!("DMC-GH4", GH4),
-        panasonic!("DC-GH5", GH5),
-        panasonic!("DC-GH5S", GH5S),
-        panasonic!("DC-GH5M2", GH5M2),
-        panasonic!("DC-GH6", GH6),
-        panasonic!("DC-GH7", GH7),
-        panasonic!("DMC-GM1", GM1),
-        panasonic!("DMC-GM1S", GM1S),
-        panasonic!("DMC-GM5", GM5),
-        panasonic!("DMC-LF1", LF1),
-        panasonic!("DMC-LX1", LX1),
-        panasonic!("DMC-LX2", LX2),
-        panasonic!("DMC-LX3", LX3),
-        panasonic!("DMC-LX5", LX5),
-        panasonic!("DMC-LX7", LX7),
-        panasonic!("DMC-LX10", LX10),
-        panasonic!("DMC-LX15", LX15),
-        panasonic!("DMC-LX100", LX100),
-        panasonic!("DC-LX100M2", LX100M2),
-        panasonic!("DMC-L1", L1),
-        panasonic!("DMC-L10", L10),
-        panasonic!("DC-S1", DC_S1),
-        panasonic!("DC-S1R", DC_S1R),
-        panasonic!("DC-S1RM2", DC_S1RM2),
-        panasonic!("DC-S1H", DC_S1H),
-        panasonic!("DC-S5", DC_S5),
-        panasonic!("DC-S5M2", DC_S5M2),
-        panasonic!("DC-S5M2X", DC_S5M2X),
-        panasonic!("DC-S9", DC_S9),
-        panasonic!("DMC-TZ70", TZ70),
-        panasonic!("DMC-ZS60", ZS60),
-        // Aliases to DMC-ZS60 (2)
-        panasonic!("DMC-TZ80", TZ80),
-        panasonic!("DMC-TZ81", TZ81),
-        panasonic!("DMC-ZS100", ZS100),
-        // Aliases to DMC-ZS100
-        panasonic!("DMC-TX1", TX1),
-        panasonic!("DMC-TZ100", TZ100),
-        panasonic!("DMC-TZ101", TZ101),
-        panasonic!("DMC-TZ110", TZ110),
-        panasonic!("DC-ZS200", ZS200),
-        // Aliases to DC-ZS200
-        panasonic!("DC-TZ202", TZ202),
-        panasonic!("DC-ZS80", DC_ZS80),
-        panasonic!("DC-ZS200D", ZS200D),
-        // Aliases to DC-ZS80
-        panasonic!("DC-TZ95", DC_TZ95),
-        panasonic!("DC-TZ96", DC_TZ96),
-        panasonic!("DMC-ZS40", ZS40),
-        // Aliases to DMC-ZS40
-        panasonic!("DMC-TZ60", TZ60),
-        panasonic!("DMC-TZ61", TZ61),
-        // Aliases to DMC-ZS50
-        panasonic!("DMC-TZ71", TZ71),
-        // Aliases to DMC-ZS70
-        panasonic!("DMC-TZ90", TZ90),
+static MAKE_TO_ID_MAP: tiff::MakeToIdMap<131> = tiff::MakeToIdMap::new([
+    panasonic!("DMC-CM1", CM1),
+    panasonic!("DMC-GF1", GF1),
+    panasonic!("DMC-GF2", GF2),
+    panasonic!("DMC-GF3", GF3),
+    panasonic!("DMC-GF5", GF5),
+    panasonic!("DMC-GF6", GF6),
+    panasonic!("DMC-GF7", GF7),
+    panasonic!("DMC-GF8", GF8),
+    panasonic!("DC-GF10", GF10),
+    panasonic!("DMC-GX1", GX1),
+    panasonic!("DMC-GX7", GX7),
+    panasonic!("DMC-GX7MK2", GX7MK2),
+    panasonic!("DC-GX7MK3", GX7MK3),
+    panasonic!("DMC-GX8", GX8),
+    panasonic!("DMC-GX80", GX80),
+    panasonic!("DMC-GX85", GX85),
+    panasonic!("DC-GX800", GX800),
+    panasonic!("DC-GX850", GX850),
+    panasonic!("DC-GX880", GX880),
+    panasonic!("DC-GX9", GX9),
+    panasonic!("DMC-FX150", FX150),
+    panasonic!("DMC-FZ8", FZ8),
+    panasonic!("DMC-FZ1000", DMC_FZ1000),
+    panasonic!("DC-FZ10002", DC_FZ1000M2),
+    panasonic!("DC-FZ1000M2", DC_FZ1000M2),
+    panasonic!("DMC-FZ18", FZ18),
+    panasonic!("DMC-FZ150", FZ150),
+    panasonic!("DMC-FZ28", FZ28),
+    panasonic!("DMC-FZ30", FZ30),
+    panasonic!("DMC-FZ300", FZ300),
+    panasonic!("DMC-FZ35", FZ35),
+    panasonic!("DMC-FZ38", FZ38),
+    panasonic!("DMC-FZ40", DMC_FZ40),
+    panasonic!("DMC-FZ45", DMC_FZ45),
+    // Not the same as above
+    panasonic!("DC-FZ45", DC_FZ45),
+    panasonic!("DMC-FZ50", FZ50),
+    panasonic!("DMC-FZ70", FZ70),
+    panasonic!("DMC-FZ72", FZ72),
+    panasonic!("DMC-FZ100", FZ100),
+    panasonic!("DMC-FZ200", FZ200),
+    panasonic!("DMC-FZ2500", FZ2500),
+    // Alias to DMC-FZ2500
+    panasonic!("DMC-FZ2000", FZ2000),
+    panasonic!("DMC-FZ330", FZ330),
+    panasonic!("DC-FZ80", FZ80),
+    panasonic!("DC-FZ82", FZ82),
+    panasonic!("DMC-G1", G1),
+    panasonic!("DMC-G2", G2),
+    panasonic!("DMC-G3", G3),
+    panasonic!("DMC-G5", G5),
+    panasonic!("DMC-G6", G6),
+    panasonic!("DMC-G7", G7),
+    panasonic!("DMC-G70", G70),
+    panasonic!("DMC-G10", G10),
+    panasonic!("DMC-G80", G80),
+    panasonic!("DMC-G81", G81),
+    panasonic!("DC-G9", G9),
+    panasonic!("DC-G9M2", G9M2),
+    panasonic!("DC-G90", DC_G90),
+    panasonic!("DC-G91", DC_G91),
+    panasonic!("DC-G95", DC_G95),
+    panasonic!("DC-G95D", DC_G95D),
+    panasonic!("DC-G99", DC_G99),
+    panasonic!("DC-G100", DC_G100),
+    panasonic!("DC-G100D", DC_G100D),
+    panasonic!("DC-G110", DC_G110),
+    panasonic!("DMC-GH1", GH1),
+    panasonic!("DMC-GH2", GH2),
+    panasonic!("DMC-GH3", GH3),
+    panasonic!("DMC-GH4", GH4),
+    panasonic!("DC-GH5", GH5),
+    panasonic!("DC-GH5S", GH5S),
+    panasonic!("DC-GH5M2", GH5M2),
+    panasonic!("DC-GH6", GH6),
+    panasonic!("DC-GH7", GH7),
+    panasonic!("DMC-GM1", GM1),
+    panasonic!("DMC-GM1S", GM1S),
+    panasonic!("DMC-GM5", GM5),
+    panasonic!("DMC-LF1", LF1),
+    panasonic!("DMC-LX1", LX1),
+    panasonic!("DMC-LX2", LX2),
+    panasonic!("DMC-LX3", LX3),
+    panasonic!("DMC-LX5", LX5),
+    panasonic!("DMC-LX7", LX7),
+    panasonic!("DMC-LX10", LX10),
+    panasonic!("DMC-LX15", LX15),
+    panasonic!("DMC-LX100", LX100),
+    panasonic!("DC-LX100M2", LX100M2),
+    panasonic!("DMC-L1", L1),
+    panasonic!("DMC-L10", L10),
+    panasonic!("DC-S1", DC_S1),
+    panasonic!("DC-S1R", DC_S1R),
+    panasonic!("DC-S1RM2", DC_S1RM2),
+    panasonic!("DC-S1H", DC_S1H),
+    panasonic!("DC-S5", DC_S5),
+    panasonic!("DC-S5M2", DC_S5M2),
+    panasonic!("DC-S5M2X", DC_S5M2X),
+    panasonic!("DC-S9", DC_S9),
+    panasonic!("DMC-TZ70", TZ70),
+    panasonic!("DMC-ZS60", ZS60),
+    // Aliases to DMC-ZS60 (2)
+    panasonic!("DMC-TZ80", TZ80),
+    panasonic!("DMC-TZ81", TZ81),
+    panasonic!("DMC-ZS100", ZS100),
+    // Aliases to DMC-ZS100
+    panasonic!("DMC-TX1", TX1),
+    panasonic!("DMC-TZ100", TZ100),
+    panasonic!("DMC-TZ101", TZ101),
+    panasonic!("DMC-TZ110", TZ110),
+    panasonic!("DC-ZS200", ZS200),
+    // Aliases to DC-ZS200
+    panasonic!("DC-TZ202", TZ202),
+    panasonic!("DC-ZS80", DC_ZS80),
+    panasonic!("DC-ZS200D", ZS200D),
+    // Aliases to DC-ZS80
+    panasonic!("DC-TZ95", DC_TZ95),
+    panasonic!("DC-TZ96", DC_TZ96),
+    panasonic!("DMC-ZS40", ZS40),
+    // Aliases to DMC-ZS40
+    panasonic!("DMC-TZ60", TZ60),
+    panasonic!("DMC-TZ61", TZ61),
+    // Aliases to DMC-ZS50
+    panasonic!("DMC-TZ71", TZ71),
+    // Aliases to DMC-ZS70
+    panasonic!("DMC-TZ90", TZ90),
+    leica!("DIGILUX 2", DIGILUX2),
+    leica!("DIGILUX 3", DIGILUX3),
+    leica!("D-LUX 3", DLUX_3),
+    leica!("D-LUX 4", DLUX_4),
+    leica!("D-LUX 5", DLUX_5),
+    leica!("D-LUX 6", DLUX_6),
+    leica!("D-Lux 7", DLUX_7),
+    leica!("V-LUX 1", VLUX_1),
+    leica!("D-LUX (Typ 109)", DLUX_TYP109),
+    leica!("V-LUX 4", VLUX_4),
+    leica!("V-Lux 5", VLUX_5),
+    leica!("V-LUX (Typ 114)", VLUX_TYP114),
+    leica!("C-Lux", CLUX),
+    leica!("C (Typ 112)", C_TYP112),
+]);
 
-        leica!("DIGILUX 2", DIGILUX2),
-        leica!("DIGILUX 3", DIGILUX3),
-        leica!("D-LUX 3", DLUX_3),
-        leica!("D-LUX 4", DLUX_4),
-        leica!("D-LUX 5", DLUX_5),
-        leica!("D-LUX 6", DLUX_6),
-        leica!("D-Lux 7", DLUX_7),
-        leica!("V-LUX 1", VLUX_1),
-        leica!("D-LUX (Typ 109)", DLUX_TYP109),
-        leica!("V-LUX 4", VLUX_4),
-        leica!("V-Lux 5", VLUX_5),
-        leica!("V-LUX (Typ 114)", VLUX_TYP114),
-        leica!("C-Lux", CLUX),
-        leica!("C (Typ 112)", C_TYP112),
-    ]);
-
-    static ref MATRICES: [BuiltinMatrix; 103] = [
+#[rustfmt::skip]
+static MATRICES: [BuiltinMatrix; 103] = colour::sorted_matrices([
         BuiltinMatrix::new(
             panasonic!(CM1),
             15,
@@ -730,8 +728,7 @@ lazy_static::lazy_static! {
             0,
             0,
             [ 9379, -3267, -816, -3227, 11560, 1881, -926, 1928, 5340 ] ),
-    ];
-}
+    ]);
 
 struct Rw2Fixup {}
 
@@ -1129,7 +1126,9 @@ impl RawFileImpl for Rw2File {
                 .uint_value(exif::RW2_TAG_LINEARITY_LIMIT_BLUE)
                 .unwrap_or((1 << bpc) - 1) as u16;
 
-            raw_data.set_whites([wr, wg, wb, wg]);
+            // The levels are per colour.
+            let pattern = raw_data.mosaic_pattern().clone();
+            raw_data.set_whites(pattern.levels_from_rggb([wr, wg, wg, wb]));
 
             let br = cfa
                 .uint_value(exif::RW2_TAG_BLACK_LEVEL_RED)
@@ -1140,7 +1139,7 @@ impl RawFileImpl for Rw2File {
             let bb = cfa
                 .uint_value(exif::RW2_TAG_BLACK_LEVEL_BLUE)
                 .unwrap_or((1 << bpc) - 1) as u16;
-            raw_data.set_blacks([br, bg, bb, bg]);
+            raw_data.set_blacks(pattern.levels_from_rggb([br, bg, bg, bb]));
 
             let wbr = cfa.uint_value(exif::RW2_TAG_WB_RED_LEVEL);
             let wbg = cfa.uint_value(exif::RW2_TAG_WB_GREEN_LEVEL);
@@ -1173,7 +1172,7 @@ impl RawFileImpl for Rw2File {
     }
 
     fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
+        self.builtin_colour_matrix(&MATRICES)
     }
 }
 
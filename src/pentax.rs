@@ -21,16 +21,17 @@
 
 //! Pentax camera support.
 
-use std::collections::HashMap;
 use std::rc::Rc;
 
 use once_cell::unsync::OnceCell;
 
 use crate::bitmap::Bitmap;
-use crate::colour::BuiltinMatrix;
+use crate::colour::{self, BuiltinMatrix};
 use crate::container::RawContainer;
 use crate::io::Viewer;
+use crate::lookup::ModelIdMap;
 use crate::rawfile::{RawFileHandleType, ThumbnailStorage};
+use crate::rows::RowSink;
 use crate::tiff;
 use crate::tiff::{exif, Dir, Ifd};
 use crate::utils;
@@ -81,82 +82,82 @@ macro_rules! ricoh {
 
 pub use crate::tiff::exif::generated::MNOTE_PENTAX_TAG_NAMES as MNOTE_TAG_NAMES;
 
-lazy_static::lazy_static! {
-    static ref PENTAX_MODEL_ID_MAP: HashMap<u32, TypeId> = HashMap::from([
-        pentax!(0x12994, IST_D_PEF),
-        pentax!(0x12aa2, IST_DS_PEF),
-        pentax!(0x12b1a, IST_DL_PEF),
-        // *ist DS2
-        pentax!(0x12b7e, IST_DL2_PEF),
-        pentax!(0x12b9c, K100D_PEF),
-        pentax!(0x12b9d, K110D_PEF),
-        pentax!(0x12ba2, K100D_SUPER_PEF),
-        pentax!(0x12c1e, K10D_PEF),
-        pentax!(0x12cd2, K20D_PEF),
-        pentax!(0x12cfa, K200D_PEF),
-        pentax!(0x12d72, K2000_PEF),
-        pentax!(0x12d73, KM_PEF),
-        pentax!(0x12db8, K7_PEF),
-        pentax!(0x12dfe, KX_PEF),
-        pentax!(0x12e08, PENTAX_645D_PEF),
-        pentax!(0x12e6c, KR_PEF),
-        pentax!(0x12e76, K5_PEF),
-        // Q
-        // K-01
-        // K-30
-        // Q10
-        pentax!(0x12f70, K5_II_PEF),
-        pentax!(0x12f71, K5_IIS_PEF),
-        // Q7
-        // K-50
-        pentax!(0x12fc0, K3_PEF),
-        // K-500
-        ricoh!(0x13010, PENTAX_645Z_PEF),
-        pentax!(0x1301a, KS1_PEF),
-        pentax!(0x13024, KS2_PEF),
-        // Q-S1
-        pentax!(0x13092, K1_PEF),
-        pentax!(0x1309c, K3_II_PEF),
-        // GR III
-        pentax!(0x13222, K70_PEF),
-        pentax!(0x1322c, KP_PEF),
-        pentax!(0x13240, K1_MKII_PEF),
-        pentax!(0x13254, K3_MKIII_PEF),
-    ]);
+static PENTAX_MODEL_ID_MAP: ModelIdMap<29> = ModelIdMap::new([
+    pentax!(0x12994, IST_D_PEF),
+    pentax!(0x12aa2, IST_DS_PEF),
+    pentax!(0x12b1a, IST_DL_PEF),
+    // *ist DS2
+    pentax!(0x12b7e, IST_DL2_PEF),
+    pentax!(0x12b9c, K100D_PEF),
+    pentax!(0x12b9d, K110D_PEF),
+    pentax!(0x12ba2, K100D_SUPER_PEF),
+    pentax!(0x12c1e, K10D_PEF),
+    pentax!(0x12cd2, K20D_PEF),
+    pentax!(0x12cfa, K200D_PEF),
+    pentax!(0x12d72, K2000_PEF),
+    pentax!(0x12d73, KM_PEF),
+    pentax!(0x12db8, K7_PEF),
+    pentax!(0x12dfe, KX_PEF),
+    pentax!(0x12e08, PENTAX_645D_PEF),
+    pentax!(0x12e6c, KR_PEF),
+    pentax!(0x12e76, K5_PEF),
+    // Q
+    // K-01
+    // K-30
+    // Q10
+    pentax!(0x12f70, K5_II_PEF),
+    pentax!(0x12f71, K5_IIS_PEF),
+    // Q7
+    // K-50
+    pentax!(0x12fc0, K3_PEF),
+    // K-500
+    ricoh!(0x13010, PENTAX_645Z_PEF),
+    pentax!(0x1301a, KS1_PEF),
+    pentax!(0x13024, KS2_PEF),
+    // Q-S1
+    pentax!(0x13092, K1_PEF),
+    pentax!(0x1309c, K3_II_PEF),
+    // GR III
+    pentax!(0x13222, K70_PEF),
+    pentax!(0x1322c, KP_PEF),
+    pentax!(0x13240, K1_MKII_PEF),
+    pentax!(0x13254, K3_MKIII_PEF),
+]);
 
-    static ref MAKE_TO_ID_MAP: tiff::MakeToIdMap = HashMap::from([
-        pentax!("PENTAX *ist D      ", IST_D_PEF),
-        pentax!("PENTAX *ist DL     ", IST_DL_PEF),
-        pentax!("PENTAX *ist DL2    ", IST_DL2_PEF),
-        pentax!("PENTAX *ist DS     ", IST_DS_PEF),
-        pentax!("PENTAX K10D        ", K10D_PEF),
-        pentax!("PENTAX K100D       ", K100D_PEF),
-        pentax!("PENTAX K100D Super ", K100D_SUPER_PEF),
-        pentax!("PENTAX K110D       ", K110D_PEF),
-        pentax!("PENTAX K20D        ", K20D_PEF),
-        pentax!("PENTAX K200D       ", K200D_PEF),
-        pentax!("PENTAX K2000       ", K2000_PEF),
-        pentax!("PENTAX K-1         ", K1_PEF),
-        pentax!("PENTAX K-1 Mark II ", K1_MKII_PEF),
-        pentax!("PENTAX K-r         ", KR_PEF),
-        pentax!("PENTAX K-3         ", K3_PEF),
-        pentax!("PENTAX K-3 II      ", K3_II_PEF),
-        pentax!("PENTAX K-3 Mark III             ", K3_MKIII_PEF),
-        pentax!("PENTAX K-5         ", K5_PEF),
-        pentax!("PENTAX K-5 II      ", K5_II_PEF),
-        pentax!("PENTAX K-5 II s    ", K5_IIS_PEF),
-        pentax!("PENTAX K-7         ", K7_PEF),
-        pentax!("PENTAX K-70        ", K70_PEF),
-        pentax!("PENTAX K-S1        ", KS1_PEF),
-        pentax!("PENTAX K-S2        ", KS2_PEF),
-        pentax!("PENTAX K-m         ", KM_PEF),
-        pentax!("PENTAX K-x         ", KX_PEF),
-        pentax!("PENTAX KP          ", KP_PEF),
-        pentax!("PENTAX 645D        ", PENTAX_645D_PEF),
-        ricoh!("PENTAX 645Z        ", PENTAX_645Z_PEF),
-    ]);
+static MAKE_TO_ID_MAP: tiff::MakeToIdMap<29> = tiff::MakeToIdMap::new([
+    pentax!("PENTAX *ist D      ", IST_D_PEF),
+    pentax!("PENTAX *ist DL     ", IST_DL_PEF),
+    pentax!("PENTAX *ist DL2    ", IST_DL2_PEF),
+    pentax!("PENTAX *ist DS     ", IST_DS_PEF),
+    pentax!("PENTAX K10D        ", K10D_PEF),
+    pentax!("PENTAX K100D       ", K100D_PEF),
+    pentax!("PENTAX K100D Super ", K100D_SUPER_PEF),
+    pentax!("PENTAX K110D       ", K110D_PEF),
+    pentax!("PENTAX K20D        ", K20D_PEF),
+    pentax!("PENTAX K200D       ", K200D_PEF),
+    pentax!("PENTAX K2000       ", K2000_PEF),
+    pentax!("PENTAX K-1         ", K1_PEF),
+    pentax!("PENTAX K-1 Mark II ", K1_MKII_PEF),
+    pentax!("PENTAX K-r         ", KR_PEF),
+    pentax!("PENTAX K-3         ", K3_PEF),
+    pentax!("PENTAX K-3 II      ", K3_II_PEF),
+    pentax!("PENTAX K-3 Mark III             ", K3_MKIII_PEF),
+    pentax!("PENTAX K-5         ", K5_PEF),
+    pentax!("PENTAX K-5 II      ", K5_II_PEF),
+    pentax!("PENTAX K-5 II s    ", K5_IIS_PEF),
+    pentax!("PENTAX K-7         ", K7_PEF),
+    pentax!("PENTAX K-70        ", K70_PEF),
+    pentax!("PENTAX K-S1        ", KS1_PEF),
+    pentax!("PENTAX K-S2        ", KS2_PEF),
+    pentax!("PENTAX K-m         ", KM_PEF),
+    pentax!("PENTAX K-x         ", KX_PEF),
+    pentax!("PENTAX KP          ", KP_PEF),
+    pentax!("PENTAX 645D        ", PENTAX_645D_PEF),
+    ricoh!("PENTAX 645Z        ", PENTAX_645Z_PEF),
+]);
 
-    pub(super) static ref MATRICES: [BuiltinMatrix; 29] = [
+#[rustfmt::skip]
+pub(super) static MATRICES: [BuiltinMatrix; 29] = colour::sorted_matrices([
         BuiltinMatrix::new(
             pentax!(IST_D_PEF),
             0,
@@ -331,8 +332,7 @@ lazy_static::lazy_static! {
             0x3fff,
             [9519, -3591, -664, -4074, 11725, 2671, -624, 1501, 6653],
         ),
-    ];
-}
+    ]);
 
 #[derive(Debug)]
 pub(crate) struct PefFile {
@@ -355,100 +355,19 @@ impl PefFile {
             probe: None,
         })
     }
-}
-
-impl RawFileImpl for PefFile {
-    #[cfg(feature = "probe")]
-    probe_imp!();
-
-    fn identify_id(&self) -> Result<TypeId> {
-        self.type_id
-            .get_or_try_init(|| {
-                self.container()?;
-                if let Some(maker_note) = self.maker_note_ifd() {
-                    if let Some(id) = maker_note.uint_value(exif::MNOTE_PENTAX_MODEL_ID) {
-                        log::debug!("Pentax model ID: {:x} ({})", id, id);
-                        return Ok(PENTAX_MODEL_ID_MAP
-                            .get(&id)
-                            .copied()
-                            .unwrap_or(pentax!(UNKNOWN)));
-                    } else {
-                        log::error!("Pentax model ID tag not found");
-                    }
-                }
-                let container = self.container.get().unwrap();
-                Ok(
-                    tiff::identify_with_exif(container, &MAKE_TO_ID_MAP)
-                        .unwrap_or(pentax!(UNKNOWN)),
-                )
-            })
-            .copied()
-    }
-
-    fn container(&self) -> Result<&dyn RawContainer> {
-        self.container
-            .get_or_try_init(|| {
-                let view = Viewer::create_view(&self.reader, 0).context("Error creating view")?;
-                let mut container = tiff::Container::new(
-                    view,
-                    vec![
-                        (tiff::IfdType::Main, None),
-                        (tiff::IfdType::Other, None),
-                        (tiff::IfdType::Other, None),
-                    ],
-                    self.type_(),
-                );
-                container.load(None).context("PEF container error")?;
-                probe!(
-                    self.probe,
-                    "raw.container.endian",
-                    &format!("{:?}", container.endian())
-                );
-                Ok(Box::new(container))
-            })
-            .map(|b| b.as_ref() as &dyn RawContainer)
-    }
-
-    fn thumbnails(&self) -> Result<&ThumbnailStorage> {
-        self.thumbnails.get_or_try_init(|| {
-            self.container()?;
-            let container = self.container.get().unwrap();
-            let mut thumbnails = tiff::tiff_thumbnails(container);
-
-            self.ifd(tiff::IfdType::MakerNote).and_then(|mnote| {
-                // The MakerNote has a MNOTE_PENTAX_PREVIEW_IMAGE_SIZE
-                // That contain w in [0] and h in [1]
-                let start =
-                    mnote.uint_value(exif::MNOTE_PENTAX_PREVIEW_IMAGE_START)? + mnote.mnote_offset;
-                let len = mnote.uint_value(exif::MNOTE_PENTAX_PREVIEW_IMAGE_LENGTH)?;
-                container
-                    .add_thumbnail_from_stream(start, len, &mut thumbnails)
-                    .ok()
-            });
-
-            Ok(ThumbnailStorage::with_thumbnails(thumbnails))
-        })
-    }
 
-    fn ifd(&self, ifd_type: tiff::IfdType) -> Option<&Dir> {
-        self.container().ok()?;
-        let container = self.container.get().unwrap();
-        match ifd_type {
-            tiff::IfdType::Main | tiff::IfdType::Raw => container.directory(0),
-            tiff::IfdType::Exif => container.exif_dir(),
-            tiff::IfdType::MakerNote => container.mnote_dir(),
-            _ => None,
-        }
-    }
-
-    fn load_rawdata(&self, _skip_decompress: bool) -> Result<RawImage> {
+    /// Load the raw data. If `rows` is passed, the data is output into
+    /// it instead, when it can be decoded by rows.
+    fn load_rawdata_with(&self, mut rows: Option<&mut RowSink>) -> Result<RawImage> {
         self.container()?;
         let type_id = self.type_id()?;
         let container = self.container.get().unwrap();
         self.ifd(tiff::IfdType::Raw)
             .ok_or(Error::NotFound)
-            .and_then(|dir| tiff::tiff_get_rawdata(container, dir, self.type_()))
-            .map(|mut rawdata| {
+            .and_then(|dir| {
+                tiff::tiff_get_rawdata_rows(container, dir, self.type_(), rows.as_deref_mut())
+            })
+            .and_then(|mut rawdata| {
                 if let Some(mnote) = self.ifd(tiff::IfdType::MakerNote) {
                     let user_crop = mnote
                         .entry(exif::MNOTE_PENTAX_IMAGEAREAOFFSET)
@@ -507,10 +426,8 @@ impl RawFileImpl for PefFile {
                     if let Some(white) = mnote.uint_value(exif::MNOTE_PENTAX_WHITELEVEL) {
                         probe!(self.probe, "pef.whites", "true");
                         rawdata.set_whites([white as u16; 4]);
-                    } else if let Some((black, white)) = MATRICES
-                        .iter()
-                        .find(|m| m.camera == type_id)
-                        .map(|m| (m.black, m.white))
+                    } else if let Some((black, white)) =
+                        colour::find_builtin_matrix(&MATRICES, type_id).map(|m| (m.black, m.white))
                     {
                         if white != 0 {
                             probe!(self.probe, "pef.whites.static", "true");
@@ -544,23 +461,125 @@ impl RawFileImpl for PefFile {
                         .as_ref()
                         .map(|huffman| (huffman.as_slice(), container.endian()));
                     probe!(self.probe, "pef.compression.huffman", huffman.is_some());
-                    if let Ok(image) = decompress::decompress(
-                        data8,
-                        huffman,
-                        rawdata.width() as usize,
-                        rawdata.height() as usize,
-                    ) {
-                        rawdata.set_data16(image);
-                        rawdata.set_data_type(DataType::Raw);
-                        rawdata.set_compression(tiff::Compression::None);
+                    let width = rawdata.width() as usize;
+                    let height = rawdata.height() as usize;
+                    let image = match rows.as_deref_mut() {
+                        Some(rows) => {
+                            decompress::decompress_rows(data8, huffman, width, height, rows)
+                                .map(|_| vec![])
+                        }
+                        None => decompress::decompress(data8, huffman, width, height),
+                    };
+                    match image {
+                        Ok(image) => {
+                            rawdata.set_data16(image);
+                            rawdata.set_data_type(DataType::Raw);
+                            rawdata.set_compression(tiff::Compression::None);
+                        }
+                        // The rows output so far can't be taken back.
+                        Err(err) if rows.is_some() => return Err(err),
+                        Err(_) => {}
+                    }
+                }
+                Ok(rawdata)
+            })
+    }
+}
+
+impl RawFileImpl for PefFile {
+    #[cfg(feature = "probe")]
+    probe_imp!();
+
+    fn identify_id(&self) -> Result<TypeId> {
+        self.type_id
+            .get_or_try_init(|| {
+                self.container()?;
+                if let Some(maker_note) = self.maker_note_ifd() {
+                    if let Some(id) = maker_note.uint_value(exif::MNOTE_PENTAX_MODEL_ID) {
+                        log::debug!("Pentax model ID: {:x} ({})", id, id);
+                        return Ok(PENTAX_MODEL_ID_MAP
+                            .get(&id)
+                            .copied()
+                            .unwrap_or(pentax!(UNKNOWN)));
+                    } else {
+                        log::error!("Pentax model ID tag not found");
                     }
                 }
-                rawdata
+                let container = self.container.get().unwrap();
+                Ok(
+                    tiff::identify_with_exif(container, &MAKE_TO_ID_MAP)
+                        .unwrap_or(pentax!(UNKNOWN)),
+                )
             })
+            .copied()
+    }
+
+    fn container(&self) -> Result<&dyn RawContainer> {
+        self.container
+            .get_or_try_init(|| {
+                let view = Viewer::create_view(&self.reader, 0).context("Error creating view")?;
+                let mut container = tiff::Container::new(
+                    view,
+                    vec![
+                        (tiff::IfdType::Main, None),
+                        (tiff::IfdType::Other, None),
+                        (tiff::IfdType::Other, None),
+                    ],
+                    self.type_(),
+                );
+                container.load(None).context("PEF container error")?;
+                probe!(
+                    self.probe,
+                    "raw.container.endian",
+                    &format!("{:?}", container.endian())
+                );
+                Ok(Box::new(container))
+            })
+            .map(|b| b.as_ref() as &dyn RawContainer)
+    }
+
+    fn thumbnails(&self) -> Result<&ThumbnailStorage> {
+        self.thumbnails.get_or_try_init(|| {
+            self.container()?;
+            let container = self.container.get().unwrap();
+            let mut thumbnails = tiff::tiff_thumbnails(container);
+
+            self.ifd(tiff::IfdType::MakerNote).and_then(|mnote| {
+                // The MakerNote has a MNOTE_PENTAX_PREVIEW_IMAGE_SIZE
+                // That contain w in [0] and h in [1]
+                let start =
+                    mnote.uint_value(exif::MNOTE_PENTAX_PREVIEW_IMAGE_START)? + mnote.mnote_offset;
+                let len = mnote.uint_value(exif::MNOTE_PENTAX_PREVIEW_IMAGE_LENGTH)?;
+                container
+                    .add_thumbnail_from_stream(start, len, &mut thumbnails)
+                    .ok()
+            });
+
+            Ok(ThumbnailStorage::with_thumbnails(thumbnails))
+        })
+    }
+
+    fn ifd(&self, ifd_type: tiff::IfdType) -> Option<&Dir> {
+        self.container().ok()?;
+        let container = self.container.get().unwrap();
+        match ifd_type {
+            tiff::IfdType::Main | tiff::IfdType::Raw => container.directory(0),
+            tiff::IfdType::Exif => container.exif_dir(),
+            tiff::IfdType::MakerNote => container.mnote_dir(),
+            _ => None,
+        }
+    }
+
+    fn load_rawdata(&self, _skip_decompress: bool) -> Result<RawImage> {
+        self.load_rawdata_with(None)
+    }
+
+    fn load_rawdata_rows(&self, rows: &mut RowSink) -> Result<RawImage> {
+        self.load_rawdata_with(Some(rows))
     }
 
     fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
+        self.builtin_colour_matrix(&MATRICES)
     }
 }
 
@@ -30,7 +30,8 @@
 use std::io::BufRead;
 
 use crate::container::Endian;
-use crate::Result;
+use crate::rows::RowSink;
+use crate::{Error, Result};
 
 const DECODE_CACHE_BITS: u32 = 13;
 
@@ -41,86 +42,129 @@ pub(super) fn decompress(
     height: usize,
 ) -> Result<Vec<u16>> {
     let mut out = vec![0_u16; width * height];
-    let mut htable = HuffTable::default();
+    let mut decompressor = Decompressor::new(src, huff)?;
+    for row in 0..height {
+        decompressor.decode_row(row, &mut out[row * width..(row + 1) * width])?;
+    }
+    Ok(out)
+}
+
+/// Decompress into `rows`, a band at a time.
+pub(super) fn decompress_rows(
+    src: &[u8],
+    huff: Option<(&[u8], Endian)>,
+    width: usize,
+    height: usize,
+    rows: &mut RowSink,
+) -> Result<()> {
+    let mut decompressor = Decompressor::new(src, huff)?;
+    rows.start(width);
+    for row in 0..height {
+        decompressor.decode_row(row, &mut rows.rows_mut()[..width])?;
+        rows.advance(1)?;
+    }
+    Ok(())
+}
 
-    /* Attempt to read huffman table, if found in MakerNote */
-    if let Some((huff, endian)) = huff {
-        let mut cursor = std::io::Cursor::new(huff);
-        let depth: usize = (endian.read_u16_from(&mut cursor)? as usize + 12) & 0xf;
-        // XXX depth > 16 will cause issues.
+/// The decompressor state, to decode row by row.
+struct Decompressor<'a> {
+    htable: HuffTable,
+    pump: BitPumpMSB<'a>,
+    pred_up1: [i32; 2],
+    pred_up2: [i32; 2],
+}
 
-        cursor.consume(12);
+impl<'a> Decompressor<'a> {
+    fn new(src: &'a [u8], huff: Option<(&[u8], Endian)>) -> Result<Decompressor<'a>> {
+        let mut htable = HuffTable::default();
 
-        let mut v0 = [0_u32; 16];
-        for value in v0.iter_mut().take(depth) {
-            *value = endian.read_u16_from(&mut cursor)? as u32;
-        }
+        /* Attempt to read huffman table, if found in MakerNote */
+        if let Some((huff, endian)) = huff {
+            let mut cursor = std::io::Cursor::new(huff);
+            let depth: usize = (endian.read_u16_from(&mut cursor)? as usize + 12) & 0xf;
+            // XXX depth > 16 will cause issues.
 
-        let mut v1 = [0_u32; 16];
-        let pos = cursor.position() as usize;
-        for (i, value) in huff[pos..].iter().enumerate().take(depth) {
-            v1[i] = *value as u32;
-        }
+            cursor.consume(12);
 
-        // Calculate codes and store bitcounts
-        let mut v2: [u32; 16] = [0; 16];
-        for c in 0..depth {
-            v2[c] = v0[c] >> (12 - v1[c]);
-            htable.bits[v1[c] as usize] += 1;
-        }
+            let mut v0 = [0_u32; 16];
+            for value in v0.iter_mut().take(depth) {
+                *value = endian.read_u16_from(&mut cursor)? as u32;
+            }
+
+            let mut v1 = [0_u32; 16];
+            let pos = cursor.position() as usize;
+            for (i, value) in huff[pos..].iter().enumerate().take(depth) {
+                v1[i] = *value as u32;
+            }
+
+            // Calculate codes and store bitcounts
+            let mut v2: [u32; 16] = [0; 16];
+            for c in 0..depth {
+                v2[c] = v0[c] >> (12 - v1[c]);
+                htable.bits[v1[c] as usize] += 1;
+            }
 
-        // Find smallest
-        for i in 0..depth {
-            let mut sm_val: u32 = 0xfffffff;
-            let mut sm_num: u32 = 0xff;
-            for (j, value) in v2.iter().enumerate().take(depth) {
-                if *value <= sm_val {
-                    sm_num = j as u32;
-                    sm_val = *value;
+            // Find smallest
+            for i in 0..depth {
+                let mut sm_val: u32 = 0xfffffff;
+                let mut sm_num: u32 = 0xff;
+                for (j, value) in v2.iter().enumerate().take(depth) {
+                    if *value <= sm_val {
+                        sm_num = j as u32;
+                        sm_val = *value;
+                    }
                 }
+                htable.huffval[i] = sm_num;
+                v2[sm_num as usize] = 0xffffffff;
+            }
+        } else {
+            // Initialize with legacy data
+            let pentax_tree: [u8; 29] = [
+                0, 2, 3, 1, 1, 1, 1, 1, 1, 2, 0, 0, 0, 0, 0, 0, 3, 4, 2, 5, 1, 6, 0, 7, 8, 9, 10,
+                11, 12,
+            ];
+            let mut acc: usize = 0;
+            for (i, value) in pentax_tree.iter().enumerate().take(16) {
+                htable.bits[i + 1] = *value as u32;
+                acc += htable.bits[i + 1] as usize;
+            }
+            for i in 0..acc {
+                htable.huffval[i] = pentax_tree[i + 16] as u32;
             }
-            htable.huffval[i] = sm_num;
-            v2[sm_num as usize] = 0xffffffff;
-        }
-    } else {
-        // Initialize with legacy data
-        let pentax_tree: [u8; 29] = [
-            0, 2, 3, 1, 1, 1, 1, 1, 1, 2, 0, 0, 0, 0, 0, 0, 3, 4, 2, 5, 1, 6, 0, 7, 8, 9, 10, 11,
-            12,
-        ];
-        let mut acc: usize = 0;
-        for (i, value) in pentax_tree.iter().enumerate().take(16) {
-            htable.bits[i + 1] = *value as u32;
-            acc += htable.bits[i + 1] as usize;
-        }
-        for i in 0..acc {
-            htable.huffval[i] = pentax_tree[i + 16] as u32;
         }
-    }
 
-    htable.initialize()?;
+        htable.initialize()?;
 
-    let mut pump = BitPumpMSB::new(src);
-    let mut pred_up1: [i32; 2] = [0, 0];
-    let mut pred_up2: [i32; 2] = [0, 0];
-    let mut pred_left1: i32;
-    let mut pred_left2: i32;
+        Ok(Decompressor {
+            htable,
+            pump: BitPumpMSB::new(src),
+            pred_up1: [0, 0],
+            pred_up2: [0, 0],
+        })
+    }
 
-    for row in 0..height {
-        pred_up1[row & 1] += htable.huff_decode(&mut pump)?;
-        pred_up2[row & 1] += htable.huff_decode(&mut pump)?;
-        pred_left1 = pred_up1[row & 1];
-        pred_left2 = pred_up2[row & 1];
-        out[row * width] = pred_left1 as u16;
-        out[row * width + 1] = pred_left2 as u16;
-        for col in (2..width).step_by(2) {
-            pred_left1 += htable.huff_decode(&mut pump)?;
-            pred_left2 += htable.huff_decode(&mut pump)?;
-            out[row * width + col] = pred_left1 as u16;
-            out[row * width + col + 1] = pred_left2 as u16;
+    /// Decode the `row` into `out`. The rows must be decoded in order.
+    fn decode_row(&mut self, row: usize, out: &mut [u16]) -> Result<()> {
+        if out.len() < 2 {
+            log::error!("Pentax: row too short {}", out.len());
+            return Err(Error::FormatError);
+        }
+        let htable = &self.htable;
+        let pump = &mut self.pump;
+        self.pred_up1[row & 1] += htable.huff_decode(pump)?;
+        self.pred_up2[row & 1] += htable.huff_decode(pump)?;
+        let mut pred_left1 = self.pred_up1[row & 1];
+        let mut pred_left2 = self.pred_up2[row & 1];
+        out[0] = pred_left1 as u16;
+        out[1] = pred_left2 as u16;
+        for pair in out[2..].chunks_exact_mut(2) {
+            pred_left1 += htable.huff_decode(pump)?;
+            pred_left2 += htable.huff_decode(pump)?;
+            pair[0] = pred_left1 as u16;
+            pair[1] = pred_left2 as u16;
         }
+        Ok(())
     }
-    Ok(out)
 }
 
 pub(super) struct HuffTable {
@@ -27,14 +27,17 @@ use std::rc::Rc;
 use log::{debug, error};
 use num_enum::TryFromPrimitive;
 
-use super::{Error, RawImage, Result, Type, TypeId};
-use crate::colour::{BuiltinMatrix, MatrixOrigin};
+use super::{Error, RawImage, Rect, Result, Type, TypeId};
+use crate::bitmap::Bitmap;
+use crate::colour::{self, BuiltinMatrix, MatrixOrigin};
 use crate::container::RawContainer;
 use crate::factory;
 use crate::identify;
 use crate::io;
 use crate::metadata;
-use crate::render::RenderingOptions;
+use crate::rawimage::region_halo;
+use crate::render::{RenderingCrop, RenderingOptions};
+use crate::rows::{RowBand, RowSink};
 use crate::thumbnail::{ThumbDesc, Thumbnail};
 use crate::tiff;
 use crate::tiff::{exif, Ifd};
@@ -97,13 +100,27 @@ pub trait RawFileImpl {
     /// If `skip_decompress` is true then the decompression will not be performed.
     fn load_rawdata(&self, skip_decompress: bool) -> Result<RawImage>;
 
+    /// Load the decompressed [`RawImage`], with at least `region`
+    /// decoded. `region` is relative to `crop`. Formats with
+    /// independently decodable tiles or strips only decode those
+    /// intersecting `region`, the rest of the data being left black.
+    fn load_rawdata_region(&self, _region: &Rect, _crop: RenderingCrop) -> Result<RawImage> {
+        self.load_rawdata(false)
+    }
+
+    /// Load the decompressed [`RawImage`] into `rows`, a band at a
+    /// time, if the format decodes sequentially. Otherwise the data is
+    /// decoded whole in the returned [`RawImage`], for `rows` to
+    /// output it.
+    fn load_rawdata_rows(&self, _rows: &mut RowSink) -> Result<RawImage> {
+        self.load_rawdata(false)
+    }
+
     /// Default implementation for looking up the builtin matrix.
     fn builtin_colour_matrix(&self, matrices: &[BuiltinMatrix]) -> Result<Vec<f64>> {
         let type_id = self.identify_id()?;
-        matrices
-            .iter()
-            .find(|m| m.camera == type_id)
-            .map(|m| Vec::from(m.matrix))
+        colour::find_builtin_matrix(matrices, type_id)
+            .map(|m| m.coefficients())
             .ok_or(Error::NotFound)
     }
 
@@ -262,24 +279,100 @@ pub trait RawFile: RawFileImpl + crate::dump::DumpFile + std::fmt::Debug {
         self.thumbnail_for_size(found_size)
     }
 
+    /// Set the colour matrices of the file on `rawdata`.
+    fn with_colour_matrices(&self, mut rawdata: RawImage) -> RawImage {
+        for i in 1..=2_usize {
+            if let Ok((_, matrix)) = self.colour_matrix(i) {
+                log::debug!("Setting colour matrix {i}");
+                rawdata.set_colour_matrix(i, self.calibration_illuminant(i), &matrix);
+            }
+        }
+
+        rawdata
+    }
+
     /// Get the RAW data
     fn raw_data(&self, skip_decompression: bool) -> Result<RawImage> {
-        self.load_rawdata(skip_decompression).map(|mut rawdata| {
-            for i in 1..=2_usize {
-                if let Ok((_, matrix)) = self.colour_matrix(i) {
-                    log::debug!("Setting colour matrix {i}");
-                    rawdata.set_colour_matrix(i, self.calibration_illuminant(i), &matrix);
-                }
-            }
+        self.load_rawdata(skip_decompression)
+            .map(|rawdata| self.with_colour_matrices(rawdata))
+    }
 
-            rawdata
+    /// Get the RAW data for `region` only. Only the tiles or strips
+    /// intersecting `region` are decoded when the format allows it.
+    fn raw_data_region(&self, region: &Rect) -> Result<RawImage> {
+        let rawdata =
+            self.with_colour_matrices(self.load_rawdata_region(region, RenderingCrop::None)?);
+        // Clip to the image.
+        let x1 = std::cmp::min(region.x.saturating_add(region.width), rawdata.width());
+        let y1 = std::cmp::min(region.y.saturating_add(region.height), rawdata.height());
+        rawdata.cropped(&Rect {
+            x: region.x,
+            y: region.y,
+            width: x1.saturating_sub(region.x),
+            height: y1.saturating_sub(region.y),
         })
     }
 
-    /// Render the image.
+    /// Get the RAW data into `dest`, with rows `stride` samples apart,
+    /// or packed if `stride` is 0. The returned `RawImage` has the
+    /// metadata only. See `RawImage::move_data16_into()`.
+    ///
+    /// `Error::BufferTooSmall` if `dest` is too small.
+    fn raw_data_into(&self, dest: &mut [u16], stride: usize) -> Result<RawImage> {
+        self.raw_data(false)?.move_data16_into(dest, stride)
+    }
+
+    /// Decode the RAW data in bands of `band_rows` rows, passed to
+    /// `callback` in order. The band buffer is reused, so that the
+    /// formats that decode sequentially never hold the whole data.
+    /// An error returned by `callback` stops the decoding. The
+    /// returned `RawImage` has the metadata only.
+    fn decode_rows(
+        &self,
+        band_rows: u32,
+        callback: &mut dyn FnMut(&RowBand) -> Result<()>,
+    ) -> Result<RawImage> {
+        let mut rows = RowSink::new(band_rows as usize, callback);
+        let rawdata = self.load_rawdata_rows(&mut rows)?;
+        rows.finish(rawdata)
+            .map(|rawdata| self.with_colour_matrices(rawdata))
+    }
+
+    /// Render the image. If `options` has a region, and no crop, only
+    /// the raw data needed for it is decoded when the format allows it.
+    /// The raw data is rendered in place when possible.
     fn rendered_image(&self, options: RenderingOptions) -> Result<RawImage> {
-        let raw_data = self.raw_data(false)?;
-        raw_data.rendered_image(options)
+        self.raw_data_for_rendering(&options)?
+            .into_rendered_image(options)
+    }
+
+    /// Render the image into `dest`, with rows `stride` bytes apart.
+    /// Return the dimensions. See `RawImage::rendered_image_into()`.
+    fn rendered_image_into(
+        &self,
+        options: RenderingOptions,
+        dest: &mut [u8],
+        stride: usize,
+    ) -> Result<(u32, u32)> {
+        self.raw_data_for_rendering(&options)?
+            .rendered_image_into(options, dest, stride)
+    }
+
+    /// Get the raw data needed to render with `options`.
+    fn raw_data_for_rendering(&self, options: &RenderingOptions) -> Result<RawImage> {
+        if let Some(region) = &options.region {
+            // The rendering needs a few pixels around.
+            let (halo, _) = region_halo(options);
+            let region = Rect {
+                x: region.x.saturating_sub(halo),
+                y: region.y.saturating_sub(halo),
+                width: region.width.saturating_add(2 * halo),
+                height: region.height.saturating_add(2 * halo),
+            };
+            Ok(self.with_colour_matrices(self.load_rawdata_region(&region, options.crop)?))
+        } else {
+            self.raw_data(false)
+        }
     }
 
     /// Get the main IFD
@@ -21,18 +21,27 @@
 
 //! RAW data
 
-use nalgebra::{matrix, Matrix3, Vector3};
+use nalgebra::{Matrix3, Vector3};
+use rayon::prelude::*;
 
+use crate::binning::{self, Binning};
 use crate::bitmap::{Data, ImageBuffer};
 use crate::colour::ColourMatrix;
-use crate::mosaic::Pattern;
-use crate::render::{self, gamma_correct_f, gamma_correct_srgb, RenderingOptions, RenderingStage};
+use crate::mosaic::{Pattern, PatternType};
+use crate::render::{
+    self, pipeline, DemosaicMethod, Linearizer, OutputLayout, OutputSample, RenderingCrop,
+    RenderingOptions, RenderingPrecision, RenderingScale, RenderingStage, Sample,
+};
+use crate::statistics::{self, Statistics};
 use crate::tiff::exif;
 use crate::utils;
 use crate::{tiff, ColourSpace};
 use crate::{AspectRatio, Bitmap, DataType, Error, Rect, Result, Size};
 
-#[derive(Default, Debug)]
+/// The number of pixels colour corrected per parallel task.
+const COLOUR_CHUNK: usize = 16 * 1024;
+
+#[derive(Clone, Default, Debug)]
 enum AsShot {
     #[default]
     None,
@@ -176,8 +185,8 @@ impl RawImage {
         }
     }
 
-    pub(crate) fn with_image_buffer(
-        buffer: ImageBuffer<u16>,
+    pub(crate) fn with_image_buffer<O: OutputSample>(
+        buffer: ImageBuffer<O>,
         data_type: DataType,
         mosaic_pattern: Pattern,
     ) -> Self {
@@ -186,7 +195,7 @@ impl RawImage {
             height: buffer.height,
             bpc: buffer.bpc,
             data_type,
-            data: Data::Data16(buffer.data),
+            data: O::into_data(buffer.data),
             active_area: None,
             user_crop: None,
             user_aspect_ratio: None,
@@ -305,7 +314,7 @@ impl RawImage {
         self.width = width;
     }
 
-    /// Black values
+    /// Black values, for each position of the 2x2 CFA in row order.
     pub fn blacks(&self) -> &[u16; 4] {
         &self.blacks
     }
@@ -314,6 +323,7 @@ impl RawImage {
         self.blacks = b;
     }
 
+    /// White values, for each position of the 2x2 CFA in row order.
     pub fn whites(&self) -> &[u16; 4] {
         &self.whites
     }
@@ -399,12 +409,290 @@ impl RawImage {
         }
     }
 
+    /// Drop the tiles that don't intersect `region`, so that they
+    /// aren't decompressed. Their data is left empty.
+    pub(crate) fn retain_tiles(&mut self, region: &Rect) {
+        let width = self.width;
+        if let Data::Tiled((ref mut tiles, (tile_width, tile_height))) = self.data {
+            if tile_width == 0 || tile_height == 0 {
+                return;
+            }
+            let tiles_across = (width + tile_width - 1) / tile_width;
+            tiles.iter_mut().enumerate().for_each(|(idx, tile)| {
+                let x = (idx as u32 % tiles_across) * tile_width;
+                let y = (idx as u32 / tiles_across) * tile_height;
+                if x >= region.x + region.width
+                    || x + tile_width <= region.x
+                    || y >= region.y + region.height
+                    || y + tile_height <= region.y
+                {
+                    *tile = vec![];
+                }
+            });
+        }
+    }
+
     pub fn replace_data(mut self, data: Vec<u16>) -> RawImage {
         self.data = Data::Data16(data);
 
         self
     }
 
+    /// Move the 16-bit samples into `dest`, with rows `stride` samples
+    /// apart, or packed if `stride` is 0. Return the image without its
+    /// samples, for the metadata.
+    ///
+    /// `Error::BufferTooSmall` if `dest` is too small.
+    pub fn move_data16_into(self, dest: &mut [u16], stride: usize) -> Result<RawImage> {
+        let data = self.data16().ok_or(Error::InvalidFormat)?;
+        let src_layout = OutputLayout::cfa(self.row_len(), self.height as usize);
+        let layout = src_layout.with_stride(stride)?;
+        if dest.len() < layout.len() {
+            log::error!("Buffer of {} too small for {layout:?}", dest.len());
+            return Err(Error::BufferTooSmall);
+        }
+        layout.copy_rect(dest, &src_layout, data, 0, 0)?;
+
+        Ok(self.replace_data(vec![]))
+    }
+
+    /// The size, in samples, of the buffer to move the 16-bit samples
+    /// into with rows `stride` samples apart. See `move_data16_into()`.
+    /// Doesn't need the data to be decompressed.
+    pub fn data16_buffer_size(&self, stride: usize) -> Result<usize> {
+        Ok(OutputLayout::cfa(self.row_len(), self.height as usize)
+            .with_stride(stride)?
+            .len())
+    }
+
+    /// The number of 16-bit samples in a row. Interleaved components
+    /// are just more samples per row.
+    fn row_len(&self) -> usize {
+        match self.data16() {
+            Some(data) if self.height != 0 => data.len() / self.height as usize,
+            _ if self.photom_int == exif::PhotometricInterpretation::LinearRaw => {
+                self.width as usize * 3
+            }
+            _ => self.width as usize,
+        }
+    }
+
+    /// Crop the data to `rect`. The mosaic pattern is shifted
+    /// accordingly, the active area and user crop are dropped.
+    pub(crate) fn cropped(&self, rect: &Rect) -> Result<RawImage> {
+        let width = self.width as usize;
+        let height = self.height as usize;
+        if rect.width == 0
+            || rect.height == 0
+            || rect.x + rect.width > self.width
+            || rect.y + rect.height > self.height
+        {
+            log::error!("Can't crop {rect:?} out of {}x{}", self.width, self.height);
+            return Err(Error::InvalidParam);
+        }
+        let planes = match self.data_type {
+            DataType::PixmapPlanarF32 => 3,
+            DataType::RawPlanes => 4,
+            _ => 1,
+        };
+        let data = match self.data {
+            Data::Data8(ref d) => crop_samples(d, width, height, planes, rect).map(Data::Data8),
+            Data::Data16(ref d) => crop_samples(d, width, height, planes, rect).map(Data::Data16),
+            Data::DataF32(ref d) => crop_samples(d, width, height, planes, rect).map(Data::DataF32),
+            Data::Tiled(_) => None,
+        }
+        .ok_or_else(|| {
+            log::error!("Can't crop {rect:?} out of {:?}", self.data);
+            Error::InvalidFormat
+        })?;
+
+        Ok(RawImage {
+            width: rect.width,
+            height: rect.height,
+            data_type: self.data_type,
+            data,
+            bpc: self.bpc,
+            whites: shifted_levels(&self.whites, rect.x, rect.y),
+            blacks: shifted_levels(&self.blacks, rect.x, rect.y),
+            photom_int: self.photom_int,
+            compression: self.compression,
+            active_area: None,
+            user_crop: None,
+            user_aspect_ratio: None,
+            output_size: None,
+            mosaic_pattern: self
+                .mosaic_pattern
+                .shifted(rect.x as usize, rect.y as usize),
+            as_shot: self.as_shot.clone(),
+            matrices: self.matrices.clone(),
+            linearization_table: self.linearization_table.clone(),
+        })
+    }
+
+    /// Downsample the bayer CFA data by half with `binning`, the black
+    /// subtracted. See `[Binning]`. The blacks of the result are 0.
+    ///
+    /// With `Binning::Planes` the layout is like `planar()`.
+    pub fn binned(&self, binning: Binning) -> Result<RawImage> {
+        let data16 = self.bayer_data16()?;
+        let offsets = binning::plane_offsets(&self.mosaic_pattern)?;
+        let width = self.width as usize;
+        let height = self.height as usize;
+        let levels = binning::Levels {
+            blacks: self.blacks,
+            table: self.linearization_table.as_deref(),
+        };
+        let whites = std::array::from_fn(|i| self.whites[i].saturating_sub(self.blacks[i]));
+        let mut image = match binning {
+            Binning::Cfa => {
+                let (data, w, h) = binning::bin_cfa(data16, width, height, &levels);
+                self.downsampled(data, w, h, None, whites, [0; 4])
+            }
+            Binning::Planes => {
+                let (data, w, h) = binning::bin_planes(data16, width, height, &offsets, &levels);
+                self.downsampled(data, w, h, Some(&offsets), whites, [0; 4])
+            }
+        }?;
+        image.linearization_table = None;
+
+        Ok(image)
+    }
+
+    /// Reorder the bayer CFA data in 4 planes R, G1, G2 and B, half the
+    /// size, for per channel processing. G1 is the green on the red
+    /// rows. The data type is `DataType::RawPlanes`, the planes one
+    /// after the other, and the levels are in the plane order. The
+    /// values are kept. An odd last row or column is dropped.
+    pub fn planar(&self) -> Result<RawImage> {
+        let data16 = self.bayer_data16()?;
+        let offsets = binning::plane_offsets(&self.mosaic_pattern)?;
+        let levels = binning::Levels {
+            blacks: [0; 4],
+            table: None,
+        };
+        let (data, w, h) = binning::bin_planes(
+            data16,
+            self.width as usize,
+            self.height as usize,
+            &offsets,
+            &levels,
+        );
+
+        self.downsampled(data, w, h, Some(&offsets), self.whites, self.blacks)
+    }
+
+    /// The plane `index` of `DataType::RawPlanes` data, in the order R,
+    /// G1, G2 and B. See `planar()`.
+    pub fn plane(&self, index: usize) -> Option<&[u16]> {
+        if self.data_type != DataType::RawPlanes || index >= 4 {
+            return None;
+        }
+        let len = self.width as usize * self.height as usize;
+        self.data16()?.chunks_exact(len).nth(index)
+    }
+
+    /// The 16 bits data of the uncompressed bayer CFA.
+    fn bayer_data16(&self) -> Result<&[u16]> {
+        if self.data_type != DataType::Raw {
+            log::error!("Expected raw data, got {:?}", self.data_type);
+            return Err(Error::InvalidFormat);
+        }
+        self.data16().ok_or(Error::InvalidFormat)
+    }
+
+    /// The image with the `data` downsampled to `width` x `height`.
+    /// With `planes`, the offsets from `binning::plane_offsets()`, it
+    /// is planar and the `whites` and `blacks`, per CFA position, are
+    /// reordered for the planes.
+    fn downsampled(
+        &self,
+        data: Vec<u16>,
+        width: usize,
+        height: usize,
+        planes: Option<&[(usize, usize); 4]>,
+        whites: [u16; 4],
+        blacks: [u16; 4],
+    ) -> Result<RawImage> {
+        if data.is_empty() {
+            log::error!(
+                "Image {}x{} too small to downsample",
+                self.width,
+                self.height
+            );
+            return Err(Error::InvalidParam);
+        }
+        let (data_type, mosaic_pattern, whites, blacks) = match planes {
+            Some(offsets) => (
+                DataType::RawPlanes,
+                Pattern::Empty,
+                offsets.map(|(x, y)| whites[y * 2 + x]),
+                offsets.map(|(x, y)| blacks[y * 2 + x]),
+            ),
+            None => (DataType::Raw, self.mosaic_pattern.clone(), whites, blacks),
+        };
+
+        Ok(RawImage {
+            width: width as u32,
+            height: height as u32,
+            data_type,
+            data: Data::Data16(data),
+            bpc: self.bpc,
+            whites,
+            blacks,
+            photom_int: self.photom_int,
+            compression: self.compression,
+            active_area: None,
+            user_crop: None,
+            user_aspect_ratio: None,
+            output_size: None,
+            mosaic_pattern,
+            as_shot: self.as_shot.clone(),
+            matrices: self.matrices.clone(),
+            linearization_table: self.linearization_table.clone(),
+        })
+    }
+
+    /// Compute the statistics of the raw data, per CFA channel, in a
+    /// single parallel pass. See `[Statistics]`.
+    pub fn statistics(&self) -> Result<Statistics> {
+        let data16 = self.data16().ok_or(Error::InvalidFormat)?;
+        let height = self.height as usize;
+        let channels = match self.data_type {
+            DataType::Raw => statistics::channel_statistics(
+                data16,
+                self.row_len(),
+                height,
+                &self.mosaic_pattern,
+                &self.blacks,
+                &self.whites,
+                self.bpc,
+            ),
+            DataType::RawPlanes => {
+                let width = self.width as usize;
+                let mut channels = vec![];
+                let levels = self.blacks.iter().zip(self.whites.iter());
+                for (plane, (black, white)) in data16.chunks(width * height).zip(levels) {
+                    channels.append(&mut statistics::channel_statistics(
+                        plane,
+                        width,
+                        height,
+                        &Pattern::Empty,
+                        &[*black; 4],
+                        &[*white; 4],
+                        self.bpc,
+                    )?);
+                }
+                Ok(channels)
+            }
+            _ => {
+                log::error!("No statistics for {:?}", self.data_type);
+                Err(Error::InvalidFormat)
+            }
+        }?;
+
+        Ok(Statistics::from_channels(channels))
+    }
+
     /// Set the mosaic pattern.
     pub fn set_mosaic_pattern(&mut self, pattern: Pattern) {
         self.mosaic_pattern = pattern;
@@ -420,50 +708,50 @@ impl RawImage {
     /// Linearization will:
     /// - lookup the linearization table to directly map indexed values:
     ///   this is notable on Leica M8 files.
-    /// - scale by range / white
+    /// - subtract the black and scale by the range, for each position
+    ///   of the CFA.
     ///
-    fn linearize(&self, buffer: ImageBuffer<u16>) -> ImageBuffer<f64> {
+    fn linearize<T: Sample>(&self, data: &[u16]) -> ImageBuffer<T> {
         log::debug!("linearize");
-        // XXX fix this to use the 4 component
-        let white = self.whites()[0];
-        let black = self.blacks()[0];
-        let range = (white - black) as f64;
-        let table = if self
-            .linearization_table
-            .as_ref()
-            .map(|t| t.len() == (1 << self.bpc()))
-            .unwrap_or(false)
-        {
-            self.linearization_table.as_ref()
-        } else {
-            None
-        };
-        log::debug!("pre-lin at 1000, 1000: {:?}", buffer.pixel_at(1000, 1000));
-        let data = buffer
-            .data
-            .iter()
-            .map(|v| {
-                table.map(|t| t[*v as usize] as f64).unwrap_or_else(|| {
-                    if *v < black {
-                        0.0
-                    } else {
-                        (*v - black) as f64
-                    }
-                }) / range
-            })
-            .collect();
+        let linearizer = self.linearizer::<T>();
+        let width = std::cmp::max(1, self.width() as usize);
+        let mut linear: Vec<T> = uninit_vec!(data.len());
+        linear
+            .par_chunks_mut(width)
+            .zip(data.par_chunks(width))
+            .enumerate()
+            .for_each(|(y, (dest, src))| linearizer.apply_row(src, y, dest));
 
-        let buffer =
-            ImageBuffer::<f64>::with_data(data, buffer.width, buffer.height, buffer.bpc, 1);
+        let buffer = ImageBuffer::<T>::with_data(linear, self.width(), self.height(), 16, 1);
         log::debug!("post-lin at 1000, 1000: {:?}", buffer.pixel_at(1000, 1000));
         buffer
     }
 
+    /// The `Linearizer` for the raw data. The levels are per CFA
+    /// position, other data use the first one.
+    fn linearizer<T: Sample>(&self) -> Linearizer<T> {
+        let (blacks, whites) = if self.photom_int == exif::PhotometricInterpretation::CFA {
+            (self.blacks, self.whites)
+        } else {
+            ([self.blacks[0]; 4], [self.whites[0]; 4])
+        };
+        Linearizer::new(blacks, whites, self.linearization_table.as_deref())
+    }
+
     /// Interplate the image buffer. Return a new buffer if successful.
-    fn interpolate(&self, buffer: ImageBuffer<f64>) -> Result<ImageBuffer<f64>> {
+    fn interpolate<T: Sample>(
+        &self,
+        buffer: ImageBuffer<T>,
+        method: DemosaicMethod,
+    ) -> Result<ImageBuffer<T>> {
         let pattern = self.mosaic_pattern();
         match self.photom_int {
-            exif::PhotometricInterpretation::CFA => render::demosaic::bimedian(&buffer, pattern),
+            exif::PhotometricInterpretation::CFA => match (pattern.pattern_type(), method) {
+                // The demosaic methods are for 2x2 bayer only.
+                (PatternType::NonRgb22, _) => render::demosaic::xtrans(&buffer, pattern),
+                (_, DemosaicMethod::Bimedian) => render::demosaic::bimedian(&buffer, pattern),
+                (_, DemosaicMethod::Ppg) => render::demosaic::ppg(&buffer, pattern),
+            },
             exif::PhotometricInterpretation::LinearRaw => render::grayscale::to_rgb(&buffer),
             _ => {
                 log::error!("Invalid photometric interpretation {:?}", self.photom_int);
@@ -476,28 +764,51 @@ impl RawImage {
     ///
     /// Currently analog balance and camera calibration are identity matrices
     pub fn calculate_cam_rgb(cm: &Matrix3<f64>) -> Matrix3<f64> {
+        Self::calculate_cam_target(cm, ColourSpace::SRgb).unwrap()
+    }
+
+    /// Calculate the camera to `target` colour matrix using `cm`.
+    /// Return `None` if `target` isn't an XYZ or RGB colour space.
+    ///
+    /// Currently analog balance and camera calibration are identity matrices
+    pub fn calculate_cam_target(cm: &Matrix3<f64>, target: ColourSpace) -> Option<Matrix3<f64>> {
+        let xyz_target = target.matrix_from_xyz()?;
         // Camera calibration
         let cc = Matrix3::<f64>::identity();
         // Analog  balance
         let ab = Matrix3::<f64>::identity();
         let xyz_camera = ab * cc * cm;
         let cam_xyz = xyz_camera.try_inverse().unwrap();
-        // XYZ to RGB <https://en.wikipedia.org/wiki/SRGB#From_CIE_XYZ_to_sRGB>
-        let xyz_rgb =
-            matrix![ 3.2406, -1.5372, -0.4986; -0.9689, 1.8758, 0.0415; 0.0557, -0.2040, 1.0570];
-        xyz_rgb * cam_xyz
+        Some(xyz_target * cam_xyz)
     }
 
-    pub(crate) fn colour_correct(
-        &self,
-        mut buffer: ImageBuffer<f64>,
-        target: ColourSpace,
-    ) -> Result<ImageBuffer<f64>> {
-        if target != ColourSpace::SRgb {
-            return Err(Error::Unimplemented);
+    /// The as shot white in camera space, normalized for green.
+    /// `xyz_cam` is the XYZ to camera colour matrix.
+    fn as_shot_white(&self, xyz_cam: &Matrix3<f64>) -> Option<Vector3<f64>> {
+        let white = match self.as_shot {
+            AsShot::Neutral(neutral) => Vector3::new(neutral[0], neutral[1], neutral[2]),
+            AsShot::WhiteXy(x, y) if y > 0.0 => {
+                xyz_cam * Vector3::new(x / y, 1.0, (1.0 - x - y) / y)
+            }
+            _ => return None,
+        };
+        if white.iter().any(|v| !v.is_finite() || *v <= 0.0) {
+            log::warn!("Invalid as shot white {white:?}");
+            return None;
+        }
+        Some(white / white[1])
+    }
+
+    /// The camera to `target` colour matrix, if the image has a
+    /// colour matrix for D65 and the target isn't the camera colour
+    /// space. The as shot white balance is folded in, so that the
+    /// whole colour correction is one matrix per pixel.
+    fn camera_to_target<T: Sample>(&self, target: ColourSpace) -> Result<Option<[[T; 3]; 3]>> {
+        match target {
+            ColourSpace::Camera => return Ok(None),
+            ColourSpace::Unknown => return Err(Error::Unimplemented),
+            _ => {}
         }
-        let width = buffer.width;
-        let height = buffer.height;
         // XXX get the D65 illuminant matrix. On DNG it is not necessarily 1.
         let mut cm = None;
         for i in 1..=2 {
@@ -510,24 +821,42 @@ impl RawImage {
             }
         }
         if let Some(cm) = cm {
-            log::debug!("Calculating cam RGB");
-            let cam_rgb = Self::calculate_cam_rgb(&cm);
-            log::debug!("pixel cam at 1000, 1000: {:?}", buffer.pixel_at(1000, 1000));
-            log::debug!("Applying colour matrix");
-            for row in 0..height {
-                let pos = row * width * 3;
-                let mut col = 0;
-                while col < width * 3 {
-                    let c = (pos + col) as usize;
-                    let abc = Vector3::from_row_iterator(buffer.data[c..c + 3].iter().copied());
-                    let rgb = cam_rgb * abc;
-                    col += 3;
-                    buffer.data[c..c + 3].copy_from_slice((&rgb).into());
+            log::debug!("Calculating cam {target:?}");
+            let mut cam_target =
+                Self::calculate_cam_target(&cm, target).ok_or(Error::Unimplemented)?;
+            if let Some(white) = self.as_shot_white(&cm) {
+                // Scale the camera channels so that the as shot white
+                // becomes the camera D65 white, the one sRGB renders
+                // white.
+                let cam_white = Self::calculate_cam_rgb(&cm)
+                    .try_inverse()
+                    .map(|rgb_cam| rgb_cam * Vector3::repeat(1.0));
+                if let Some(cam_white) = cam_white {
+                    cam_target *= Matrix3::from_diagonal(&cam_white.component_div(&white));
                 }
             }
-            log::debug!("pixel rgb at 1000, 1000: {:?}", buffer.pixel_at(1000, 1000));
+            Ok(Some(std::array::from_fn(|r| {
+                std::array::from_fn(|c| T::from_f64(cam_target[(r, c)]))
+            })))
         } else {
             log::error!("no matrix");
+            Ok(None)
+        }
+    }
+
+    pub(crate) fn colour_correct<T: Sample>(
+        &self,
+        mut buffer: ImageBuffer<T>,
+        target: ColourSpace,
+    ) -> Result<ImageBuffer<T>> {
+        if let Some(m) = self.camera_to_target::<T>(target)? {
+            log::debug!("pixel cam at 1000, 1000: {:?}", buffer.pixel_at(1000, 1000));
+            log::debug!("Applying colour matrix");
+            buffer
+                .data
+                .par_chunks_mut(COLOUR_CHUNK * 3)
+                .for_each(|rgb| render::colour_transform(&m, rgb));
+            log::debug!("pixel rgb at 1000, 1000: {:?}", buffer.pixel_at(1000, 1000));
         }
 
         Ok(buffer)
@@ -535,46 +864,486 @@ impl RawImage {
 
     /// Render the image using `options`. See `[render::RenderingOptions]`
     /// May return `Error::Unimplemented`.
+    ///
+    /// `RenderingStage::Raw` is a copy of the raw data, cropped, with
+    /// the levels. See `into_rendered_image()` to avoid the copy.
     pub fn rendered_image(&self, options: RenderingOptions) -> Result<RawImage> {
-        // XXX fix to properly handle the Raw stage.
+        if options.stage == RenderingStage::Raw {
+            if self.data_type() != DataType::Raw {
+                return Err(Error::InvalidFormat);
+            }
+            let rect = self.stage_rect(&options)?.unwrap_or(Rect {
+                x: 0,
+                y: 0,
+                width: self.width,
+                height: self.height,
+            });
+            return self.cropped(&rect);
+        }
+        match options.precision {
+            RenderingPrecision::Single => self.render::<f32>(options),
+            RenderingPrecision::Double => self.render::<f64>(options),
+        }
+    }
+
+    /// Render the image using `options`, consuming it. Like
+    /// `rendered_image()`, but the stages before the interpolation
+    /// reuse the raw data: `RenderingStage::Raw` returns the image
+    /// itself unless cropped, and `RenderingStage::Linearization` is
+    /// done in place, in one pass.
+    pub fn into_rendered_image(self, options: RenderingOptions) -> Result<RawImage> {
+        if options.stage > RenderingStage::Linearization {
+            return self.rendered_image(options);
+        }
+        if self.data_type() != DataType::Raw {
+            return Err(Error::InvalidFormat);
+        }
+        let image = match self.stage_rect(&options)? {
+            Some(rect) => self.cropped(&rect)?,
+            None => self,
+        };
+        if options.stage == RenderingStage::Raw {
+            return Ok(image);
+        }
+        match options.precision {
+            RenderingPrecision::Single => image.linearized_in_place::<f32>(),
+            RenderingPrecision::Double => image.linearized_in_place::<f64>(),
+        }
+    }
+
+    /// Render the image using `options` into `dest`, with rows `stride`
+    /// bytes apart, or packed if `stride` is 0. The planes of
+    /// `RenderingFormat::PlanarF32` are `stride * height` apart. `dest`
+    /// must be aligned for the samples. The output isn't allocated.
+    ///
+    /// Return the dimensions of the rendered image.
+    /// `Error::BufferTooSmall` if `dest` is smaller than
+    /// `rendered_buffer_size()`.
+    pub fn rendered_image_into(
+        &self,
+        options: RenderingOptions,
+        dest: &mut [u8],
+        stride: usize,
+    ) -> Result<(u32, u32)> {
+        if options.stage == RenderingStage::Raw {
+            return self.raw_into(&options, dest, stride);
+        }
+        match options.output_bpc() {
+            8 => self.render_into::<u8>(options, dest, stride),
+            32 => self.render_into::<f32>(options, dest, stride),
+            _ => self.render_into::<u16>(options, dest, stride),
+        }
+    }
+
+    /// The dimensions of the image rendered with `options`, without
+    /// rendering it.
+    pub fn rendered_dimensions(&self, options: &RenderingOptions) -> Result<(u32, u32)> {
+        let (mut width, mut height) = self
+            .crop_rect(options.crop)
+            .map(|rect| (rect.width, rect.height))
+            .unwrap_or((self.width, self.height));
+        if let Some(region) = &options.region {
+            let (halo, border) = region_halo(options);
+            let (rx0, ry0, rx1, ry1) = clip_region(region, width, height, border)?;
+            if halo != 0 {
+                return Ok((rx1 - rx0, ry1 - ry0));
+            }
+            width = rx1 - rx0;
+            height = ry1 - ry0;
+        }
+        if options.stage <= RenderingStage::Linearization {
+            return Ok((width, height));
+        }
+        if options.scale != RenderingScale::Full {
+            let divisor = options.scale.divisor();
+            return Ok((width / divisor, height / divisor));
+        }
+        if self.photom_int == exif::PhotometricInterpretation::LinearRaw {
+            return Ok((width, height));
+        }
+
+        Ok((width.saturating_sub(2), height.saturating_sub(2)))
+    }
+
+    /// The size in bytes of the buffer to render with `options` and
+    /// rows `stride` bytes apart, or packed if `stride` is 0. See
+    /// `rendered_image_into()`.
+    pub fn rendered_buffer_size(&self, options: &RenderingOptions, stride: usize) -> Result<usize> {
+        let (width, height) = self.rendered_dimensions(options)?;
+        let size = options.output_bpc() as usize / 8;
+        if stride % size != 0 {
+            log::error!("Stride {stride} isn't a multiple of {size}");
+            return Err(Error::InvalidParam);
+        }
+        let layout = options
+            .output_layout(width as usize, height as usize)
+            .with_stride(stride / size)?;
+
+        Ok(layout.len() * size)
+    }
+
+    /// Render the image with samples of type `T` into a new image.
+    fn render<T: Sample>(&self, options: RenderingOptions) -> Result<RawImage> {
+        match options.output_bpc() {
+            8 => self.rendered_from::<u8, _>(|target| self.render_to::<T, _>(options, target)),
+            32 => self.rendered_from::<f32, _>(|target| self.render_to::<T, _>(options, target)),
+            _ => self.rendered_from::<u16, _>(|target| self.render_to::<T, _>(options, target)),
+        }
+    }
+
+    /// Render the image in samples of type `O` into `dest`. See
+    /// `rendered_image_into()`.
+    fn render_into<O: OutputSample>(
+        &self,
+        options: RenderingOptions,
+        dest: &mut [u8],
+        stride: usize,
+    ) -> Result<(u32, u32)> {
+        let (dest, stride) = output_samples::<O>(dest, stride)?;
+        let mut target = RenderTarget::Buffer(dest, stride);
+        let rendered = match options.precision {
+            RenderingPrecision::Single => self.render_to::<f32, O>(options, &mut target)?,
+            RenderingPrecision::Double => self.render_to::<f64, O>(options, &mut target)?,
+        };
+
+        Ok((rendered.width, rendered.height))
+    }
+
+    /// Copy the raw data cropped with `options` into `dest`. See
+    /// `rendered_image_into()`.
+    fn raw_into(
+        &self,
+        options: &RenderingOptions,
+        dest: &mut [u8],
+        stride: usize,
+    ) -> Result<(u32, u32)> {
+        let (dest, stride) = output_samples::<u16>(dest, stride)?;
+        let data16 = self.data16().ok_or(Error::InvalidFormat)?;
+        let width = self.width as usize;
+        let height = self.height as usize;
+        if self.data_type() != DataType::Raw || self.row_len() != width {
+            log::error!("Can't copy the raw data of {:?}", self.photom_int);
+            return Err(Error::InvalidFormat);
+        }
+        let rect = self.stage_rect(options)?.unwrap_or(Rect {
+            x: 0,
+            y: 0,
+            width: self.width,
+            height: self.height,
+        });
+        let layout =
+            OutputLayout::cfa(rect.width as usize, rect.height as usize).with_stride(stride)?;
+        if dest.len() < layout.len() {
+            log::error!("Buffer of {} too small for {layout:?}", dest.len());
+            return Err(Error::BufferTooSmall);
+        }
+        layout.copy_rect(
+            dest,
+            &OutputLayout::cfa(width, height),
+            data16,
+            rect.x as usize,
+            rect.y as usize,
+        )?;
+
+        Ok((rect.width, rect.height))
+    }
+
+    /// Linearize the CFA in place, in one pass, quantized to 16 bits
+    /// like the rendering. See `linearize()`.
+    fn linearized_in_place<T: Sample>(mut self) -> Result<RawImage> {
+        let width = self.width as usize;
+        let height = self.height as usize;
+        let mut data = match std::mem::take(&mut self.data) {
+            Data::Data16(data) if width != 0 && data.len() >= width * height => data,
+            _ => {
+                log::error!("Can't linearize {width}x{height} in place");
+                return Err(Error::InvalidFormat);
+            }
+        };
+        data.truncate(width * height);
+        let linearizer = self.linearizer::<T>().quantized();
+        data.par_chunks_mut(width)
+            .enumerate()
+            .for_each(|(y, row)| linearizer.apply_row_in_place(row, y));
+
+        let pattern = self.mosaic_pattern().clone();
+        let buffer = ImageBuffer::with_data(data, self.width, self.height, 16, 1);
+        Ok(self.rendered_from_buffer(buffer, DataType::PixmapRgb16, pattern))
+    }
+
+    /// Make the rendered image from what `render` outputs in a new
+    /// buffer.
+    fn rendered_from<O, F>(&self, render: F) -> Result<RawImage>
+    where
+        O: OutputSample,
+        F: FnOnce(&mut RenderTarget<O>) -> Result<Rendered>,
+    {
+        let mut target = RenderTarget::Alloc(vec![]);
+        let rendered = render(&mut target)?;
+        let data = match target {
+            RenderTarget::Alloc(data) => data,
+            RenderTarget::Buffer(..) => vec![],
+        };
+        let buffer = ImageBuffer::with_data(
+            data,
+            rendered.width,
+            rendered.height,
+            O::BPC,
+            rendered.channels,
+        );
+
+        Ok(self.rendered_from_buffer(buffer, rendered.data_type, rendered.pattern))
+    }
+
+    /// Render the image with samples of type `T`, output as `O` into
+    /// `target`.
+    ///
+    /// 2x2 bayer CFA with the bimedian demosaic go through the fused
+    /// `render::pipeline`.
+    fn render_to<T: Sample, O: OutputSample>(
+        &self,
+        options: RenderingOptions,
+        target: &mut RenderTarget<O>,
+    ) -> Result<Rendered> {
+        // The Raw stage isn't rendered, it is the raw data.
         if options.stage == RenderingStage::Raw {
             return Err(Error::Unimplemented);
         }
         if self.data_type() != DataType::Raw {
             return Err(Error::InvalidFormat);
         }
-        let x = self.width();
-        let y = self.height();
-        let mut pattern = self.mosaic_pattern().clone();
-        let data16 = ImageBuffer::with_data(
-            self.data16().ok_or(Error::InvalidFormat)?.to_vec(),
+        if options.crop != RenderingCrop::None {
+            let mut options = options;
+            let crop = self.crop_rect(options.crop);
+            options.crop = RenderingCrop::None;
+            if let Some(crop) = crop {
+                log::debug!("Cropping to {crop:?}");
+                return self.cropped(&crop)?.render_to::<T, O>(options, target);
+            }
+            return self.render_to::<T, O>(options, target);
+        }
+        if let Some(region) = options.region.clone() {
+            return self.render_region::<T, O>(&region, options, target);
+        }
+        let data16 = self.data16().ok_or(Error::InvalidFormat)?;
+        let width = self.width() as usize;
+        let height = self.height() as usize;
+        if options.stage == RenderingStage::Linearization {
+            let (out, layout) = target.buffer(OutputLayout::cfa(width, height))?;
+            pipeline::linearize(&self.linearizer::<T>(), data16, &layout, out)?;
+            return Ok(Rendered::new(
+                &layout,
+                DataType::PixmapRgb16,
+                self.mosaic_pattern().clone(),
+            ));
+        }
+        let format = options.format;
+        if options.scale != RenderingScale::Full {
+            if self.photom_int != exif::PhotometricInterpretation::CFA {
+                log::error!("Scaled rendering is only for CFA");
+                return Err(Error::Unimplemented);
+            }
+            let pipeline = self.bayer_pipeline::<T>(&options)?;
+            let divisor = options.scale.divisor() as usize;
+            let (out, layout) =
+                target.buffer(OutputLayout::new(width / divisor, height / divisor, format))?;
+            pipeline.render_scaled(data16, width, height, divisor, &layout, out)?;
+            return Ok(Rendered::new(&layout, format.data_type(), Pattern::Empty));
+        }
+        if options.demosaic == DemosaicMethod::Bimedian {
+            if let Ok(pipeline) = self.bayer_pipeline::<T>(&options) {
+                let (out, layout) = target.buffer(OutputLayout::new(
+                    width.saturating_sub(2),
+                    height.saturating_sub(2),
+                    format,
+                ))?;
+                pipeline.render(data16, width, height, &layout, out)?;
+                return Ok(Rendered::new(&layout, format.data_type(), Pattern::Empty));
+            }
+        }
+
+        self.render_staged_to::<T, O>(options, target)
+    }
+
+    /// The rectangle to crop to for `crop`, clipped to the image.
+    /// `None` if there is nothing to crop.
+    fn crop_rect(&self, crop: RenderingCrop) -> Option<Rect> {
+        let rect = crop.rect(self.active_area.as_ref(), self.user_crop.as_ref())?;
+        let x = std::cmp::min(rect.x, self.width);
+        let y = std::cmp::min(rect.y, self.height);
+        let rect = Rect {
             x,
             y,
-            16,
-            1,
-        );
+            width: std::cmp::min(rect.width, self.width - x),
+            height: std::cmp::min(rect.height, self.height - y),
+        };
+        if rect.width == self.width && rect.height == self.height {
+            return None;
+        }
+
+        Some(rect)
+    }
+
+    /// `region`, relative to `crop`, in the coordinates of the whole
+    /// image. Only the metadata is needed, not the data.
+    pub(crate) fn uncropped_region(&self, region: &Rect, crop: RenderingCrop) -> Rect {
+        let (x, y) = self
+            .crop_rect(crop)
+            .map(|rect| (rect.x, rect.y))
+            .unwrap_or((0, 0));
+        Rect {
+            x: region.x.saturating_add(x),
+            y: region.y.saturating_add(y),
+            ..region.clone()
+        }
+    }
+
+    /// The rectangle of the image for the stages before the
+    /// interpolation: the crop, then the region in it. `None` if it is
+    /// the whole image.
+    fn stage_rect(&self, options: &RenderingOptions) -> Result<Option<Rect>> {
+        let crop = self.crop_rect(options.crop);
+        let region = match &options.region {
+            Some(region) => region,
+            None => return Ok(crop),
+        };
+        let (x, y, width, height) = crop
+            .map(|rect| (rect.x, rect.y, rect.width, rect.height))
+            .unwrap_or((0, 0, self.width, self.height));
+        let (rx0, ry0, rx1, ry1) = clip_region(region, width, height, 0)?;
+        if rx1 - rx0 == self.width && ry1 - ry0 == self.height {
+            return Ok(None);
+        }
+
+        Ok(Some(Rect {
+            x: x + rx0,
+            y: y + ry0,
+            width: rx1 - rx0,
+            height: ry1 - ry0,
+        }))
+    }
+
+    /// Render the `region` of the image, in raw pixel coordinates,
+    /// from the raw data around it only. The region is clipped to what
+    /// the full image rendering would have.
+    fn render_region<T: Sample, O: OutputSample>(
+        &self,
+        region: &Rect,
+        mut options: RenderingOptions,
+        target: &mut RenderTarget<O>,
+    ) -> Result<Rendered> {
+        let (halo, border) = region_halo(&options);
+        options.region = None;
+        let (rx0, ry0, rx1, ry1) = clip_region(region, self.width, self.height, border)?;
+        let x0 = rx0.saturating_sub(halo);
+        let y0 = ry0.saturating_sub(halo);
+        let source = self.cropped(&Rect {
+            x: x0,
+            y: y0,
+            width: std::cmp::min(rx1 + halo, self.width) - x0,
+            height: std::cmp::min(ry1 + halo, self.height) - y0,
+        })?;
+        if halo == 0 {
+            return source.render_to::<T, O>(options, target);
+        }
+
+        let mut full = RenderTarget::Alloc(vec![]);
+        let rendered = source.render_to::<T, O>(options.clone(), &mut full)?;
+        let data = match full {
+            RenderTarget::Alloc(data) => data,
+            RenderTarget::Buffer(..) => vec![],
+        };
+        let full_layout = options.output_layout(rendered.width as usize, rendered.height as usize);
+        let (out, layout) =
+            target.buffer(options.output_layout((rx1 - rx0) as usize, (ry1 - ry0) as usize))?;
+        // The rendered image starts at `x0 + border`, `y0 + border`.
+        layout.copy_rect(
+            out,
+            &full_layout,
+            &data,
+            (rx0 - x0 - border) as usize,
+            (ry0 - y0 - border) as usize,
+        )?;
+
+        Ok(Rendered::new(&layout, rendered.data_type, rendered.pattern))
+    }
+
+    /// The fused pipeline to render the bayer CFA with `options`.
+    fn bayer_pipeline<T: Sample>(
+        &self,
+        options: &RenderingOptions,
+    ) -> Result<pipeline::BayerPipeline<T>> {
+        if self.photom_int != exif::PhotometricInterpretation::CFA {
+            return Err(Error::InvalidFormat);
+        }
+        let npattern = render::demosaic::bayer_index(self.mosaic_pattern())?;
+        let colour = options.stage >= RenderingStage::Colour;
+        Ok(pipeline::BayerPipeline {
+            linearizer: self.linearizer::<T>(),
+            npattern,
+            colour: if colour {
+                self.camera_to_target(options.target)?
+            } else {
+                None
+            },
+            gamma: if colour {
+                render::target_gamma(options.target)
+            } else {
+                None
+            },
+        })
+    }
+
+    /// Make the rendered image of `data_type` from the `buffer`.
+    fn rendered_from_buffer<O: OutputSample>(
+        &self,
+        buffer: ImageBuffer<O>,
+        data_type: DataType,
+        pattern: Pattern,
+    ) -> RawImage {
+        // XXX make sure to copy over other data from the rawimage.
+        let white = u16::MAX >> (16 - std::cmp::min(O::BPC, 16));
+        let mut image = RawImage::with_image_buffer(buffer, data_type, pattern);
+        image.set_blacks([0, 0, 0, 0]);
+        image.set_whites([white; 4]);
+
+        image
+    }
+
+    /// Render the image with samples of type `T`, one stage at a
+    /// time over the whole image, output as `O` into `target`.
+    fn render_staged_to<T: Sample, O: OutputSample>(
+        &self,
+        options: RenderingOptions,
+        target: &mut RenderTarget<O>,
+    ) -> Result<Rendered> {
+        let data16 = self.data16().ok_or(Error::InvalidFormat)?;
         log::debug!("Linearizing data");
-        let mut data = self.linearize(data16);
-        if options.stage >= RenderingStage::Interpolation {
-            log::debug!("Interpolating");
-            data = self.interpolate(data)?;
-            pattern = Pattern::Empty;
+        let mut data = self.linearize::<T>(data16);
+        if options.stage < RenderingStage::Interpolation {
+            let (out, layout) =
+                target.buffer(OutputLayout::cfa(data.width as usize, data.height as usize))?;
+            data.encode_into(None, &layout, out)?;
+            return Ok(Rendered::new(
+                &layout,
+                DataType::PixmapRgb16,
+                self.mosaic_pattern().clone(),
+            ));
         }
+        log::debug!("Interpolating");
+        data = self.interpolate(data, options.demosaic)?;
 
+        let mut gamma = None;
         if options.stage >= RenderingStage::Colour {
             match self.photom_int {
                 exif::PhotometricInterpretation::CFA => {
                     log::debug!("RGB colour correction");
                     data = self.colour_correct(data, options.target)?;
-                    data.data
-                        .iter_mut()
-                        .for_each(|v| *v = gamma_correct_srgb(*v));
+                    gamma = render::target_gamma(options.target);
                 }
                 exif::PhotometricInterpretation::LinearRaw => {
                     log::debug!("Grayscale GAMMA");
-                    data.data
-                        .iter_mut()
-                        .for_each(|v| *v = gamma_correct_f::<22>(*v));
+                    gamma = Some(&*render::GAMMA_22);
                 }
                 _ => {}
             }
@@ -585,20 +1354,169 @@ impl RawImage {
             data.pixel_at(1000, 1000)
         );
 
-        // XXX make sure to copy over other data from the rawimage.
-        let data16 = data.into_u16();
-        log::debug!(
-            "pixel rgb(u16) at 1000, 1000: {:?}",
-            data16.pixel_at(1000, 1000)
-        );
-        let mut image = RawImage::with_image_buffer(data16, DataType::PixmapRgb16, pattern);
-        if options.stage >= RenderingStage::Linearization {
-            image.set_blacks([0, 0, 0, 0]);
-            image.set_whites([u16::MAX; 4]);
+        let format = options.format;
+        let (out, layout) = target.buffer(OutputLayout::new(
+            data.width as usize,
+            data.height as usize,
+            format,
+        ))?;
+        data.encode_into(gamma, &layout, out)?;
+
+        Ok(Rendered::new(&layout, format.data_type(), Pattern::Empty))
+    }
+
+    /// Render the image with samples of type `T`, one stage at a
+    /// time over the whole image.
+    #[cfg(test)]
+    fn render_staged<T: Sample>(&self, options: RenderingOptions) -> Result<RawImage> {
+        self.rendered_from::<u16, _>(|target| self.render_staged_to::<T, _>(options, target))
+    }
+}
+
+/// The output of the rendering.
+enum RenderTarget<'a, O> {
+    /// Allocate the output, packed.
+    Alloc(Vec<O>),
+    /// The caller buffer, with rows `stride` samples apart, or packed
+    /// if 0.
+    Buffer(&'a mut [O], usize),
+}
+
+impl<'a, O: OutputSample> RenderTarget<'a, O> {
+    /// The buffer to render the packed `layout` in, and the layout to
+    /// render with.
+    fn buffer(&mut self, layout: OutputLayout) -> Result<(&mut [O], OutputLayout)> {
+        match self {
+            RenderTarget::Alloc(data) => {
+                *data = uninit_vec!(layout.len());
+                Ok((&mut data[..], layout))
+            }
+            RenderTarget::Buffer(buffer, stride) => {
+                let layout = layout.with_stride(*stride)?;
+                if buffer.len() < layout.len() {
+                    log::error!("Buffer of {} too small for {layout:?}", buffer.len());
+                    return Err(Error::BufferTooSmall);
+                }
+                Ok((&mut buffer[..], layout))
+            }
         }
+    }
+}
 
-        Ok(image)
+/// What was rendered.
+struct Rendered {
+    width: u32,
+    height: u32,
+    /// The number of components per pixel, all planes included.
+    channels: u32,
+    data_type: DataType,
+    pattern: Pattern,
+}
+
+impl Rendered {
+    fn new(layout: &OutputLayout, data_type: DataType, pattern: Pattern) -> Rendered {
+        Rendered {
+            width: layout.width as u32,
+            height: layout.height as u32,
+            channels: (layout.channels * layout.planes) as u32,
+            data_type,
+            pattern,
+        }
+    }
+}
+
+/// The samples of type `O` in `dest`, and `stride`, in bytes, in
+/// samples. `dest` must be aligned for `O`.
+fn output_samples<O: OutputSample>(dest: &mut [u8], stride: usize) -> Result<(&mut [O], usize)> {
+    let size = std::mem::size_of::<O>();
+    if stride % size != 0 {
+        log::error!("Stride {stride} isn't a multiple of {size}");
+        return Err(Error::InvalidParam);
+    }
+    // Any bit pattern is a valid `OutputSample`.
+    let (head, dest, _) = unsafe { dest.align_to_mut::<O>() };
+    if !head.is_empty() {
+        log::error!("Output buffer not aligned to {size}");
+        return Err(Error::InvalidParam);
     }
+
+    Ok((dest, stride / size))
+}
+
+/// The pixels needed around a region to render it with `options`, and
+/// the border the rendering doesn't output.
+pub(crate) fn region_halo(options: &RenderingOptions) -> (u32, u32) {
+    if options.scale != RenderingScale::Full || options.stage < RenderingStage::Interpolation {
+        (0, 0)
+    } else if options.demosaic == DemosaicMethod::Ppg {
+        (4, 1)
+    } else {
+        (1, 1)
+    }
+}
+
+/// Clip `region` to what the rendering of an image `width` x `height`
+/// with `border` has. Return the left, top, right and bottom edges.
+fn clip_region(
+    region: &Rect,
+    width: u32,
+    height: u32,
+    border: u32,
+) -> Result<(u32, u32, u32, u32)> {
+    let rx0 = std::cmp::max(region.x, border);
+    let ry0 = std::cmp::max(region.y, border);
+    let rx1 = std::cmp::min(
+        region.x.saturating_add(region.width),
+        width.saturating_sub(border),
+    );
+    let ry1 = std::cmp::min(
+        region.y.saturating_add(region.height),
+        height.saturating_sub(border),
+    );
+    if rx1 <= rx0 || ry1 <= ry0 {
+        log::error!("Region {region:?} outside of the image");
+        return Err(Error::InvalidParam);
+    }
+
+    Ok((rx0, ry0, rx1, ry1))
+}
+
+/// Crop `rect` out of `data`, `width` x `height` with interleaved
+/// components, in `planes` planes. `None` if the size doesn't match.
+fn crop_samples<S: Copy>(
+    data: &[S],
+    width: usize,
+    height: usize,
+    planes: usize,
+    rect: &Rect,
+) -> Option<Vec<S>> {
+    let pixels = width * height * planes;
+    if pixels == 0 || data.is_empty() || data.len() % pixels != 0 {
+        return None;
+    }
+    let cc = data.len() / pixels;
+    let x = rect.x as usize * cc;
+    let len = rect.width as usize * cc;
+    let data = data
+        .chunks_exact(data.len() / planes)
+        .flat_map(|plane| {
+            plane
+                .chunks_exact(width * cc)
+                .skip(rect.y as usize)
+                .take(rect.height as usize)
+                .flat_map(|row| &row[x..x + len])
+        })
+        .copied()
+        .collect();
+
+    Some(data)
+}
+
+/// Levels per 2x2 CFA position, in row order, for the image cropped
+/// at `x`, `y`.
+fn shifted_levels(levels: &[u16; 4], x: u32, y: u32) -> [u16; 4] {
+    let (x, y) = (x as usize, y as usize);
+    std::array::from_fn(|i| levels[((i / 2 + y) % 2) * 2 + (i % 2 + x) % 2])
 }
 
 impl Bitmap for RawImage {
@@ -610,6 +1528,7 @@ impl Bitmap for RawImage {
         match self.data {
             Data::Data8(ref d) => d.len(),
             Data::Data16(ref d) => d.len() * 2,
+            Data::DataF32(ref d) => d.len() * 4,
             Data::Tiled(ref d) => d.0.iter().map(|t| t.len()).sum(),
         }
     }
@@ -638,4 +1557,861 @@ impl Bitmap for RawImage {
             _ => None,
         }
     }
+
+    fn data_f32(&self) -> Option<&[f32]> {
+        match self.data {
+            Data::DataF32(ref d) => Some(d),
+            _ => None,
+        }
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::RawImage;
+    use crate::binning::Binning;
+    use crate::mosaic::Pattern;
+    use crate::render::{self, Sample};
+    use crate::tiff::exif;
+    use crate::{
+        Bitmap, ColourSpace, DataType, DemosaicMethod, Error, Rect, RenderingCrop, RenderingFormat,
+        RenderingOptions, RenderingPrecision, RenderingScale, RenderingStage,
+    };
+
+    /// A 64 x 48 12 bits test image with the CFA `pattern`.
+    fn test_image(pattern: Pattern) -> RawImage {
+        let data = (0..64 * 48).map(|v| ((v * 7919) % 4096) as u16).collect();
+        let mut rawimage = RawImage::with_data16(64, 48, 12, DataType::Raw, data, pattern);
+        rawimage.set_whites([4095; 4]);
+        rawimage
+    }
+
+    /// Check the fused pipeline against the staged rendering.
+    fn check_fused<T: Sample>(rawimage: &RawImage) {
+        for stage in [
+            RenderingStage::Linearization,
+            RenderingStage::Interpolation,
+            RenderingStage::Colour,
+        ] {
+            let options = RenderingOptions::default().with_stage(stage);
+            let fused = rawimage
+                .render::<T>(options.clone())
+                .expect("Fused rendering failed");
+            let staged = rawimage
+                .render_staged::<T>(options)
+                .expect("Staged rendering failed");
+            assert_eq!(fused.width(), staged.width());
+            assert_eq!(fused.height(), staged.height());
+            assert_eq!(fused.mosaic_pattern(), staged.mosaic_pattern());
+            assert_eq!(fused.data16(), staged.data16(), "{stage:?}");
+        }
+    }
+
+    #[test]
+    fn test_render_fused() {
+        let data = (0..301 * 123).map(|v| ((v * 7919) % 4096) as u16).collect();
+        let mut rawimage = RawImage::with_data16(301, 123, 12, DataType::Raw, data, Pattern::Gbrg);
+        rawimage.set_whites([4000; 4]);
+        rawimage.set_blacks([128; 4]);
+        rawimage.set_colour_matrix(
+            1,
+            exif::LightsourceValue::D65,
+            &[
+                0.6722, -0.0635, -0.0963, -0.4287, 1.2460, 0.2028, -0.0908, 0.2162, 0.5668,
+            ],
+        );
+
+        check_fused::<f32>(&rawimage);
+        check_fused::<f64>(&rawimage);
+    }
+
+    #[test]
+    fn test_render_precision() {
+        let data = (0..32 * 32).map(|v| ((v * 37) % 4096) as u16).collect();
+        let mut rawimage = RawImage::with_data16(32, 32, 12, DataType::Raw, data, Pattern::Rggb);
+        rawimage.set_whites([4095; 4]);
+        rawimage.set_blacks([64; 4]);
+
+        for stage in [
+            RenderingStage::Linearization,
+            RenderingStage::Interpolation,
+            RenderingStage::Colour,
+        ] {
+            let options = RenderingOptions::default().with_stage(stage);
+            let single = rawimage
+                .rendered_image(options.clone())
+                .expect("f32 rendering failed");
+            let double = rawimage
+                .rendered_image(options.with_precision(RenderingPrecision::Double))
+                .expect("f64 rendering failed");
+            assert_eq!(single.width(), double.width());
+            assert_eq!(single.height(), double.height());
+            let single = single.data16().unwrap();
+            let double = double.data16().unwrap();
+            assert_eq!(single.len(), double.len());
+            single
+                .iter()
+                .zip(double.iter())
+                .for_each(|(s, d)| assert!((*s as i32 - *d as i32).abs() <= 1, "{stage:?}"));
+        }
+    }
+
+    #[test]
+    fn test_render_demosaic_method() {
+        let rawimage = test_image(Pattern::Bggr);
+
+        let options = RenderingOptions::default().with_stage(RenderingStage::Interpolation);
+        let bimedian = rawimage
+            .rendered_image(options.clone())
+            .expect("Bimedian rendering failed");
+        let ppg = rawimage
+            .rendered_image(options.clone().with_demosaic(DemosaicMethod::Ppg))
+            .expect("PPG rendering failed");
+        assert_eq!(bimedian.width(), ppg.width());
+        assert_eq!(bimedian.height(), ppg.height());
+        assert_eq!(
+            bimedian.data16().map(|d| d.len()),
+            ppg.data16().map(|d| d.len())
+        );
+
+        // X-Trans
+        use crate::mosaic::PatternColour::*;
+        let pattern = Pattern::NonRgb22(vec![
+            Green, Green, Red, Green, Green, Blue, Green, Green, Blue, Green, Green, Red, Blue,
+            Red, Green, Red, Blue, Green, Green, Green, Blue, Green, Green, Red, Green, Green, Red,
+            Green, Green, Blue, Red, Blue, Green, Blue, Red, Green,
+        ]);
+        let rawimage = test_image(pattern);
+        let xtrans = rawimage
+            .rendered_image(options)
+            .expect("X-Trans rendering failed");
+        assert_eq!(xtrans.width(), 62);
+        assert_eq!(xtrans.height(), 46);
+        assert_eq!(xtrans.mosaic_pattern(), &Pattern::Empty);
+    }
+
+    #[test]
+    fn test_render_scale() {
+        let rawimage = test_image(Pattern::Rggb);
+
+        let options = RenderingOptions::default().with_stage(RenderingStage::Interpolation);
+        for (scale, width, height) in [
+            (RenderingScale::Half, 32, 24),
+            (RenderingScale::Quarter, 16, 12),
+            (RenderingScale::Eighth, 8, 6),
+        ] {
+            let image = rawimage
+                .rendered_image(options.clone().with_scale(scale))
+                .expect("Scaled rendering failed");
+            assert_eq!(image.width(), width);
+            assert_eq!(image.height(), height);
+            assert_eq!(image.data_type(), DataType::PixmapRgb16);
+            assert_eq!(
+                image.data16().map(|d| d.len()),
+                Some(width as usize * height as usize * 3)
+            );
+        }
+    }
+
+    #[test]
+    fn test_render_format() {
+        let rawimage = test_image(Pattern::Rggb);
+
+        let region = Rect {
+            x: 11,
+            y: 6,
+            width: 20,
+            height: 15,
+        };
+        for method in [DemosaicMethod::Bimedian, DemosaicMethod::Ppg] {
+            for region in [None, Some(region.clone())] {
+                let options = RenderingOptions::default()
+                    .with_stage(RenderingStage::Interpolation)
+                    .with_demosaic(method)
+                    .with_region(region);
+                let rgb16 = rawimage
+                    .rendered_image(options.clone())
+                    .expect("Rendering failed");
+                let rgb16 = rgb16.data16().unwrap();
+                let pixels = rgb16.len() / 3;
+
+                let image = rawimage
+                    .rendered_image(options.clone().with_format(RenderingFormat::Rgba8))
+                    .expect("Rendering failed");
+                assert_eq!(image.data_type(), DataType::PixmapRgba8);
+                assert_eq!(image.bpc(), 8);
+                let rgba8 = image.data8().unwrap();
+                assert_eq!(rgba8.len(), pixels * 4);
+                for (p16, p8) in rgb16.chunks_exact(3).zip(rgba8.chunks_exact(4)) {
+                    for (v16, v8) in p16.iter().zip(p8.iter()) {
+                        assert!((*v16 as f64 / 257.0 - *v8 as f64).abs() <= 1.0);
+                    }
+                    assert_eq!(p8[3], 255);
+                }
+
+                let image = rawimage
+                    .rendered_image(options.with_format(RenderingFormat::PlanarF32))
+                    .expect("Rendering failed");
+                assert_eq!(image.data_type(), DataType::PixmapPlanarF32);
+                assert_eq!(image.bpc(), 32);
+                assert_eq!(image.data_size(), pixels * 3 * 4);
+                let planar = image.data_f32().unwrap();
+                for (i, pixel) in rgb16.chunks_exact(3).enumerate() {
+                    for (c, v) in pixel.iter().enumerate() {
+                        let f = planar[c * pixels + i];
+                        assert!((f * 65535.0 - *v as f32).abs() <= 0.5, "{method:?} {i}");
+                    }
+                }
+            }
+        }
+
+        // The linearization is always 16 bits.
+        let image = rawimage
+            .rendered_image(
+                RenderingOptions::default()
+                    .with_stage(RenderingStage::Linearization)
+                    .with_format(RenderingFormat::Rgb8),
+            )
+            .expect("Rendering failed");
+        assert_eq!(image.data_type(), DataType::PixmapRgb16);
+        assert_eq!(image.data16().map(|d| d.len()), Some(64 * 48));
+    }
+
+    #[test]
+    fn test_render_into() {
+        let mut rawimage = test_image(Pattern::Rggb);
+        rawimage.set_active_area(Some(Rect {
+            x: 2,
+            y: 3,
+            width: 50,
+            height: 40,
+        }));
+
+        let region = Rect {
+            x: 11,
+            y: 6,
+            width: 20,
+            height: 15,
+        };
+        let variants = [
+            RenderingOptions::default().with_stage(RenderingStage::Linearization),
+            RenderingOptions::default().with_stage(RenderingStage::Interpolation),
+            RenderingOptions::default()
+                .with_stage(RenderingStage::Interpolation)
+                .with_demosaic(DemosaicMethod::Ppg),
+            RenderingOptions::default()
+                .with_stage(RenderingStage::Interpolation)
+                .with_scale(RenderingScale::Half),
+            RenderingOptions::default()
+                .with_stage(RenderingStage::Interpolation)
+                .with_crop(RenderingCrop::ActiveArea),
+            RenderingOptions::default()
+                .with_stage(RenderingStage::Interpolation)
+                .with_region(Some(region)),
+        ];
+        for options in variants {
+            let image = rawimage
+                .rendered_image(options.clone())
+                .expect("Rendering failed");
+            let (width, height) = rawimage
+                .rendered_dimensions(&options)
+                .expect("No dimensions");
+            assert_eq!((image.width(), image.height()), (width, height));
+            let expected = image.data16().unwrap();
+            let row_len = expected.len() / height as usize;
+
+            // 16-bit samples, rows padded by 5 samples.
+            let stride = (row_len + 5) * 2;
+            let size = rawimage
+                .rendered_buffer_size(&options, stride)
+                .expect("No size");
+            assert_eq!(size, ((height as usize - 1) * (row_len + 5) + row_len) * 2);
+            let mut buffer = vec![0xdead_u16; size / 2 + 1];
+            let (_, dest, _) = unsafe { buffer.align_to_mut::<u8>() };
+            assert!(matches!(
+                rawimage.rendered_image_into(options.clone(), &mut dest[..size - 2], stride),
+                Err(Error::BufferTooSmall)
+            ));
+            assert!(matches!(
+                rawimage.rendered_image_into(options.clone(), dest, 3),
+                Err(Error::InvalidParam)
+            ));
+            assert_eq!(
+                rawimage
+                    .rendered_image_into(options, dest, stride)
+                    .expect("Rendering failed"),
+                (width, height)
+            );
+            for (y, row) in expected.chunks_exact(row_len).enumerate() {
+                let o = y * (row_len + 5);
+                assert_eq!(&buffer[o..o + row_len], row);
+                if y + 1 < height as usize {
+                    assert!(buffer[o + row_len..o + row_len + 5]
+                        .iter()
+                        .all(|v| *v == 0xdead));
+                }
+            }
+            assert_eq!(buffer[size / 2], 0xdead);
+        }
+
+        // The raw data.
+        assert_eq!(rawimage.data16_buffer_size(70).ok(), Some(47 * 70 + 64));
+        let mut buffer = vec![0_u16; 47 * 70 + 64];
+        let small = RawImage::with_data16(64, 48, 12, DataType::Raw, data.clone(), Pattern::Rggb);
+        assert!(matches!(
+            small.move_data16_into(&mut buffer[1..], 70),
+            Err(Error::BufferTooSmall)
+        ));
+        let moved = rawimage
+            .move_data16_into(&mut buffer, 70)
+            .expect("Move failed");
+        assert_eq!(moved.width(), 64);
+        assert_eq!(moved.data16().map(|d| d.len()), Some(0));
+        for (y, row) in data.chunks_exact(64).enumerate() {
+            assert_eq!(&buffer[y * 70..y * 70 + 64], row);
+        }
+    }
+
+    #[test]
+    fn test_binned() {
+        let data = vec![1000_u16; 64 * 48];
+        let mut rawimage = RawImage::with_data16(64, 48, 12, DataType::Raw, data, Pattern::Gbrg);
+        rawimage.set_blacks([100, 200, 300, 400]);
+        rawimage.set_whites([4095; 4]);
+
+        let binned = rawimage.binned(Binning::Cfa).expect("Binning failed");
+        assert_eq!((binned.width(), binned.height()), (32, 24));
+        assert_eq!(binned.data_type(), DataType::Raw);
+        assert_eq!(binned.mosaic_pattern(), &Pattern::Gbrg);
+        assert_eq!(binned.blacks(), &[0; 4]);
+        assert_eq!(binned.whites(), &[3995, 3895, 3795, 3695]);
+        let data = binned.data16().unwrap();
+        assert_eq!(&data[..2], &[900, 800]);
+        assert_eq!(&data[32..34], &[700, 600]);
+
+        // GBRG: R is at 0, 1 and B at 1, 0.
+        let binned = rawimage.binned(Binning::Planes).expect("Binning failed");
+        assert_eq!((binned.width(), binned.height()), (32, 24));
+        assert_eq!(binned.data_type(), DataType::RawPlanes);
+        assert_eq!(binned.whites(), &[3795, 3695, 3995, 3895]);
+        let data = binned.data16().unwrap();
+        assert_eq!(data.len(), 32 * 24 * 4);
+        for (plane, value) in data.chunks_exact(32 * 24).zip([700, 600, 900, 800]) {
+            assert!(plane.iter().all(|v| *v == value));
+        }
+        // Planes are cropped together.
+        let cropped = binned
+            .cropped(&Rect {
+                x: 1,
+                y: 1,
+                width: 4,
+                height: 4,
+            })
+            .expect("Crop failed");
+        assert_eq!(cropped.data16().map(|d| d.len()), Some(4 * 4 * 4));
+
+        let xtrans = RawImage::with_data16(
+            12,
+            12,
+            12,
+            DataType::Raw,
+            vec![0; 144],
+            Pattern::NonRgb22(vec![]),
+        );
+        assert!(xtrans.binned(Binning::Cfa).is_err());
+    }
+
+    #[test]
+    fn test_planar() {
+        // GRBG, 5x4, the value is 10 * y + x. The last column is dropped.
+        let data = (0..5 * 4).map(|v| (v / 5 * 10 + v % 5) as u16).collect();
+        let mut rawimage = RawImage::with_data16(5, 4, 12, DataType::Raw, data, Pattern::Grbg);
+        rawimage.set_blacks([100, 200, 300, 400]);
+        rawimage.set_whites([4000, 4001, 4002, 4003]);
+
+        let planar = rawimage.planar().expect("Planar failed");
+        assert_eq!((planar.width(), planar.height()), (2, 2));
+        assert_eq!(planar.data_type(), DataType::RawPlanes);
+        assert_eq!(planar.mosaic_pattern(), &Pattern::Empty);
+        // R at 1, 0, G1 at 0, 0, G2 at 1, 1 and B at 0, 1.
+        assert_eq!(planar.blacks(), &[200, 100, 400, 300]);
+        assert_eq!(planar.whites(), &[4001, 4000, 4003, 4002]);
+        assert_eq!(planar.plane(0), Some(&[1_u16, 3, 21, 23][..]));
+        assert_eq!(planar.plane(1), Some(&[0_u16, 2, 20, 22][..]));
+        assert_eq!(planar.plane(2), Some(&[11_u16, 13, 31, 33][..]));
+        assert_eq!(planar.plane(3), Some(&[10_u16, 12, 30, 32][..]));
+        assert_eq!(planar.plane(4), None);
+        assert_eq!(rawimage.plane(0), None);
+
+        // The statistics are per plane with its levels.
+        let stats = planar.statistics().expect("Statistics failed");
+        assert_eq!(stats.channels().len(), 4);
+        assert_eq!(stats.channels()[0].below_black, 4);
+
+        assert!(planar.planar().is_err());
+    }
+
+    #[test]
+    fn test_statistics() {
+        let data = (0..64 * 48).map(|v| (v * 2) as u16).collect();
+        let mut rawimage = RawImage::with_data16(64, 48, 12, DataType::Raw, data, Pattern::Rggb);
+        rawimage.set_blacks([64; 4]);
+        rawimage.set_whites([4000; 4]);
+
+        let stats = rawimage.statistics().expect("Statistics failed");
+        let channels = stats.channels();
+        assert_eq!(channels.len(), 4);
+        assert!(channels.iter().all(|c| c.count == 32 * 24));
+        assert!(channels.iter().all(|c| c.histogram.len() == 4096));
+        // Below black is the first half of the first row.
+        assert_eq!(channels[0].min, 0);
+        assert_eq!(channels[0].below_black, 16);
+        assert_eq!(channels[1].below_black, 16);
+        assert_eq!(channels[2].below_black, 0);
+        assert_eq!(channels[3].max, 6142);
+        // Past the last bin.
+        assert_eq!(channels[3].histogram[4095], 256);
+        let clipped: u64 = channels.iter().map(|c| c.clipped).sum();
+        assert_eq!(clipped, 64 * 48 - 2000);
+
+        // Per plane once binned, the black subtracted.
+        let binned = rawimage.binned(Binning::Planes).expect("Binning failed");
+        let stats = binned.statistics().expect("Statistics failed");
+        assert_eq!(stats.channels().len(), 4);
+        for (plane, channel) in stats.channels().iter().zip(channels.iter()) {
+            assert_eq!(plane.count, channel.count);
+            assert_eq!(plane.below_black, 0);
+            assert_eq!(plane.clipped, channel.clipped);
+        }
+    }
+
+    #[test]
+    fn test_render_region() {
+        let rawimage = test_image(Pattern::Grbg);
+
+        let region = Rect {
+            x: 11,
+            y: 6,
+            width: 20,
+            height: 15,
+        };
+        for method in [DemosaicMethod::Bimedian, DemosaicMethod::Ppg] {
+            let options = RenderingOptions::default()
+                .with_stage(RenderingStage::Interpolation)
+                .with_demosaic(method);
+            let full = rawimage
+                .rendered_image(options.clone())
+                .expect("Rendering failed");
+            let image = rawimage
+                .rendered_image(options.with_region(Some(region.clone())))
+                .expect("Region rendering failed");
+            assert_eq!(image.width(), 20);
+            assert_eq!(image.height(), 15);
+            // The full rendering starts at 1, 1.
+            let expected = full
+                .cropped(&Rect {
+                    x: 10,
+                    y: 5,
+                    width: 20,
+                    height: 15,
+                })
+                .expect("Crop failed");
+            assert_eq!(image.data16(), expected.data16(), "{method:?}");
+        }
+
+        let options = RenderingOptions::default().with_stage(RenderingStage::Linearization);
+        let full = rawimage
+            .rendered_image(options.clone())
+            .expect("Rendering failed");
+        let image = rawimage
+            .rendered_image(options.with_region(Some(region.clone())))
+            .expect("Region rendering failed");
+        assert_eq!(image.mosaic_pattern(), &Pattern::Rggb);
+        assert_eq!(
+            image.data16(),
+            full.cropped(&region).expect("Crop failed").data16()
+        );
+
+        // Clipped to the rendered area.
+        let options = RenderingOptions::default().with_stage(RenderingStage::Interpolation);
+        let image = rawimage
+            .rendered_image(options.clone().with_region(Some(Rect {
+                x: 60,
+                y: 40,
+                width: 20,
+                height: 20,
+            })))
+            .expect("Region rendering failed");
+        assert_eq!(image.width(), 3);
+        assert_eq!(image.height(), 7);
+        assert!(rawimage
+            .rendered_image(options.with_region(Some(Rect {
+                x: 63,
+                y: 0,
+                width: 20,
+                height: 20,
+            })))
+            .is_err());
+    }
+
+    #[test]
+    fn test_retain_tiles() {
+        let mut rawimage = RawImage::new_tiled(
+            10,
+            10,
+            16,
+            DataType::CompressedRaw,
+            vec![vec![1_u8]; 9],
+            (4, 4),
+            Pattern::Rggb,
+        );
+        rawimage.retain_tiles(&Rect {
+            x: 5,
+            y: 0,
+            width: 2,
+            height: 5,
+        });
+        let kept: Vec<usize> = rawimage
+            .tile_data()
+            .expect("No tiles")
+            .iter()
+            .enumerate()
+            .filter(|(_, tile)| !tile.is_empty())
+            .map(|(idx, _)| idx)
+            .collect();
+        assert_eq!(kept, vec![1, 4]);
+    }
+
+    #[test]
+    fn test_render_crop() {
+        let mut rawimage = test_image(Pattern::Rggb);
+        let active_area = Rect {
+            x: 3,
+            y: 2,
+            width: 40,
+            height: 30,
+        };
+        let user_crop = Rect {
+            x: 10,
+            y: 10,
+            width: 20,
+            height: 10,
+        };
+        rawimage.set_active_area(Some(active_area.clone()));
+
+        let options = RenderingOptions::default().with_stage(RenderingStage::Linearization);
+        let full = rawimage
+            .rendered_image(options.clone())
+            .expect("Rendering failed");
+        assert_eq!(full.width(), 64);
+        let image = rawimage
+            .rendered_image(options.clone().with_crop(RenderingCrop::ActiveArea))
+            .expect("Rendering failed");
+        assert_eq!(image.width(), 40);
+        assert_eq!(image.height(), 30);
+        // The CFA phase is kept.
+        assert_eq!(image.mosaic_pattern(), &Pattern::Grbg);
+        assert_eq!(
+            image.data16(),
+            full.cropped(&active_area).expect("Crop failed").data16()
+        );
+        // Without a user crop, it's the active area.
+        let image = rawimage
+            .rendered_image(options.clone().with_crop(RenderingCrop::UserCrop))
+            .expect("Rendering failed");
+        assert_eq!(image.width(), 40);
+
+        rawimage.set_user_crop(Some(user_crop.clone()), None);
+        // A region of the crop, in the whole image.
+        let region = Rect {
+            x: 2,
+            y: 1,
+            width: 4,
+            height: 3,
+        };
+        let uncropped = rawimage.uncropped_region(&region, RenderingCrop::UserCrop);
+        assert_eq!((uncropped.x, uncropped.y, uncropped.width), (12, 11, 4));
+        let uncropped = rawimage.uncropped_region(&region, RenderingCrop::ActiveArea);
+        assert_eq!((uncropped.x, uncropped.y, uncropped.height), (5, 3, 3));
+        let uncropped = rawimage.uncropped_region(&region, RenderingCrop::None);
+        assert_eq!((uncropped.x, uncropped.y), (2, 1));
+
+        let options = RenderingOptions::default().with_stage(RenderingStage::Interpolation);
+        let image = rawimage
+            .rendered_image(options.clone().with_crop(RenderingCrop::UserCrop))
+            .expect("Rendering failed");
+        // The demosaic drops the border.
+        assert_eq!(image.width(), 18);
+        assert_eq!(image.height(), 8);
+        let expected = rawimage
+            .cropped(&user_crop)
+            .and_then(|cropped| cropped.rendered_image(options))
+            .expect("Rendering failed");
+        assert_eq!(image.data16(), expected.data16());
+    }
+
+    #[test]
+    fn test_render_raw_stage() {
+        let new_image = || {
+            let mut rawimage = test_image(Pattern::Rggb);
+            rawimage.set_blacks([64, 64, 66, 66]);
+            rawimage.set_active_area(Some(Rect {
+                x: 3,
+                y: 2,
+                width: 40,
+                height: 30,
+            }));
+            rawimage
+        };
+        let rawimage = new_image();
+        let data = rawimage.data16().unwrap().to_vec();
+        let region = Rect {
+            x: 5,
+            y: 4,
+            width: 10,
+            height: 6,
+        };
+        let options = RenderingOptions::default()
+            .with_stage(RenderingStage::Raw)
+            .with_crop(RenderingCrop::ActiveArea)
+            .with_region(Some(region));
+        assert_eq!(rawimage.rendered_dimensions(&options).ok(), Some((10, 6)));
+        let image = rawimage
+            .rendered_image(options.clone())
+            .expect("Rendering failed");
+        assert_eq!((image.width(), image.height()), (10, 6));
+        // The levels and the CFA phase follow the crop at 8, 6.
+        assert_eq!(image.blacks(), &[64, 64, 66, 66]);
+        assert_eq!(image.mosaic_pattern(), &Pattern::Rggb);
+        assert_eq!(image.data16().unwrap()[0], data[6 * 64 + 8]);
+        assert_eq!(image.data16().unwrap()[11], data[7 * 64 + 9]);
+
+        let mut buffer = vec![0xdead_u16; 5 * 12 + 10];
+        let (_, dest, _) = unsafe { buffer.align_to_mut::<u8>() };
+        assert_eq!(
+            rawimage.rendered_image_into(options.clone(), dest, 24).ok(),
+            Some((10, 6))
+        );
+        for (y, row) in image.data16().unwrap().chunks_exact(10).enumerate() {
+            assert_eq!(&buffer[y * 12..y * 12 + 10], row);
+        }
+
+        let image = new_image()
+            .into_rendered_image(options)
+            .expect("Rendering failed");
+        assert_eq!(image.data16().unwrap()[11], data[7 * 64 + 9]);
+
+        // Uncropped, the raw data is the image itself.
+        let rawimage = new_image();
+        let ptr = rawimage.data16().unwrap().as_ptr();
+        let image = rawimage
+            .into_rendered_image(RenderingOptions::default().with_stage(RenderingStage::Raw))
+            .expect("Rendering failed");
+        assert_eq!(image.data16().unwrap().as_ptr(), ptr);
+        assert!(image.active_area().is_some());
+
+        // The linearization is in place, like the rendering.
+        for precision in [RenderingPrecision::Single, RenderingPrecision::Double] {
+            for crop in [RenderingCrop::None, RenderingCrop::ActiveArea] {
+                let options = RenderingOptions::default()
+                    .with_stage(RenderingStage::Linearization)
+                    .with_precision(precision)
+                    .with_crop(crop);
+                let expected = new_image()
+                    .rendered_image(options.clone())
+                    .expect("Rendering failed");
+                let rawimage = new_image();
+                let ptr = rawimage.data16().unwrap().as_ptr();
+                let image = rawimage
+                    .into_rendered_image(options)
+                    .expect("Rendering failed");
+                assert_eq!(image.data_type(), DataType::PixmapRgb16);
+                assert_eq!(image.whites(), expected.whites());
+                assert_eq!(image.mosaic_pattern(), expected.mosaic_pattern());
+                assert_eq!(image.data16(), expected.data16());
+                if crop == RenderingCrop::None {
+                    assert_eq!(image.data16().unwrap().as_ptr(), ptr);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn test_render_levels() {
+        // Distinct blacks per CFA position, like the Nikon and Sony
+        // maker note black levels.
+        let blacks = [600, 512, 514, 1024];
+        let whites = blacks.map(|b| b + 3000);
+        let data = (0..32 * 24)
+            .map(|i| blacks[(i / 32 % 2) * 2 + i % 32 % 2] + 1000)
+            .collect();
+        let mut rawimage = RawImage::with_data16(32, 24, 14, DataType::Raw, data, Pattern::Rggb);
+        rawimage.set_blacks(blacks);
+        rawimage.set_whites(whites);
+        rawimage.set_active_area(Some(Rect {
+            x: 3,
+            y: 1,
+            width: 20,
+            height: 16,
+        }));
+        let expected = (65535.0_f64 / 3.0).round() as u16;
+
+        let options = RenderingOptions::default().with_stage(RenderingStage::Linearization);
+        for options in [
+            options.clone(),
+            options.with_crop(RenderingCrop::ActiveArea),
+        ] {
+            let image = rawimage.rendered_image(options).expect("Rendering failed");
+            assert!(image.data16().unwrap().iter().all(|v| *v == expected));
+        }
+        // The levels follow the CFA position when cropping.
+        let cropped = rawimage
+            .cropped(&Rect {
+                x: 1,
+                y: 1,
+                width: 8,
+                height: 8,
+            })
+            .expect("Crop failed");
+        assert_eq!(cropped.blacks(), &[1024, 514, 512, 600]);
+        assert_eq!(cropped.mosaic_pattern(), &Pattern::Bggr);
+
+        let image = rawimage
+            .rendered_image(
+                RenderingOptions::default()
+                    .with_stage(RenderingStage::Interpolation)
+                    .with_scale(RenderingScale::Half),
+            )
+            .expect("Rendering failed");
+        assert!(image.data16().unwrap().iter().all(|v| *v == expected));
+
+        check_fused::<f32>(&rawimage);
+        check_fused::<f64>(&rawimage);
+    }
+
+    #[test]
+    fn test_render_white_balance() {
+        // A flat white, as shot.
+        let neutral = [0.5, 1.0, 0.75];
+        let data = (0..32 * 24)
+            .map(|i| (2000.0 * neutral[Pattern::Rggb[(i % 32 % 2, i / 32 % 2)] as usize]) as u16)
+            .collect();
+        let mut rawimage = RawImage::with_data16(32, 24, 12, DataType::Raw, data, Pattern::Rggb);
+        rawimage.set_whites([4095; 4]);
+        rawimage.set_colour_matrix(
+            1,
+            exif::LightsourceValue::D65,
+            &[
+                0.6722, -0.0635, -0.0963, -0.4287, 1.2460, 0.2028, -0.0908, 0.2162, 0.5668,
+            ],
+        );
+        let no_wb = rawimage
+            .camera_to_target::<f64>(ColourSpace::SRgb)
+            .unwrap()
+            .unwrap();
+
+        rawimage.set_as_shot_neutral(&neutral);
+        let m = rawimage
+            .camera_to_target::<f64>(ColourSpace::SRgb)
+            .unwrap()
+            .unwrap();
+        for row in m {
+            let v: f64 = row.iter().zip(neutral.iter()).map(|(m, n)| m * n).sum();
+            assert!((v - 1.0).abs() < 1e-9, "{m:?}");
+        }
+        for precision in [RenderingPrecision::Single, RenderingPrecision::Double] {
+            let image = rawimage
+                .rendered_image(
+                    RenderingOptions::default()
+                        .with_stage(RenderingStage::Colour)
+                        .with_precision(precision),
+                )
+                .expect("Rendering failed");
+            let expected = render::SRGB_GAMMA.encode_u16(2000.0_f64 / 4095.0) as i32;
+            for v in image.data16().unwrap() {
+                assert!((*v as i32 - expected).abs() <= 1, "{v} {expected}");
+            }
+        }
+        check_fused::<f32>(&rawimage);
+
+        // D65 is the camera white: the matrix is only scaled.
+        rawimage.set_as_shot_white_xy((0.3127, 0.3290));
+        let m = rawimage
+            .camera_to_target::<f64>(ColourSpace::SRgb)
+            .unwrap()
+            .unwrap();
+        let scale = m[1][1] / no_wb[1][1];
+        for (row, no_wb) in m.iter().zip(no_wb.iter()) {
+            for (v, no_wb) in row.iter().zip(no_wb.iter()) {
+                assert!((v - no_wb * scale).abs() < 1e-3, "{m:?} {no_wb:?}");
+            }
+        }
+    }
+
+    #[test]
+    fn test_render_target() {
+        // A flat white, as shot.
+        let neutral = [0.5, 1.0, 0.75];
+        let data = (0..32 * 24)
+            .map(|i| (2000.0 * neutral[Pattern::Rggb[(i % 32 % 2, i / 32 % 2)] as usize]) as u16)
+            .collect();
+        let mut rawimage = RawImage::with_data16(32, 24, 12, DataType::Raw, data, Pattern::Rggb);
+        rawimage.set_whites([4095; 4]);
+        rawimage.set_as_shot_neutral(&neutral);
+        rawimage.set_colour_matrix(
+            1,
+            exif::LightsourceValue::D65,
+            &[
+                0.6722, -0.0635, -0.0963, -0.4287, 1.2460, 0.2028, -0.0908, 0.2162, 0.5668,
+            ],
+        );
+
+        let level = 2000.0_f64 / 4095.0;
+        let quantize = |v: f64| (v * 65535.0).round() as i32;
+        for (target, expected) in [
+            (ColourSpace::LinearSRgb, [quantize(level); 3]),
+            (ColourSpace::Rec2020, [quantize(level); 3]),
+            (
+                ColourSpace::XYZ,
+                [0.95047, 1.0, 1.08883].map(|v| quantize(v * level)),
+            ),
+            (ColourSpace::Camera, neutral.map(|v| quantize(v * level))),
+            (
+                ColourSpace::DisplayP3,
+                [render::SRGB_GAMMA.encode_u16(level) as i32; 3],
+            ),
+            (
+                ColourSpace::ProPhoto,
+                [render::PROPHOTO_GAMMA.encode_u16(level) as i32; 3],
+            ),
+        ] {
+            let options = RenderingOptions::default()
+                .with_stage(RenderingStage::Colour)
+                .with_target(target);
+            let image = rawimage
+                .rendered_image(options.clone())
+                .expect("Rendering failed");
+            for pixel in image.data16().unwrap().chunks_exact(3) {
+                for (v, e) in pixel.iter().zip(expected.iter()) {
+                    // The matrices have 4 to 7 digits.
+                    assert!(
+                        (*v as i32 - e).abs() <= 8,
+                        "{target:?} {pixel:?} {expected:?}"
+                    );
+                }
+            }
+            let staged = rawimage
+                .render_staged::<f32>(options)
+                .expect("Rendering failed");
+            assert_eq!(image.data16(), staged.data16(), "{target:?}");
+        }
+
+        assert!(rawimage
+            .rendered_image(
+                RenderingOptions::default()
+                    .with_stage(RenderingStage::Colour)
+                    .with_target(ColourSpace::Unknown)
+            )
+            .is_err());
+    }
 }
@@ -21,7 +21,17 @@
 
 //! Implement demosaic
 
+mod ppg;
+mod xtrans;
+
+pub(crate) use ppg::ppg;
+pub(crate) use xtrans::xtrans;
+
+use multiversion::multiversion;
+use rayon::prelude::*;
+
 use crate::bitmap::ImageBuffer;
+use crate::render::Sample;
 
 use crate::{
     mosaic::{Pattern, PatternType},
@@ -29,7 +39,9 @@ use crate::{
 };
 
 /// Calculate the median of 4 float.
-fn m4(mut a: f64, mut b: f64, mut c: f64, d: f64) -> f64 {
+#[cfg(any(test, feature = "bench"))]
+fn m4<T: Sample>(mut a: T, mut b: T, mut c: T, d: T) -> T {
+    let two = T::from_f64(2.0);
     /* Sort ab */
     if a > b {
         std::mem::swap(&mut a, &mut b);
@@ -48,51 +60,185 @@ fn m4(mut a: f64, mut b: f64, mut c: f64, d: f64) -> f64 {
     /* Return average of central two elements. */
     if d >= c {
         // Sorted order would be abcd
-        (b + c) / 2.0
+        (b + c) / two
     } else if d >= a {
         // Sorted order would be either abdc or adbc
-        (b + d) / 2.0
+        (b + d) / two
     } else {
         // Sorted order would be dabc
-        (a + b) / 2.0
+        (a + b) / two
     }
 }
 
-/// Bimedian demosaic for 2x2 bayer CFA. Use float 0..1.0 range.
-pub(crate) fn bimedian(
-    input: &ImageBuffer<f64>,
-    pattern: &Pattern,
-) -> crate::Result<ImageBuffer<f64>> {
-    let npattern = match pattern.pattern_type() {
-        PatternType::Bggr => 0,
-        PatternType::Grbg => 1,
-        PatternType::Gbrg => 2,
-        PatternType::Rggb => 3,
+/// The index of the 2x2 bayer `pattern` for the bimedian demosaic.
+pub(crate) fn bayer_index(pattern: &Pattern) -> crate::Result<usize> {
+    match pattern.pattern_type() {
+        PatternType::Bggr => Ok(0),
+        PatternType::Grbg => Ok(1),
+        PatternType::Gbrg => Ok(2),
+        PatternType::Rggb => Ok(3),
         _ => {
-            return {
-                log::error!("Unsupported pattern {:?}", pattern.pattern_type());
-                Err(Error::InvalidFormat)
-            }
+            log::error!("Unsupported pattern {:?}", pattern.pattern_type());
+            Err(Error::InvalidFormat)
         }
+    }
+}
+
+/// The number of rows per parallel band in `bimedian()`.
+const BAND_ROWS: usize = 16;
+
+/// Bimedian demosaic for 2x2 bayer CFA. Use float 0..1.0 range.
+pub(crate) fn bimedian<T: Sample>(
+    input: &ImageBuffer<T>,
+    pattern: &Pattern,
+) -> crate::Result<ImageBuffer<T>> {
+    let npattern = bayer_index(pattern)?;
+    if input.width < 3 || input.height < 3 {
+        log::error!("Image too small to demosaic");
+        return Err(Error::InvalidFormat);
+    }
+
+    let width = input.width as usize;
+    let out_w = input.width - 2;
+    let out_h = input.height - 2;
+    // The output is smaller to have a consistent size.
+    // Notably, the `image` crate doesn't like it.
+    let mut dst: Vec<T> = uninit_vec!(3 * out_w as usize * out_h as usize);
+    dst.par_chunks_mut(BAND_ROWS * out_w as usize * 3)
+        .enumerate()
+        .for_each(|(band, dst)| {
+            let y = band * BAND_ROWS;
+            bimedian_rows(&input.data[y * width..], width, y + 1, npattern, dst);
+        });
+
+    Ok(ImageBuffer::with_data(dst, out_w, out_h, input.bpc, 3))
+}
+
+/// Median of 4, averaging the two central values. Branchless
+/// equivalent of `m4()`: the central values are the larger of the
+/// minimums and the smaller of the maximums of each pair.
+#[inline(always)]
+fn m4_minmax<T: Sample>(a: T, b: T, c: T, d: T) -> T {
+    (a.min(b).max(c.min(d)) + a.max(b).min(c.max(d))) / T::from_f64(2.0)
+}
+
+/// Interpolate the pixel at `offset` in `src`. `R` is the row kind,
+/// 0 for blue rows and 1 for red rows, and `C` the column kind, 1
+/// for the green pixels.
+#[inline(always)]
+fn bimedian_pixel<T: Sample, const R: usize, const C: usize>(
+    src: &[T],
+    offset: usize,
+    drow: usize,
+) -> [T; 3] {
+    let two = T::from_f64(2.0);
+    let cross = || {
+        m4_minmax(
+            src[offset - drow],
+            src[offset - 1],
+            src[offset + 1],
+            src[offset + drow],
+        )
     };
+    let diag = || {
+        m4_minmax(
+            src[offset - drow - 1],
+            src[offset - drow + 1],
+            src[offset + drow - 1],
+            src[offset + drow + 1],
+        )
+    };
+    let horiz = || (src[offset - 1] + src[offset + 1]) / two;
+    let vert = || (src[offset - drow] + src[offset + drow]) / two;
+    match (R, C) {
+        // GRG / BGB / GRG
+        (0, 1) => [vert(), src[offset], horiz()],
+        // RGR / GBG / RGR
+        (0, _) => [diag(), cross(), src[offset]],
+        // BGB / GRG / BGB
+        (_, 1) => [src[offset], cross(), diag()],
+        // GBG / RGR / GBG
+        _ => [horiz(), src[offset], vert()],
+    }
+}
 
-    let mut dst: Vec<f64> = vec![0.0; input.width as usize * input.height as usize * 3];
+/// Demosaic one row, two pixels at a time. `C0` is the column kind
+/// of the first pixel, `C1` of the second.
+#[inline(always)]
+fn bimedian_row<T: Sample, const R: usize, const C0: usize, const C1: usize>(
+    src: &[T],
+    offset: usize,
+    drow: usize,
+    dst: &mut [T],
+) {
+    let mut quads = dst.chunks_exact_mut(6);
+    let mut offset = offset;
+    for quad in quads.by_ref() {
+        quad[0..3].copy_from_slice(&bimedian_pixel::<T, R, C0>(src, offset, drow));
+        quad[3..6].copy_from_slice(&bimedian_pixel::<T, R, C1>(src, offset + 1, drow));
+        offset += 2;
+    }
+    let tail = quads.into_remainder();
+    if !tail.is_empty() {
+        tail.copy_from_slice(&bimedian_pixel::<T, R, C0>(src, offset, drow));
+    }
+}
 
-    #[allow(non_snake_case)]
+/// Bimedian demosaic of a band of rows. `src` contains the input rows
+/// `width` wide, starting with the row above the first output row
+/// `y`. `y` is in input coordinates, it is used to locate the CFA
+/// pattern. `dst` receives RGB rows `width - 2` wide, and the number
+/// of rows is deduced from its length.
+///
+/// The CFA colours are resolved once per row, and the pixels are
+/// processed in pairs.
+#[multiversion(targets("x86_64+avx+avx2", "x86_64+ssse3", "aarch64+neon"))]
+pub(crate) fn bimedian_rows<T: Sample>(
+    src: &[T],
+    width: usize,
+    y: usize,
+    npattern: usize,
+    dst: &mut [T],
+) {
+    for (row, drow) in dst.chunks_exact_mut((width - 2) * 3).enumerate() {
+        let row_kind = (y + row + npattern % 2) % 2;
+        // The first pixel is on column 1.
+        let col_kind = (1 + npattern / 2) % 2;
+        let offset = (row + 1) * width + 1;
+        match (row_kind, col_kind) {
+            (0, 0) => bimedian_row::<T, 0, 0, 1>(src, offset, width, drow),
+            (0, _) => bimedian_row::<T, 0, 1, 0>(src, offset, width, drow),
+            (_, 0) => bimedian_row::<T, 1, 0, 1>(src, offset, width, drow),
+            _ => bimedian_row::<T, 1, 1, 0>(src, offset, width, drow),
+        }
+    }
+}
+
+/// Scalar bimedian demosaic, resolving the CFA colour for each
+/// pixel. This is the reference for `bimedian_rows()`.
+#[cfg(any(test, feature = "bench"))]
+fn bimedian_rows_reference<T: Sample>(
+    src: &[T],
+    width: usize,
+    y: usize,
+    npattern: usize,
+    dst: &mut [T],
+) {
     // Offset to get the same column on next row (or previous if negative)
-    let DROW: usize = input.width as usize;
+    #[allow(non_snake_case)]
+    let DROW: usize = width;
     // Offset to et the next or previous column
     const DCOL: usize = 1;
-    // We start on column one of row one (0 based)
-    let mut offset = DROW + DCOL;
-    let mut doffset = 0;
-    let src = &input.data;
+    let two = T::from_f64(2.0);
 
-    for y in 1..input.height - 1 {
-        for x in 1..input.width - 1 {
-            let red: f64;
-            let green: f64;
-            let blue: f64;
+    for (row, drow) in dst.chunks_exact_mut((width - 2) * 3).enumerate() {
+        let y = y + row;
+        // We start on column one of the row.
+        let mut offset = (row + 1) * DROW + DCOL;
+        for (x, rgb) in (1..width - 1).zip(drow.chunks_exact_mut(3)) {
+            let red: T;
+            let green: T;
+            let blue: T;
 
             if (y + npattern % 2) % 2 == 0 {
                 if (x + npattern / 2) % 2 == 1 {
@@ -100,9 +246,9 @@ pub(crate) fn bimedian(
                      * BGB
                      * GRG
                      */
-                    blue = (src[offset - DCOL] + src[offset + DCOL]) / 2.0;
+                    blue = (src[offset - DCOL] + src[offset + DCOL]) / two;
                     green = src[offset];
-                    red = (src[offset - DROW] + src[offset + DROW]) / 2.0;
+                    red = (src[offset - DROW] + src[offset + DROW]) / two;
                 } else {
                     /* RGR
                      * GBG
@@ -145,29 +291,51 @@ pub(crate) fn bimedian(
                  * RGR
                  * GBG
                  */
-                blue = (src[offset - DROW] + src[offset + DROW]) / 2.0;
+                blue = (src[offset - DROW] + src[offset + DROW]) / two;
                 green = src[offset];
-                red = (src[offset - DCOL] + src[offset + DCOL]) / 2.0;
+                red = (src[offset - DCOL] + src[offset + DCOL]) / two;
             }
 
-            dst[doffset * 3] = red;
-            dst[doffset * 3 + 1] = green;
-            dst[doffset * 3 + 2] = blue;
+            rgb[0] = red;
+            rgb[1] = green;
+            rgb[2] = blue;
 
             offset += 1;
-            doffset += 1;
         }
-        // We must skip 2 each row.
-        offset += 2;
     }
-    let out_w = input.width - 2;
-    let out_h = input.height - 2;
-    // This is necessary to have a consistent size with the output.
-    // Notably, the `image` crate doesn't like it.
-    // The assumption is that the resize should shrink the buffer.
-    dst.resize((3 * out_w * out_h) as usize, 0.0);
+}
 
-    Ok(ImageBuffer::with_data(dst, out_w, out_h, input.bpc, 3))
+#[cfg(feature = "bench")]
+/// Entry points for the demosaic benchmarks.
+pub mod bench {
+    use crate::bitmap::ImageBuffer;
+    use crate::mosaic::Pattern;
+
+    /// Bimedian demosaic of a RGGB `width` x `height` CFA.
+    pub fn bimedian(src: Vec<f32>, width: u32, height: u32) -> Vec<f32> {
+        let input = ImageBuffer::with_data(src, width, height, 16, 1);
+        super::bimedian(&input, &Pattern::Rggb)
+            .map(|output| output.data)
+            .unwrap_or_default()
+    }
+
+    /// Scalar reference bimedian demosaic of a RGGB `width` x `height` CFA.
+    pub fn bimedian_reference(src: Vec<f32>, width: u32, height: u32) -> Vec<f32> {
+        if width < 3 || height < 3 {
+            return vec![];
+        }
+        let mut dst = vec![0.0; 3 * (width as usize - 2) * (height as usize - 2)];
+        super::bimedian_rows_reference(&src, width as usize, 1, 3, &mut dst);
+        dst
+    }
+
+    /// PPG demosaic of a RGGB `width` x `height` CFA.
+    pub fn ppg(src: Vec<f32>, width: u32, height: u32) -> Vec<f32> {
+        let input = ImageBuffer::with_data(src, width, height, 16, 1);
+        super::ppg(&input, &Pattern::Rggb)
+            .map(|output| output.data)
+            .unwrap_or_default()
+    }
 }
 
 #[cfg(test)]
@@ -175,7 +343,7 @@ mod test {
     use crate::bitmap::ImageBuffer;
     use crate::mosaic::Pattern;
 
-    use super::bimedian;
+    use super::{bimedian, bimedian_rows_reference, m4, m4_minmax};
 
     /// Demosaic. `result is the value of the pixel at 1,1.
     fn test_demosaic(buffer: Vec<f64>, pattern: &Pattern, result: Vec<f64>) {
@@ -196,6 +364,21 @@ mod test {
         );
     }
 
+    /// Demosaic in f32 and f64. The results must match.
+    fn test_demosaic_f32(buffer: Vec<f64>, pattern: &Pattern) {
+        let buffer32: Vec<f32> = buffer.iter().map(|v| *v as f32).collect();
+        let image = ImageBuffer::with_data(buffer, 8, 8, 16, 1);
+        let image32 = ImageBuffer::with_data(buffer32, 8, 8, 16, 1);
+        let output = bimedian(&image, pattern).expect("f64 demosaic failed");
+        let output32 = bimedian(&image32, pattern).expect("f32 demosaic failed");
+        assert_eq!(output.data.len(), output32.data.len());
+        output
+            .data
+            .iter()
+            .zip(output32.data.iter())
+            .for_each(|(v, v32)| assert_eq!(*v as f32, *v32));
+    }
+
     #[test]
     fn test_demosaic_xggx() {
         #[rustfmt::skip]
@@ -211,6 +394,7 @@ mod test {
         ];
 
         test_demosaic(buffer.clone(), &Pattern::Rggb, vec![0.0_f64, 1.0, 0.0]);
+        test_demosaic_f32(buffer.clone(), &Pattern::Rggb);
         test_demosaic(buffer, &Pattern::Bggr, vec![0.0_f64, 1.0, 0.0]);
     }
 
@@ -229,6 +413,52 @@ mod test {
         ];
 
         test_demosaic(buffer.clone(), &Pattern::Gbrg, vec![0.0_f64, 0.0, 1.0]);
+        test_demosaic_f32(buffer.clone(), &Pattern::Gbrg);
         test_demosaic(buffer, &Pattern::Grbg, vec![1.0_f64, 0.0, 0.0]);
     }
+
+    #[test]
+    fn test_m4() {
+        let values = [0.0_f32, 0.25, 0.5, 1.0, 0.5];
+        for a in values {
+            for b in values {
+                for c in values {
+                    for d in values {
+                        assert_eq!(m4(a, b, c, d), m4_minmax(a, b, c, d));
+                    }
+                }
+            }
+        }
+    }
+
+    /// Compare with the reference implementation.
+    fn check_reference<T: crate::render::Sample>(width: u32, height: u32) {
+        let mut seed = 0x1234_5678_u32;
+        let data: Vec<T> = (0..width * height)
+            .map(|_| {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                T::from_f64((seed % 4096) as f64 / 4095.0)
+            })
+            .collect();
+        let image = ImageBuffer::with_data(data, width, height, 16, 1);
+        for (npattern, pattern) in [Pattern::Bggr, Pattern::Grbg, Pattern::Gbrg, Pattern::Rggb]
+            .iter()
+            .enumerate()
+        {
+            let output = bimedian(&image, pattern).expect("Demosaic failed");
+            let mut expected = vec![T::zero(); output.data.len()];
+            bimedian_rows_reference(&image.data, width as usize, 1, npattern, &mut expected);
+            assert_eq!(output.data, expected, "{pattern:?} {width}x{height}");
+        }
+    }
+
+    #[test]
+    fn test_demosaic_reference() {
+        check_reference::<f32>(64, 48);
+        check_reference::<f32>(37, 41);
+        check_reference::<f64>(100, 35);
+        check_reference::<f64>(3, 3);
+    }
 }
@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * libopenraw - render/demosaic/ppg.rs
+ *
+ * Copyright (C) 2025 Hubert Figuière
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+//! Patterned Pixel Grouping (PPG) demosaic.
+//!
+//! Edge directed: green is interpolated along the direction of the
+//! smallest gradient, then red and blue are interpolated from the
+//! colour differences with green. Algorithm by Chuan-kai Lin, as
+//! implemented in dcraw.
+
+use rayon::prelude::*;
+
+use crate::bitmap::ImageBuffer;
+use crate::mosaic::{Pattern, PatternColour};
+use crate::render::Sample;
+use crate::{Error, Result};
+
+const GREEN: usize = PatternColour::Green as usize;
+
+/// Colour index in the RGB triplet of the 2x2 `pattern`, indexed
+/// `[y % 2][x % 2]`.
+fn colours(pattern: &Pattern) -> [[usize; 2]; 2] {
+    std::array::from_fn(|y| std::array::from_fn(|x| pattern[(x, y)] as usize))
+}
+
+#[inline]
+fn clip<T: Sample>(value: T) -> T {
+    value.max(T::zero()).min(T::one())
+}
+
+/// Interpolate green at the non green pixel at `o`, choosing the
+/// horizontal or vertical direction with the smallest gradient. Need
+/// 3 pixels around.
+#[inline]
+fn green_at<T: Sample>(src: &[T], o: usize, width: usize) -> T {
+    let two = T::from_f64(2.0);
+    let three = T::from_f64(3.0);
+    let c = src[o];
+    let mut guess = [T::zero(); 2];
+    let mut diff = [T::zero(); 2];
+    for (i, d) in [1, width].into_iter().enumerate() {
+        guess[i] = (src[o - d] + c + src[o + d]) * two - src[o - 2 * d] - src[o + 2 * d];
+        diff[i] = ((src[o - 2 * d] - c).abs()
+            + (src[o + 2 * d] - c).abs()
+            + (src[o - d] - src[o + d]).abs())
+            * three
+            + ((src[o + 3 * d] - src[o + d]).abs() + (src[o - 3 * d] - src[o - d]).abs()) * two;
+    }
+    let i = (diff[0] > diff[1]) as usize;
+    let d = [1, width][i];
+    let lo = src[o - d].min(src[o + d]);
+    let hi = src[o - d].max(src[o + d]);
+    (guess[i] / T::from_f64(4.0)).max(lo).min(hi)
+}
+
+/// Interpolate green at the non green pixel `x`, `y` near the border
+/// from the neighbours that are in the image.
+fn border_green_at<T: Sample>(src: &[T], x: usize, y: usize, width: usize, height: usize) -> T {
+    let o = y * width + x;
+    let mut sum = T::zero();
+    let mut count = 0;
+    let mut add = |cond: bool, offset: usize| {
+        if cond {
+            sum = sum + src[offset];
+            count += 1;
+        }
+    };
+    add(x > 0, o.wrapping_sub(1));
+    add(x + 1 < width, o + 1);
+    add(y > 0, o.wrapping_sub(width));
+    add(y + 1 < height, o + width);
+    sum / T::from_f64(count as f64)
+}
+
+/// PPG demosaic for 2x2 bayer CFA. Use float 0..1.0 range.
+///
+/// Like `bimedian()` the output doesn't have the 1 pixel border.
+pub(crate) fn ppg<T: Sample>(input: &ImageBuffer<T>, pattern: &Pattern) -> Result<ImageBuffer<T>> {
+    super::bayer_index(pattern)?;
+    if input.width < 3 || input.height < 3 {
+        log::error!("Image too small to demosaic");
+        return Err(Error::InvalidFormat);
+    }
+    let width = input.width as usize;
+    let height = input.height as usize;
+    let colours = colours(pattern);
+    let src = &input.data;
+
+    // Fill the green plane.
+    let mut green: Vec<T> = uninit_vec!(width * height);
+    green
+        .par_chunks_mut(width)
+        .enumerate()
+        .for_each(|(y, row)| {
+            let inner = y >= 3 && y + 3 < height;
+            for (x, g) in row.iter_mut().enumerate() {
+                let o = y * width + x;
+                *g = if colours[y % 2][x % 2] == GREEN {
+                    src[o]
+                } else if inner && x >= 3 && x + 3 < width {
+                    green_at(src, o, width)
+                } else {
+                    border_green_at(src, x, y, width, height)
+                };
+            }
+        });
+
+    // Red and blue from the colour differences.
+    let out_w = width - 2;
+    let out_h = height - 2;
+    let two = T::from_f64(2.0);
+    let four = T::from_f64(4.0);
+    let mut dst: Vec<T> = uninit_vec!(out_w * out_h * 3);
+    dst.par_chunks_mut(out_w * 3)
+        .enumerate()
+        .for_each(|(row, drow)| {
+            let y = row + 1;
+            for (x, rgb) in (1..width - 1).zip(drow.chunks_exact_mut(3)) {
+                let o = y * width + x;
+                let c = colours[y % 2][x % 2];
+                let g = green[o];
+                rgb[GREEN] = g;
+                if c == GREEN {
+                    let ch = colours[y % 2][(x + 1) % 2];
+                    rgb[ch] = clip(
+                        (src[o - 1] + src[o + 1] + two * g - green[o - 1] - green[o + 1]) / two,
+                    );
+                    rgb[2 - ch] = clip(
+                        (src[o - width] + src[o + width] + two * g
+                            - green[o - width]
+                            - green[o + width])
+                            / two,
+                    );
+                } else {
+                    rgb[c] = src[o];
+                    let mut guess = [T::zero(); 2];
+                    let mut diff = [T::zero(); 2];
+                    for (i, d) in [width + 1, width - 1].into_iter().enumerate() {
+                        diff[i] = (src[o - d] - src[o + d]).abs()
+                            + (green[o - d] - g).abs()
+                            + (green[o + d] - g).abs();
+                        guess[i] = src[o - d] + src[o + d] + two * g - green[o - d] - green[o + d];
+                    }
+                    rgb[2 - c] = clip(if diff[0] != diff[1] {
+                        guess[(diff[0] > diff[1]) as usize] / two
+                    } else {
+                        (guess[0] + guess[1]) / four
+                    });
+                }
+            }
+        });
+
+    Ok(ImageBuffer::with_data(
+        dst,
+        out_w as u32,
+        out_h as u32,
+        input.bpc,
+        3,
+    ))
+}
+
+#[cfg(test)]
+mod test {
+    use crate::bitmap::ImageBuffer;
+    use crate::mosaic::Pattern;
+
+    use super::ppg;
+    use crate::render::demosaic::bimedian;
+
+    #[test]
+    fn test_ppg_flat() {
+        // A flat grey must stay flat.
+        let image = ImageBuffer::with_data(vec![0.5_f32; 16 * 12], 16, 12, 16, 1);
+        for pattern in [Pattern::Rggb, Pattern::Bggr, Pattern::Grbg, Pattern::Gbrg] {
+            let output = ppg(&image, &pattern).expect("Demosaic failed");
+            assert_eq!(output.width, 14);
+            assert_eq!(output.height, 10);
+            assert_eq!(output.cc, 3);
+            assert!(output.data.iter().all(|v| *v == 0.5), "{pattern:?}");
+        }
+
+        let image = ImageBuffer::with_data(vec![0.5_f32; 4], 2, 2, 16, 1);
+        assert!(ppg(&image, &Pattern::Rggb).is_err());
+        let image = ImageBuffer::with_data(vec![0.5_f32; 36], 6, 6, 16, 1);
+        assert!(ppg(&image, &Pattern::Empty).is_err());
+    }
+
+    #[test]
+    fn test_ppg_colour() {
+        // A flat colour field, mosaiced.
+        let pattern = Pattern::Rggb;
+        let colour = [0.8_f64, 0.4, 0.2];
+        let data = (0..20 * 20)
+            .map(|i| colour[pattern[(i % 20 % 2, i / 20 % 2)] as usize])
+            .collect();
+        let image = ImageBuffer::with_data(data, 20, 20, 16, 1);
+        let output = ppg(&image, &pattern).expect("Demosaic failed");
+        for pixel in output.data.chunks_exact(3) {
+            for (v, c) in pixel.iter().zip(colour.iter()) {
+                assert!((v - c).abs() < 1e-12, "{pixel:?}");
+            }
+        }
+    }
+
+    /// Synthetic test chart, `width` x `height` RGB: a zone plate with
+    /// sharp diagonal edges. With `correlated` the three channels follow
+    /// the same luminance, like in natural images, otherwise they are
+    /// unrelated.
+    fn zone_plate(width: usize, height: usize, correlated: bool) -> Vec<[f64; 3]> {
+        let (cx, cy) = (width as f64 / 2.0, height as f64 / 2.0);
+        (0..width * height)
+            .map(|i| {
+                let x = (i % width) as f64;
+                let y = (i / width) as f64;
+                let r2 = (x - cx).powi(2) + (y - cy).powi(2);
+                let zone = 0.5 + 0.4 * (r2 / 3000.0).sin();
+                let edge = if (x + y * 0.3) as usize / 97 % 2 == 0 {
+                    0.2
+                } else {
+                    0.0
+                };
+                if correlated {
+                    [
+                        (zone * 0.9 + edge).min(1.0),
+                        zone * 0.7 + edge * 0.5,
+                        zone * 0.5 + edge * 0.3,
+                    ]
+                } else {
+                    [
+                        (zone * 0.9 + edge).min(1.0),
+                        0.5 + 0.4 * (x / 7.0).sin() * (y / 11.0).cos(),
+                        (0.3 + 0.3 * (x / 50.0).cos() * zone).max(0.0),
+                    ]
+                }
+            })
+            .collect()
+    }
+
+    /// PSNR of the demosaiced `output` against `chart`, leaving out a
+    /// border of 4 pixels. `output` lost one pixel on each side.
+    fn psnr(output: &ImageBuffer<f64>, chart: &[[f64; 3]], width: usize, height: usize) -> f64 {
+        let mut error = 0.0;
+        let mut count = 0;
+        for y in 4..height - 4 {
+            for x in 4..width - 4 {
+                let o = ((y - 1) * (width - 2) + x - 1) * 3;
+                for (c, expected) in chart[y * width + x].iter().enumerate() {
+                    error += (output.data[o + c] - expected).powi(2);
+                    count += 1;
+                }
+            }
+        }
+        10.0 * (count as f64 / error).log10()
+    }
+
+    #[test]
+    fn test_ppg_quality() {
+        // The PSNR figures of doc/benchmarks.md. Run with `--nocapture`
+        // to print them.
+        let (width, height) = (1536, 1024);
+        let pattern = Pattern::Rggb;
+        for (correlated, bimedian_min, ppg_min) in [(true, 40.0, 44.0), (false, 41.0, 39.0)] {
+            let chart = zone_plate(width, height, correlated);
+            let data = chart
+                .iter()
+                .enumerate()
+                .map(|(i, rgb)| rgb[pattern[(i % width % 2, i / width % 2)] as usize])
+                .collect();
+            let image = ImageBuffer::with_data(data, width as u32, height as u32, 16, 1);
+
+            let output = bimedian(&image, &pattern).expect("Demosaic failed");
+            let bimedian_psnr = psnr(&output, &chart, width, height);
+            let output = ppg(&image, &pattern).expect("Demosaic failed");
+            let ppg_psnr = psnr(&output, &chart, width, height);
+            println!(
+                "correlated {correlated}: bimedian {bimedian_psnr:.1} dB, PPG {ppg_psnr:.1} dB"
+            );
+            assert!(bimedian_psnr > bimedian_min, "{bimedian_psnr}");
+            assert!(ppg_psnr > ppg_min, "{ppg_psnr}");
+        }
+    }
+}
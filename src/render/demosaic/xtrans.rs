@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * libopenraw - render/demosaic/xtrans.rs
+ *
+ * Copyright (C) 2025 Hubert Figuière
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+//! Demosaic for non 2x2 CFA, like Fujifilm X-Trans.
+//!
+//! Each missing colour is the weighted average of the pixels of that
+//! colour in the 3x3 neighbourhood, the direct neighbours weighing
+//! twice the diagonal ones. Like `lin_interpolate()` in dcraw.
+
+use rayon::prelude::*;
+
+use crate::bitmap::ImageBuffer;
+use crate::mosaic::{Pattern, PatternColour};
+use crate::render::Sample;
+use crate::{Error, Result};
+
+/// The number of rows per parallel band.
+const BAND_ROWS: usize = 16;
+
+/// The interpolation kernel for one position of the pattern.
+struct Kernel<T> {
+    /// The colour of the pixel.
+    colour: usize,
+    /// Offset in the image, colour and normalized weight of the
+    /// neighbours.
+    taps: Vec<(isize, usize, T)>,
+}
+
+/// Build the kernels for each position of `pattern`, indexed
+/// `y * pattern.width() + x`, for an image `width` wide.
+fn kernels<T: Sample>(pattern: &Pattern, width: usize) -> Result<Vec<Kernel<T>>> {
+    let pw = pattern.width();
+    let ph = pattern.height();
+    if pw == 0 || pattern.pattern().len() != pw * ph {
+        log::error!("Invalid pattern {pattern:?}");
+        return Err(Error::InvalidFormat);
+    }
+    let colour_at = |x: usize, y: usize| -> Result<usize> {
+        match pattern[(x % pw, y % ph)] {
+            PatternColour::Unknown => {
+                log::error!("Unknown colour in pattern at {x}, {y}");
+                Err(Error::InvalidFormat)
+            }
+            c => Ok(c as usize),
+        }
+    };
+
+    let mut kernels = Vec::with_capacity(pw * ph);
+    for y in 0..ph {
+        for x in 0..pw {
+            // Offset by a whole pattern to stay positive.
+            let colour = colour_at(x + pw, y + ph)?;
+            let mut taps = vec![];
+            let mut sums = [0_u32; 3];
+            for dy in -1_isize..=1 {
+                for dx in -1_isize..=1 {
+                    if dx == 0 && dy == 0 {
+                        continue;
+                    }
+                    let c = colour_at(
+                        ((x + pw) as isize + dx) as usize,
+                        ((y + ph) as isize + dy) as usize,
+                    )?;
+                    let weight = if dx == 0 || dy == 0 { 2 } else { 1 };
+                    if c != colour {
+                        sums[c] += weight;
+                        taps.push((dy * width as isize + dx, c, weight));
+                    }
+                }
+            }
+            if let Some(c) = (0..3).find(|c| *c != colour && sums[*c] == 0) {
+                log::error!("No colour {c} around {x}, {y} in pattern {pattern:?}");
+                return Err(Error::InvalidFormat);
+            }
+            let taps = taps
+                .into_iter()
+                .map(|(offset, c, weight)| (offset, c, T::from_f64(weight as f64 / sums[c] as f64)))
+                .collect();
+            kernels.push(Kernel { colour, taps });
+        }
+    }
+
+    Ok(kernels)
+}
+
+/// Demosaic a non 2x2 CFA `pattern`, like X-Trans. Use float 0..1.0
+/// range. Every colour must appear in the 3x3 neighbourhood of each
+/// pixel.
+///
+/// Like `bimedian()` the output doesn't have the 1 pixel border.
+pub(crate) fn xtrans<T: Sample>(
+    input: &ImageBuffer<T>,
+    pattern: &Pattern,
+) -> Result<ImageBuffer<T>> {
+    if input.width < 3 || input.height < 3 {
+        log::error!("Image too small to demosaic");
+        return Err(Error::InvalidFormat);
+    }
+    let width = input.width as usize;
+    let kernels = kernels::<T>(pattern, width)?;
+    let pw = pattern.width();
+    let ph = pattern.height();
+    let src = &input.data;
+
+    let out_w = width - 2;
+    let out_h = input.height as usize - 2;
+    let mut dst: Vec<T> = uninit_vec!(out_w * out_h * 3);
+    dst.par_chunks_mut(BAND_ROWS * out_w * 3)
+        .enumerate()
+        .for_each(|(band, dst)| {
+            for (row, drow) in dst.chunks_exact_mut(out_w * 3).enumerate() {
+                let y = band * BAND_ROWS + row + 1;
+                let row_kernels = &kernels[(y % ph) * pw..(y % ph + 1) * pw];
+                for (x, rgb) in (1..width - 1).zip(drow.chunks_exact_mut(3)) {
+                    let o = y * width + x;
+                    let kernel = &row_kernels[x % pw];
+                    let mut value = [T::zero(); 3];
+                    value[kernel.colour] = src[o];
+                    for (offset, c, weight) in &kernel.taps {
+                        value[*c] = value[*c] + src[(o as isize + offset) as usize] * *weight;
+                    }
+                    rgb.copy_from_slice(&value);
+                }
+            }
+        });
+
+    Ok(ImageBuffer::with_data(
+        dst,
+        out_w as u32,
+        out_h as u32,
+        input.bpc,
+        3,
+    ))
+}
+
+#[cfg(test)]
+mod test {
+    use crate::bitmap::ImageBuffer;
+    use crate::mosaic::Pattern;
+    use crate::mosaic::PatternColour::{self, *};
+
+    use super::xtrans;
+
+    /// The X-Trans pattern of the X-T2.
+    const XTRANS: [PatternColour; 36] = [
+        Green, Green, Red, Green, Green, Blue, //
+        Green, Green, Blue, Green, Green, Red, //
+        Blue, Red, Green, Red, Blue, Green, //
+        Green, Green, Blue, Green, Green, Red, //
+        Green, Green, Red, Green, Green, Blue, //
+        Red, Blue, Green, Blue, Red, Green,
+    ];
+
+    #[test]
+    fn test_xtrans_colour() {
+        // A flat colour field, mosaiced.
+        let pattern = Pattern::NonRgb22(XTRANS.to_vec());
+        let colour = [0.8_f64, 0.4, 0.2];
+        let (width, height) = (40, 37);
+        let data = (0..width * height)
+            .map(|i| colour[pattern[(i % width % 6, i / width % 6)] as usize])
+            .collect();
+        let image = ImageBuffer::with_data(data, width as u32, height as u32, 16, 1);
+        let output = xtrans(&image, &pattern).expect("Demosaic failed");
+        assert_eq!(output.width, width as u32 - 2);
+        assert_eq!(output.height, height as u32 - 2);
+        assert_eq!(output.cc, 3);
+        for pixel in output.data.chunks_exact(3) {
+            for (v, c) in pixel.iter().zip(colour.iter()) {
+                assert!((v - c).abs() < 1e-12, "{pixel:?}");
+            }
+        }
+
+        // The 2x2 patterns works too.
+        let image = ImageBuffer::with_data(vec![0.5_f32; 36], 6, 6, 16, 1);
+        let output = xtrans(&image, &Pattern::Gbrg).expect("Demosaic failed");
+        assert!(output.data.iter().all(|v| *v == 0.5));
+    }
+
+    #[test]
+    fn test_xtrans_invalid() {
+        let image = ImageBuffer::with_data(vec![0.5_f32; 36], 6, 6, 16, 1);
+        assert!(xtrans(&image, &Pattern::Empty).is_err());
+        // No blue around the top left pixel.
+        let mut pattern = XTRANS.to_vec();
+        pattern[5] = Green;
+        pattern[31] = Green;
+        assert!(xtrans(&image, &Pattern::NonRgb22(pattern)).is_err());
+        // Wrong size.
+        assert!(xtrans(&image, &Pattern::NonRgb22(XTRANS[..9].to_vec())).is_err());
+
+        let image = ImageBuffer::with_data(vec![0.5_f32; 4], 2, 2, 16, 1);
+        assert!(xtrans(&image, &Pattern::NonRgb22(XTRANS.to_vec())).is_err());
+    }
+}
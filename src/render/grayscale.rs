@@ -20,12 +20,13 @@
  */
 
 use crate::bitmap::ImageBuffer;
+use crate::render::Sample;
 use crate::{Error, Result};
 
 /// Convert a grayscale buffer to RGB
 ///
 /// It's done naively.
-pub(crate) fn to_rgb(buffer: &ImageBuffer<f64>) -> Result<ImageBuffer<f64>> {
+pub(crate) fn to_rgb<T: Sample>(buffer: &ImageBuffer<T>) -> Result<ImageBuffer<T>> {
     if buffer.cc != 1 {
         return Err(Error::InvalidFormat);
     }
@@ -36,7 +37,7 @@ pub(crate) fn to_rgb(buffer: &ImageBuffer<f64>) -> Result<ImageBuffer<f64>> {
         .data
         .iter()
         .flat_map(|v| [*v, *v, *v])
-        .collect::<Vec<f64>>();
+        .collect::<Vec<T>>();
 
     Ok(ImageBuffer::with_data(out, width, height, buffer.bpc, 3))
 }
@@ -0,0 +1,486 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * libopenraw - render/pipeline.rs
+ *
+ * Copyright (C) 2025 Hubert Figuière
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+//! Fused rendering pipeline.
+//!
+//! Linearization, demosaic, colour correction, gamma and quantization
+//! run back to back on bands of rows sized to stay in cache, instead
+//! of each making a pass over the whole image. The bands are rendered
+//! in parallel and only the output buffer is allocated full size.
+
+use rayon::prelude::*;
+
+use super::demosaic::bimedian_rows;
+use super::{
+    colour_transform, encode_rgb, encode_row, GammaLut, Linearizer, OutputLayout, OutputSample,
+    Sample,
+};
+use crate::{Error, Result};
+
+/// The target size of the working set of a band, in bytes.
+const BAND_BYTES: usize = 256 * 1024;
+
+/// The number of rows in a band for an image `width` wide with
+/// `pixel_bytes` of working set per pixel.
+fn band_rows(width: usize, pixel_bytes: usize) -> usize {
+    std::cmp::max(4, BAND_BYTES / std::cmp::max(1, width * pixel_bytes))
+}
+
+/// The colour of each position of a 2x2 quad, in row order, by bayer
+/// pattern index. See `demosaic::bayer_index()`
+const QUAD_COLOURS: [[usize; 4]; 4] = [[2, 1, 1, 0], [1, 0, 2, 1], [1, 2, 0, 1], [0, 1, 1, 2]];
+
+/// Check that `out` can hold `layout`.
+fn check_output<O>(layout: &OutputLayout, out: &[O]) -> Result<()> {
+    if out.len() < layout.len() {
+        log::error!("Output buffer of {} for {layout:?}", out.len());
+        return Err(Error::BufferTooSmall);
+    }
+    Ok(())
+}
+
+/// Linearize the raw values of `src` into `out`, a single component
+/// `layout`.
+pub(crate) fn linearize<T: Sample, O: OutputSample>(
+    linearizer: &Linearizer<T>,
+    src: &[u16],
+    layout: &OutputLayout,
+    out: &mut [O],
+) -> Result<()> {
+    let width = layout.width;
+    if layout.channels != 1 || layout.planes != 1 || src.len() < width * layout.height {
+        log::error!("Invalid layout {layout:?} for {} values", src.len());
+        return Err(Error::InvalidParam);
+    }
+    check_output(layout, out)?;
+    layout
+        .bands(out, 1)
+        .into_par_iter()
+        .zip(src.par_chunks(std::cmp::max(1, width)))
+        .enumerate()
+        .for_each_init(Vec::new, |linear, (y, (mut out_row, row))| {
+            linear.resize(row.len(), T::zero());
+            linearizer.apply_row(row, y, linear);
+            encode_row(linear, &mut out_row[0][..width]);
+        });
+
+    Ok(())
+}
+
+/// Render pipeline for a 2x2 bayer CFA.
+pub(crate) struct BayerPipeline<T> {
+    pub linearizer: Linearizer<T>,
+    /// The bayer pattern index. See `demosaic::bayer_index()`
+    pub npattern: usize,
+    /// Camera to output colour matrix, with the white balance. `None`
+    /// to leave as is.
+    pub colour: Option<[[T; 3]; 3]>,
+    /// The gamma to encode with. `None` for linear.
+    pub gamma: Option<&'static GammaLut>,
+}
+
+impl<T: Sample> BayerPipeline<T> {
+    /// Render `src`, a CFA `width` x `height`, into `out` laid out as
+    /// `layout`. The RGB output is `width - 2` x `height - 2` like
+    /// `demosaic::bimedian()`.
+    pub(crate) fn render<O: OutputSample>(
+        &self,
+        src: &[u16],
+        width: usize,
+        height: usize,
+        layout: &OutputLayout,
+        out: &mut [O],
+    ) -> Result<()> {
+        if width < 3 || height < 3 || src.len() < width * height {
+            log::error!("Invalid image {width}x{height} for {} values", src.len());
+            return Err(Error::InvalidFormat);
+        }
+        let out_w = width - 2;
+        let out_h = height - 2;
+        if (layout.width, layout.height) != (out_w, out_h) {
+            log::error!("Invalid layout {layout:?} for {width}x{height}");
+            return Err(Error::InvalidParam);
+        }
+        check_output(layout, out)?;
+        // One linear value and an RGB value per pixel.
+        let rows = band_rows(width, 4 * std::mem::size_of::<T>());
+
+        layout
+            .bands(out, rows)
+            .into_par_iter()
+            .enumerate()
+            .for_each_init(
+                || (Vec::new(), Vec::new()),
+                |(linear, rgb), (band, mut out_band)| {
+                    let y = band * rows;
+                    let n = std::cmp::min(rows, out_h - y);
+                    // The demosaic needs a row above and below.
+                    linear.resize((n + 2) * width, T::zero());
+                    src[y * width..(y + n + 2) * width]
+                        .chunks_exact(width)
+                        .zip(linear.chunks_exact_mut(width))
+                        .enumerate()
+                        .for_each(|(row, (s, l))| self.linearizer.apply_row(s, y + row, l));
+                    rgb.resize(n * out_w * 3, T::zero());
+                    bimedian_rows(linear, width, y + 1, self.npattern, rgb);
+                    self.finish(rgb, layout, &mut out_band);
+                },
+            );
+
+        Ok(())
+    }
+
+    /// Render `src`, a CFA `width` x `height`, downscaled by
+    /// `divisor`, a multiple of 2, without demosaic, into `out` laid
+    /// out as `layout`. Each 2x2 quad is an RGB pixel, and these are
+    /// averaged over `divisor` x `divisor` raw pixels. Incomplete
+    /// blocks on the right and bottom edges are dropped: the output is
+    /// `width / divisor` x `height / divisor`.
+    pub(crate) fn render_scaled<O: OutputSample>(
+        &self,
+        src: &[u16],
+        width: usize,
+        height: usize,
+        divisor: usize,
+        layout: &OutputLayout,
+        out: &mut [O],
+    ) -> Result<()> {
+        if divisor < 2 || divisor % 2 != 0 {
+            log::error!("Invalid scale divisor {divisor}");
+            return Err(Error::InvalidParam);
+        }
+        let out_w = width / divisor;
+        let out_h = height / divisor;
+        if out_w == 0 || out_h == 0 || src.len() < width * height {
+            log::error!("Invalid image {width}x{height} for {} values", src.len());
+            return Err(Error::InvalidFormat);
+        }
+        if (layout.width, layout.height) != (out_w, out_h) {
+            log::error!("Invalid layout {layout:?} for {width}x{height} / {divisor}");
+            return Err(Error::InvalidParam);
+        }
+        check_output(layout, out)?;
+        let colours = QUAD_COLOURS[self.npattern];
+        // The number of raw values of each colour in a block.
+        let quads = (divisor / 2) * (divisor / 2);
+        let mut counts = [0; 3];
+        colours.iter().for_each(|c| counts[*c] += quads);
+        let scale: [T; 3] = std::array::from_fn(|c| T::from_f64(1.0 / counts[c] as f64));
+
+        layout
+            .bands(out, 1)
+            .into_par_iter()
+            .enumerate()
+            .for_each_init(Vec::new, |rgb, (y, mut out_row)| {
+                rgb.clear();
+                rgb.resize(out_w * 3, T::zero());
+                for sy in y * divisor..(y + 1) * divisor {
+                    let c0 = colours[(sy % 2) * 2];
+                    let c1 = colours[(sy % 2) * 2 + 1];
+                    // The blocks start on an even column.
+                    let lut0 = self.linearizer.lut(0, sy);
+                    let lut1 = self.linearizer.lut(1, sy);
+                    let row = &src[sy * width..sy * width + out_w * divisor];
+                    for (pixel, block) in rgb.chunks_exact_mut(3).zip(row.chunks_exact(divisor)) {
+                        for pair in block.chunks_exact(2) {
+                            pixel[c0] = pixel[c0] + lut0[pair[0] as usize];
+                            pixel[c1] = pixel[c1] + lut1[pair[1] as usize];
+                        }
+                    }
+                }
+                rgb.chunks_exact_mut(3).for_each(|pixel| {
+                    pixel
+                        .iter_mut()
+                        .zip(scale.iter())
+                        .for_each(|(v, s)| *v = *v * *s)
+                });
+                self.finish(rgb, layout, &mut out_row);
+            });
+
+        Ok(())
+    }
+
+    /// Colour correct, gamma correct and encode the `rgb` samples
+    /// into the `out` band of `layout`. See `OutputLayout::bands()`.
+    fn finish<O: OutputSample>(&self, rgb: &mut [T], layout: &OutputLayout, out: &mut [&mut [O]]) {
+        if let Some(m) = &self.colour {
+            colour_transform(m, rgb);
+        }
+        encode_rgb(rgb, self.gamma, layout, out);
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::{band_rows, linearize, BayerPipeline};
+    use crate::render::{
+        Linearizer, OutputLayout, OutputSample, RenderingFormat, Sample, SRGB_GAMMA,
+    };
+    use crate::Result;
+
+    /// Render `src` with `pipeline` into a new packed buffer.
+    fn render<T: Sample, O: OutputSample>(
+        pipeline: &BayerPipeline<T>,
+        src: &[u16],
+        width: usize,
+        height: usize,
+        format: RenderingFormat,
+    ) -> Result<Vec<O>> {
+        let layout = OutputLayout::new(width.saturating_sub(2), height.saturating_sub(2), format);
+        let mut out = vec![O::default(); layout.len()];
+        pipeline.render(src, width, height, &layout, &mut out)?;
+        Ok(out)
+    }
+
+    /// Render `src` scaled with `pipeline` into a new packed buffer.
+    fn render_scaled<T: Sample, O: OutputSample>(
+        pipeline: &BayerPipeline<T>,
+        src: &[u16],
+        width: usize,
+        height: usize,
+        divisor: usize,
+        format: RenderingFormat,
+    ) -> Result<(Vec<O>, usize, usize)> {
+        let d = std::cmp::max(1, divisor);
+        let layout = OutputLayout::new(width / d, height / d, format);
+        let mut out = vec![O::default(); layout.len()];
+        pipeline.render_scaled(src, width, height, divisor, &layout, &mut out)?;
+        Ok((out, width / d, height / d))
+    }
+
+    fn linearize_u16<T: Sample>(linearizer: &Linearizer<T>, src: &[u16], width: usize) -> Vec<u16> {
+        let layout = OutputLayout::cfa(width, src.len() / width);
+        let mut out = vec![0; src.len()];
+        linearize(linearizer, src, &layout, &mut out).expect("Linearize failed");
+        out
+    }
+
+    /// A 12 bits test CFA, `width` x `height`.
+    fn test_cfa(width: usize, height: usize) -> Vec<u16> {
+        (0..width * height)
+            .map(|v| (v * 7919 % 4096) as u16)
+            .collect()
+    }
+
+    #[test]
+    fn test_band_rows() {
+        assert_eq!(band_rows(8000, 16), 4);
+        assert_eq!(band_rows(1024, 16), 16);
+    }
+
+    #[test]
+    fn test_pipeline_bands() {
+        // Tall enough to have several bands.
+        let width = 1000;
+        let height = 80;
+        let src = test_cfa(width, height);
+        let pipeline = BayerPipeline {
+            linearizer: Linearizer::<f32>::new([0; 4], [4095; 4], None),
+            npattern: 3,
+            colour: None,
+            gamma: None,
+        };
+        let out = render::<_, u16>(&pipeline, &src, width, height, RenderingFormat::Rgb16)
+            .expect("Render failed");
+        assert_eq!(out.len(), (width - 2) * (height - 2) * 3);
+
+        // Render as a single band.
+        let linear: Vec<f32> = src
+            .iter()
+            .enumerate()
+            .map(|(i, v)| pipeline.linearizer.apply(*v, i % width, i / width))
+            .collect();
+        let mut rgb = vec![0.0; out.len()];
+        crate::render::demosaic::bimedian_rows(&linear, width, 1, 3, &mut rgb);
+        let mut expected = vec![0; out.len()];
+        let layout = OutputLayout::new(width - 2, height - 2, RenderingFormat::Rgb16);
+        pipeline.finish(&mut rgb, &layout, &mut [&mut expected[..]]);
+        assert_eq!(out, expected);
+
+        assert!(
+            render::<_, u16>(&pipeline, &src, width, height + 1, RenderingFormat::Rgb16).is_err()
+        );
+        assert!(render::<_, u16>(&pipeline, &src, 2, 2, RenderingFormat::Rgb16).is_err());
+
+        let linearizer = Linearizer::<f64>::new([64; 4], [4095; 4], None);
+        assert_eq!(
+            linearize_u16(&linearizer, &[0, 64, 4095], 3),
+            vec![0, 0, 65535]
+        );
+        // Per CFA position levels.
+        let linearizer = Linearizer::<f64>::new([64, 32, 16, 0], [4159, 4127, 4111, 4095], None);
+        assert_eq!(
+            linearize_u16(&linearizer, &[64, 32, 64, 4111, 4095, 4111], 3),
+            vec![0, 0, 0, 65535, 65535, 65535]
+        );
+    }
+
+    #[test]
+    fn test_pipeline_scaled() {
+        let width = 36;
+        let height = 20;
+        // GRBG, with a different value for each colour.
+        let src: Vec<u16> = (0..width * height)
+            .map(|i| match (i % width % 2, i / width % 2) {
+                (1, 0) => 4000,
+                (0, 1) => 1000,
+                _ => 2000 + (i % 3) as u16,
+            })
+            .collect();
+        let pipeline = BayerPipeline {
+            linearizer: Linearizer::<f64>::new([0; 4], [4000; 4], None),
+            npattern: 1,
+            colour: None,
+            gamma: None,
+        };
+
+        let (out, w, h) =
+            render_scaled::<_, u16>(&pipeline, &src, width, height, 2, RenderingFormat::Rgb16)
+                .expect("Render failed");
+        assert_eq!((w, h), (18, 10));
+        assert_eq!(out.len(), w * h * 3);
+        assert_eq!(out[0], 65535);
+        assert_eq!(out[2], 16384);
+        // The two greens are averaged.
+        let green = (src[0] + src[width + 1]) as f64 / 2.0 / 4000.0;
+        assert_eq!(out[1], (green * 65535.0).round() as u16);
+
+        let (out, w, h) =
+            render_scaled::<_, u16>(&pipeline, &src, width, height, 8, RenderingFormat::Rgb16)
+                .expect("Render failed");
+        // The incomplete blocks are dropped.
+        assert_eq!((w, h), (4, 2));
+        assert_eq!(out.len(), w * h * 3);
+        assert!(out.chunks_exact(3).all(|p| p[0] == 65535 && p[2] == 16384));
+
+        assert!(
+            render_scaled::<_, u16>(&pipeline, &src, width, height, 3, RenderingFormat::Rgb16)
+                .is_err()
+        );
+        assert!(
+            render_scaled::<_, u16>(&pipeline, &src, width, height, 0, RenderingFormat::Rgb16)
+                .is_err()
+        );
+        assert!(render_scaled::<_, u16>(&pipeline, &src, 4, 4, 8, RenderingFormat::Rgb16).is_err());
+    }
+
+    #[test]
+    fn test_pipeline_formats() {
+        // Several bands, and a last one shorter.
+        let width = 1000;
+        let height = 83;
+        let src = test_cfa(width, height);
+        let pipeline = BayerPipeline {
+            linearizer: Linearizer::<f32>::new([0; 4], [4095; 4], None),
+            npattern: 0,
+            colour: None,
+            gamma: Some(&*SRGB_GAMMA),
+        };
+        let rgb16 = render::<_, u16>(&pipeline, &src, width, height, RenderingFormat::Rgb16)
+            .expect("Render failed");
+        let pixels = rgb16.len() / 3;
+
+        let rgba8 = render::<_, u8>(&pipeline, &src, width, height, RenderingFormat::Rgba8)
+            .expect("Render failed");
+        assert_eq!(rgba8.len(), pixels * 4);
+        for (p16, p8) in rgb16.chunks_exact(3).zip(rgba8.chunks_exact(4)) {
+            for (v16, v8) in p16.iter().zip(p8.iter()) {
+                assert!((*v16 as f64 / 257.0 - *v8 as f64).abs() <= 1.0);
+            }
+            assert_eq!(p8[3], 255);
+        }
+        let rgb8 = render::<_, u8>(&pipeline, &src, width, height, RenderingFormat::Rgb8)
+            .expect("Render failed");
+        assert!(rgb8
+            .chunks_exact(3)
+            .zip(rgba8.chunks_exact(4))
+            .all(|(p, pa)| p == &pa[..3]));
+
+        let planar = render::<_, f32>(&pipeline, &src, width, height, RenderingFormat::PlanarF32)
+            .expect("Render failed");
+        assert_eq!(planar.len(), pixels * 3);
+        for (i, pixel) in rgb16.chunks_exact(3).enumerate() {
+            for (c, v) in pixel.iter().enumerate() {
+                let f = planar[c * pixels + i];
+                assert!((f * 65535.0 - *v as f32).abs() <= 1.0, "{i} {c}");
+            }
+        }
+
+        let (planar, w, h) = render_scaled::<_, f32>(
+            &pipeline,
+            &src,
+            width,
+            height,
+            4,
+            RenderingFormat::PlanarF32,
+        )
+        .expect("Render failed");
+        let (rgb16, _, _) =
+            render_scaled::<_, u16>(&pipeline, &src, width, height, 4, RenderingFormat::Rgb16)
+                .expect("Render failed");
+        for (i, pixel) in rgb16.chunks_exact(3).enumerate() {
+            for (c, v) in pixel.iter().enumerate() {
+                let f = planar[c * w * h + i];
+                assert!((f * 65535.0 - *v as f32).abs() <= 1.0, "{i} {c}");
+            }
+        }
+    }
+
+    #[test]
+    fn test_pipeline_stride() {
+        let width = 300;
+        let height = 40;
+        let src = test_cfa(width, height);
+        let pipeline = BayerPipeline {
+            linearizer: Linearizer::<f32>::new([0; 4], [4095; 4], None),
+            npattern: 2,
+            colour: None,
+            gamma: Some(&*SRGB_GAMMA),
+        };
+        for format in [RenderingFormat::Rgba8, RenderingFormat::PlanarF32] {
+            let packed = OutputLayout::new(width - 2, height - 2, format);
+            let expected = render::<_, f32>(&pipeline, &src, width, height, format).unwrap();
+
+            let layout = OutputLayout {
+                stride: packed.stride + 13,
+                ..packed
+            };
+            // The padding after the last row isn't needed.
+            let mut out = vec![-1.0_f32; layout.len()];
+            assert!(out.len() < layout.stride * layout.height * layout.planes);
+            pipeline
+                .render(&src, width, height, &layout, &mut out)
+                .expect("Render failed");
+            let mut copy = vec![0.0; packed.len()];
+            packed
+                .copy_rect(&mut copy, &layout, &out, 0, 0)
+                .expect("Copy failed");
+            assert_eq!(copy, expected, "{format:?}");
+            // The padding is left as is.
+            assert_eq!(out[packed.row_len()..layout.stride], [-1.0; 13]);
+
+            assert!(matches!(
+                pipeline.render(&src, width, height, &layout, &mut out[1..]),
+                Err(crate::Error::BufferTooSmall)
+            ));
+        }
+    }
+}
@@ -0,0 +1,243 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * libopenraw - rows.rs
+ *
+ * Copyright (C) 2025 Hubert Figuière
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+//! Decoding of the raw data in bands of rows. The sequential decoders
+//! output the rows into a band buffer that is reused, so that the
+//! whole image is never held in memory.
+
+use crate::{Bitmap, Error, RawImage, Result};
+
+/// A band of decoded rows. See `RawFile::decode_rows()`.
+pub struct RowBand<'a> {
+    /// The first row of the band in the image.
+    pub y: u32,
+    /// The number of rows.
+    pub height: u32,
+    /// The number of samples in a row.
+    pub row_len: usize,
+    /// The samples, `height` rows of `row_len`.
+    pub data: &'a [u16],
+}
+
+/// Where the decoders output the rows, a band at a time. The band is
+/// passed to the callback when full, and then reused.
+pub struct RowSink<'a> {
+    callback: &'a mut dyn FnMut(&RowBand) -> Result<()>,
+    /// The number of rows in a band.
+    band_rows: usize,
+    /// The number of samples in a row. 0 until `start()`.
+    row_len: usize,
+    buffer: Vec<u16>,
+    /// The first row of the current band.
+    y: usize,
+    /// The number of rows written in the current band.
+    filled: usize,
+    /// Whether the decoder output the rows.
+    started: bool,
+}
+
+impl<'a> RowSink<'a> {
+    /// Create the sink to call `callback` with bands of `band_rows`
+    /// rows.
+    pub(crate) fn new(
+        band_rows: usize,
+        callback: &'a mut dyn FnMut(&RowBand) -> Result<()>,
+    ) -> RowSink<'a> {
+        RowSink {
+            callback,
+            band_rows: std::cmp::max(band_rows, 1),
+            row_len: 0,
+            buffer: vec![],
+            y: 0,
+            filled: 0,
+            started: false,
+        }
+    }
+
+    /// Start the output of rows of `row_len` samples. The decoder must
+    /// call it before writing any row.
+    pub(crate) fn start(&mut self, row_len: usize) {
+        self.row_len = row_len;
+        self.buffer = uninit_vec!(row_len * self.band_rows);
+        self.y = 0;
+        self.filled = 0;
+        self.started = true;
+    }
+
+    /// The number of rows left in the current band. Never 0.
+    pub(crate) fn rows_left(&self) -> usize {
+        self.band_rows - self.filled
+    }
+
+    /// The buffer for the next rows of the band, `rows_left()` rows.
+    /// Call `advance()` once they are written.
+    pub(crate) fn rows_mut(&mut self) -> &mut [u16] {
+        &mut self.buffer[self.filled * self.row_len..]
+    }
+
+    /// Advance by `rows` rows written with `rows_mut()`. The band is
+    /// output when full.
+    pub(crate) fn advance(&mut self, rows: usize) -> Result<()> {
+        self.filled = std::cmp::min(self.filled + rows, self.band_rows);
+        if self.filled == self.band_rows {
+            self.flush()?;
+        }
+
+        Ok(())
+    }
+
+    /// Output the rows of the current band.
+    fn flush(&mut self) -> Result<()> {
+        if self.filled == 0 {
+            return Ok(());
+        }
+        let height = self.filled;
+        let band = RowBand {
+            y: self.y as u32,
+            height: height as u32,
+            row_len: self.row_len,
+            data: &self.buffer[..height * self.row_len],
+        };
+        self.y += height;
+        self.filled = 0;
+
+        (self.callback)(&band)
+    }
+
+    /// Finish the decoding of `rawdata`: output the last band, or the
+    /// whole data in bands if the decoder didn't output the rows.
+    /// Return `rawdata` without the data, for the metadata.
+    pub(crate) fn finish(&mut self, rawdata: RawImage) -> Result<RawImage> {
+        if self.started {
+            self.flush()?;
+        } else {
+            let data = rawdata.data16().ok_or_else(|| {
+                log::error!("No raw data to output, {:?}", rawdata.data_type());
+                Error::InvalidFormat
+            })?;
+            let height = rawdata.height() as usize;
+            let row_len = data.len().checked_div(height).unwrap_or(0);
+            if row_len != 0 {
+                for (i, band) in data[..row_len * height]
+                    .chunks(row_len * self.band_rows)
+                    .enumerate()
+                {
+                    (self.callback)(&RowBand {
+                        y: (i * self.band_rows) as u32,
+                        height: (band.len() / row_len) as u32,
+                        row_len,
+                        data: band,
+                    })?;
+                }
+            }
+        }
+        self.buffer = vec![];
+
+        Ok(rawdata.replace_data(vec![]))
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::{RowBand, RowSink};
+    use crate::mosaic::Pattern;
+    use crate::{Bitmap, DataType, Error, RawImage, Result};
+
+    type Band = (u32, u32, usize, Vec<u16>);
+
+    /// Run `f` with a sink of `band_rows` rows, and return the bands
+    /// output.
+    fn collect_bands<F>(band_rows: usize, f: F) -> Vec<Band>
+    where
+        F: FnOnce(&mut RowSink) -> Result<()>,
+    {
+        let mut bands = vec![];
+        let mut callback = |band: &RowBand| {
+            bands.push((band.y, band.height, band.row_len, band.data.to_vec()));
+            Ok(())
+        };
+        let mut sink = RowSink::new(band_rows, &mut callback);
+        f(&mut sink).expect("Output failed");
+        drop(sink);
+
+        bands
+    }
+
+    #[test]
+    fn test_row_sink() {
+        let data: Vec<u16> = (0..7 * 10).map(|v| v as u16).collect();
+        let new_image =
+            |data: Vec<u16>| RawImage::with_data16(7, 10, 12, DataType::Raw, data, Pattern::Rggb);
+
+        // Rows output by the decoder, two at a time.
+        let bands = collect_bands(3, |sink| {
+            sink.start(7);
+            for mut rows in data.chunks(7 * 2) {
+                while !rows.is_empty() {
+                    let n = std::cmp::min(sink.rows_left(), rows.len() / 7);
+                    sink.rows_mut()[..n * 7].copy_from_slice(&rows[..n * 7]);
+                    sink.advance(n)?;
+                    rows = &rows[n * 7..];
+                }
+            }
+            let rawdata = sink.finish(new_image(vec![]))?;
+            assert_eq!(rawdata.width(), 7);
+            Ok(())
+        });
+        assert_eq!(
+            bands.iter().map(|b| (b.0, b.1, b.2)).collect::<Vec<_>>(),
+            [(0, 3, 7), (3, 3, 7), (6, 3, 7), (9, 1, 7)]
+        );
+        assert_eq!(bands.concat_data(), data);
+
+        // The whole decoded data, in bands.
+        let bands = collect_bands(4, |sink| {
+            let rawdata = sink.finish(new_image(data.clone()))?;
+            assert_eq!(rawdata.data16().map(|d| d.len()), Some(0));
+            Ok(())
+        });
+        assert_eq!(
+            bands.iter().map(|b| (b.0, b.1)).collect::<Vec<_>>(),
+            [(0, 4), (4, 4), (8, 2)]
+        );
+        assert_eq!(bands.concat_data(), data);
+
+        // The callback stops the decoding.
+        let mut callback = |band: &RowBand| {
+            if band.y > 0 {
+                return Err(Error::Unknown);
+            }
+            Ok(())
+        };
+        let mut sink = RowSink::new(4, &mut callback);
+        assert!(matches!(sink.finish(new_image(data)), Err(Error::Unknown)));
+    }
+
+    trait ConcatData {
+        fn concat_data(&self) -> Vec<u16>;
+    }
+
+    impl ConcatData for Vec<Band> {
+        fn concat_data(&self) -> Vec<u16> {
+            self.iter().flat_map(|b| b.3.iter().copied()).collect()
+        }
+    }
+}
@@ -0,0 +1,110 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * libopenraw - session.rs
+ *
+ * Copyright (C) 2025 Hubert Figuière
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+//! Decode session for batch decoding.
+//!
+//! A `DecodeSession` runs the decoding on its own thread pool: it sets
+//! the number of threads used to decode, and keeps the decoding apart
+//! from the global rayon pool of the application.
+
+use std::path::Path;
+
+use crate::{rawfile_from_file, rawfile_from_memory, Error, RawFile, RawImage, Result, Type};
+
+/// A decode session, with its own decoding threads. Keep it around to
+/// decode many files.
+pub struct DecodeSession {
+    pool: rayon::ThreadPool,
+}
+
+impl DecodeSession {
+    /// Create a new decode session with `num_threads` worker threads.
+    /// If `num_threads` is 0, the default from rayon is used.
+    pub fn new(num_threads: usize) -> Result<DecodeSession> {
+        let pool = rayon::ThreadPoolBuilder::new()
+            .num_threads(num_threads)
+            .thread_name(|idx| format!("or-decode-{idx}"))
+            .build()
+            .map_err(|err| {
+                log::error!("Couldn't create the decode thread pool: {err}");
+                Error::Other(err.to_string())
+            })?;
+
+        Ok(DecodeSession { pool })
+    }
+
+    /// The number of worker threads.
+    pub fn num_threads(&self) -> usize {
+        self.pool.current_num_threads()
+    }
+
+    /// Run `f` in the session. Any parallel decoding `f` does will use
+    /// the session worker threads.
+    pub fn install<F, R>(&self, f: F) -> R
+    where
+        F: FnOnce() -> R + Send,
+        R: Send,
+    {
+        self.pool.install(f)
+    }
+
+    /// Load the raw data from the file at `path`. See `RawFile::raw_data()`.
+    pub fn raw_data_from_file<P>(
+        &self,
+        path: P,
+        type_hint: Option<Type>,
+        skip_decompression: bool,
+    ) -> Result<RawImage>
+    where
+        P: AsRef<Path> + Send,
+    {
+        self.install(|| rawfile_from_file(path, type_hint)?.raw_data(skip_decompression))
+    }
+
+    /// Load the raw data from a file in memory. See `RawFile::raw_data()`.
+    pub fn raw_data_from_memory(
+        &self,
+        mem: Vec<u8>,
+        type_hint: Option<Type>,
+        skip_decompression: bool,
+    ) -> Result<RawImage> {
+        self.install(|| rawfile_from_memory(mem, type_hint)?.raw_data(skip_decompression))
+    }
+}
+
+#[cfg(test)]
+mod test {
+    use super::DecodeSession;
+
+    #[test]
+    fn test_session() {
+        let session = DecodeSession::new(2).expect("Couldn't create session");
+        assert_eq!(session.num_threads(), 2);
+        assert_eq!(session.install(|| rayon::current_num_threads()), 2);
+
+        assert!(session
+            .raw_data_from_file("test/does-not-exist.dng", None, false)
+            .is_err());
+        assert!(session
+            .raw_data_from_memory(vec![0; 16], None, false)
+            .is_err());
+    }
+}
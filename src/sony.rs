@@ -21,16 +21,16 @@
 
 //! Sony specific code.
 
-use std::collections::HashMap;
 use std::rc::Rc;
 
 use byteorder::LittleEndian;
 use once_cell::unsync::OnceCell;
 
 use crate::camera_ids::{self, hasselblad, vendor};
-use crate::colour::BuiltinMatrix;
+use crate::colour::{self, BuiltinMatrix};
 use crate::container::{Endian, RawContainer};
 use crate::io::Viewer;
+use crate::lookup::ModelIdMap;
 use crate::minolta::MrwContainer;
 use crate::rawfile::{RawFileHandleType, ThumbnailStorage};
 use crate::tiff::exif::{self, ExifValue};
@@ -61,218 +61,217 @@ macro_rules! sony {
 
 pub use tiff::exif::generated::MNOTE_SONY_TAG_NAMES as MNOTE_TAG_NAMES;
 
-lazy_static::lazy_static! {
-    static ref SONY_MODEL_ID_MAP: HashMap<u32, TypeId> = HashMap::from([
-        /* source: https://exiftool.org/TagNames/Sony.html */
-        /* SR2 */
-        sony!(2, R1),
-        /* ARW */
-        sony!(256, A100),
-        sony!(257, A900),
-        sony!(258, A700),
-        sony!(259, A200),
-        sony!(260, A350),
-        sony!(261, A300),
-        // 262 DSLR-A900 (APS-C mode)
-        sony!(263, A380),
-        sony!(263, A390),
-        sony!(264, A330),
-        sony!(265, A230),
-        sony!(266, A290),
-        sony!(269, A850),
-        // 270 DSLR-A850 (APS-C mode)
-        sony!(273, A550),
-        sony!(274, A500),
-        sony!(275, A450),
-        sony!(278, NEX5),
-        sony!(279, NEX3),
-        sony!(280, SLTA33),
-        sony!(281, SLTA55),
-        sony!(282, A560),
-        sony!(283, A580),
-        sony!(284, NEXC3),
-        sony!(285, SLTA35),
-        sony!(286, SLTA65),
-        sony!(287, SLTA77),
-        sony!(288, NEX5N),
-        sony!(289, NEX7),
-        // 290 NEX-VG20E
-        sony!(291, SLTA37),
-        sony!(292, SLTA57),
-        sony!(293, NEXF3),
-        sony!(294, SLTA99),
-        sony!(295, NEX6),
-        sony!(296, NEX5R),
-        sony!(297, RX100),
-        sony!(298, RX1),
-        // 299 NEX-VG900
-        // 300 NEX-VG30E
-        sony!(302, ILCE3000),
-        sony!(303, SLTA58),
-        sony!(305, NEX3N),
-        sony!(306, ILCE7),
-        sony!(307, NEX5T),
-        sony!(308, RX100M2),
-        sony!(309, RX10),
-        sony!(310, RX1R),
-        sony!(311, ILCE7R),
-        sony!(312, ILCE6000),
-        sony!(313, ILCE5000),
-        sony!(317, RX100M3),
-        sony!(318, ILCE7S),
-        sony!(319, ILCA77M2),
-        sony!(339, ILCE5100),
-        sony!(340, ILCE7M2),
-        sony!(341, RX100M4),
-        sony!(342, RX10M2),
-        sony!(344, RX1RM2),
-        sony!(346, ILCEQX1),
-        sony!(347, ILCE7RM2),
-        sony!(350, ILCE7SM2),
-        sony!(353, ILCA68),
-        sony!(354, ILCA99M2),
-        sony!(355, RX10M3),
-        sony!(356, RX100M5),
-        sony!(357, ILCE6300),
-        sony!(358, ILCE9),
-        sony!(360, ILCE6500),
-        sony!(362, ILCE7RM3),
-        sony!(363, ILCE7M3),
-        sony!(364, RX0),
-        sony!(365, RX10M4),
-        sony!(366, RX100M6),
-        sony!(367, HX99),
-        sony!(369, RX100M5A),
-        sony!(371, ILCE6400),
-        sony!(372, RX0M2),
-        sony!(373, HX95),
-        sony!(374, RX100M7),
-        sony!(375, ILCE7RM4),
-        sony!(376, ILCE9M2),
-        sony!(378, ILCE6600),
-        sony!(379, ILCE6100),
-        sony!(380, ZV1),
-        sony!(381, ILCE7C),
-        sony!(382, ZVE10),
-        sony!(383, ILCE7SM3),
-        sony!(384, ILCE1),
-        sony!(385, ILME_FX3),
-        sony!(386, ILCE7RM3A),
-        sony!(387, ILCE7RM4A),
-        sony!(388, ILCE7M4),
-        sony!(390, ILCE7RM5),
-        sony!(391, ILME_FX30),
-        sony!(392, ILCE9M3),
-        sony!(393, ZVE1),
-        sony!(394, ILCE6700),
-        sony!(395, ZV1M2),
-        sony!(399, ZVE10M2),
-        sony!(400, ILCE1M2),
-    ]);
+static SONY_MODEL_ID_MAP: ModelIdMap<96> = ModelIdMap::new([
+    /* source: https://exiftool.org/TagNames/Sony.html */
+    /* SR2 */
+    sony!(2, R1),
+    /* ARW */
+    sony!(256, A100),
+    sony!(257, A900),
+    sony!(258, A700),
+    sony!(259, A200),
+    sony!(260, A350),
+    sony!(261, A300),
+    // 262 DSLR-A900 (APS-C mode)
+    sony!(263, A380),
+    sony!(264, A330),
+    sony!(265, A230),
+    sony!(266, A290),
+    sony!(269, A850),
+    // 270 DSLR-A850 (APS-C mode)
+    sony!(273, A550),
+    sony!(274, A500),
+    sony!(275, A450),
+    sony!(278, NEX5),
+    sony!(279, NEX3),
+    sony!(280, SLTA33),
+    sony!(281, SLTA55),
+    sony!(282, A560),
+    sony!(283, A580),
+    sony!(284, NEXC3),
+    sony!(285, SLTA35),
+    sony!(286, SLTA65),
+    sony!(287, SLTA77),
+    sony!(288, NEX5N),
+    sony!(289, NEX7),
+    // 290 NEX-VG20E
+    sony!(291, SLTA37),
+    sony!(292, SLTA57),
+    sony!(293, NEXF3),
+    sony!(294, SLTA99),
+    sony!(295, NEX6),
+    sony!(296, NEX5R),
+    sony!(297, RX100),
+    sony!(298, RX1),
+    // 299 NEX-VG900
+    // 300 NEX-VG30E
+    sony!(302, ILCE3000),
+    sony!(303, SLTA58),
+    sony!(305, NEX3N),
+    sony!(306, ILCE7),
+    sony!(307, NEX5T),
+    sony!(308, RX100M2),
+    sony!(309, RX10),
+    sony!(310, RX1R),
+    sony!(311, ILCE7R),
+    sony!(312, ILCE6000),
+    sony!(313, ILCE5000),
+    sony!(317, RX100M3),
+    sony!(318, ILCE7S),
+    sony!(319, ILCA77M2),
+    sony!(339, ILCE5100),
+    sony!(340, ILCE7M2),
+    sony!(341, RX100M4),
+    sony!(342, RX10M2),
+    sony!(344, RX1RM2),
+    sony!(346, ILCEQX1),
+    sony!(347, ILCE7RM2),
+    sony!(350, ILCE7SM2),
+    sony!(353, ILCA68),
+    sony!(354, ILCA99M2),
+    sony!(355, RX10M3),
+    sony!(356, RX100M5),
+    sony!(357, ILCE6300),
+    sony!(358, ILCE9),
+    sony!(360, ILCE6500),
+    sony!(362, ILCE7RM3),
+    sony!(363, ILCE7M3),
+    sony!(364, RX0),
+    sony!(365, RX10M4),
+    sony!(366, RX100M6),
+    sony!(367, HX99),
+    sony!(369, RX100M5A),
+    sony!(371, ILCE6400),
+    sony!(372, RX0M2),
+    sony!(373, HX95),
+    sony!(374, RX100M7),
+    sony!(375, ILCE7RM4),
+    sony!(376, ILCE9M2),
+    sony!(378, ILCE6600),
+    sony!(379, ILCE6100),
+    sony!(380, ZV1),
+    sony!(381, ILCE7C),
+    sony!(382, ZVE10),
+    sony!(383, ILCE7SM3),
+    sony!(384, ILCE1),
+    sony!(385, ILME_FX3),
+    sony!(386, ILCE7RM3A),
+    sony!(387, ILCE7RM4A),
+    sony!(388, ILCE7M4),
+    sony!(390, ILCE7RM5),
+    sony!(391, ILME_FX30),
+    sony!(392, ILCE9M3),
+    sony!(393, ZVE1),
+    sony!(394, ILCE6700),
+    sony!(395, ZV1M2),
+    sony!(399, ZVE10M2),
+    sony!(400, ILCE1M2),
+]);
 
-    static ref MAKE_TO_ID_MAP: tiff::MakeToIdMap = HashMap::from([
-        sony!("DSLR-A100", A100),
-        sony!("DSLR-A200", A200),
-        sony!("DSLR-A230", A230),
-        sony!("DSLR-A290", A290),
-        sony!("DSLR-A300", A300),
-        sony!("DSLR-A330", A330),
-        sony!("DSLR-A350", A350),
-        sony!("DSLR-A380", A380),
-        sony!("DSLR-A390", A390),
-        sony!("DSLR-A450", A450),
-        sony!("DSLR-A500", A500),
-        sony!("DSLR-A550", A550),
-        sony!("DSLR-A560", A560),
-        sony!("DSLR-A580", A580),
-        sony!("DSLR-A700", A700),
-        sony!("DSLR-A850", A850),
-        sony!("DSLR-A900", A900),
-        sony!("SLT-A33", SLTA33),
-        sony!("SLT-A35", SLTA35),
-        sony!("SLT-A37", SLTA37),
-        sony!("SLT-A55V", SLTA55),
-        sony!("SLT-A57", SLTA57),
-        sony!("SLT-A58", SLTA58),
-        sony!("SLT-A65V", SLTA65),
-        sony!("SLT-A77V", SLTA77),
-        sony!("SLT-A99V", SLTA99),
-        sony!("NEX-3", NEX3),
-        sony!("NEX-3N", NEX3N),
-        sony!("NEX-5", NEX5),
-        sony!("NEX-5N", NEX5N),
-        sony!("NEX-5R", NEX5R),
-        sony!("NEX-5T", NEX5T),
-        sony!("NEX-C3", NEXC3),
-        sony!("NEX-F3", NEXF3),
-        sony!("NEX-6", NEX6),
-        sony!("NEX-7", NEX7),
-        sony!("DSC-HX95", HX95),
-        sony!("DSC-HX99", HX99),
-        sony!("DSC-R1", R1),
-        sony!("DSC-RX10", RX10),
-        sony!("DSC-RX10M2", RX10M2),
-        sony!("DSC-RX10M3", RX10M3),
-        sony!("DSC-RX10M4", RX10M4),
-        sony!("DSC-RX100", RX100),
-        sony!("DSC-RX100M2", RX100M2),
-        sony!("DSC-RX100M3", RX100M3),
-        sony!("DSC-RX100M4", RX100M4),
-        sony!("DSC-RX100M5", RX100M5),
-        sony!("DSC-RX100M5A", RX100M5A),
-        sony!("DSC-RX100M6", RX100M6),
-        sony!("DSC-RX100M7", RX100M7),
-        sony!("DSC-RX0", RX0),
-        sony!("DSC-RX0M2", RX0M2),
-        sony!("DSC-RX1", RX1),
-        sony!("DSC-RX1R", RX1R),
-        sony!("DSC-RX1RM2", RX1RM2),
-        sony!("ILCA-68", ILCA68),
-        sony!("ILCA-77M2", ILCA77M2),
-        sony!("ILCA-99M2", ILCA99M2),
-        sony!("ILCE-1", ILCE1),
-        sony!("ILCE-1M2", ILCE1M2),
-        sony!("ILCE-3000", ILCE3000),
-        sony!("ILCE-3500", ILCE3500),
-        sony!("ILCE-5000", ILCE5000),
-        sony!("ILCE-5100", ILCE5100),
-        sony!("ILCE-6000", ILCE6000),
-        sony!("ILCE-6100", ILCE6100),
-        sony!("ILCE-6300", ILCE6300),
-        sony!("ILCE-6400", ILCE6400),
-        sony!("ILCE-6500", ILCE6500),
-        sony!("ILCE-6600", ILCE6600),
-        sony!("ILCE-6700", ILCE6700),
-        sony!("ILCE-7", ILCE7),
-        sony!("ILCE-7C", ILCE7C),
-        sony!("ILCE-7M2", ILCE7M2),
-        sony!("ILCE-7M3", ILCE7M3),
-        sony!("ILCE-7M4", ILCE7M4),
-        sony!("ILCE-7R", ILCE7R),
-        sony!("ILCE-7RM2", ILCE7RM2),
-        sony!("ILCE-7RM3", ILCE7RM3),
-        sony!("ILCE-7RM3A", ILCE7RM3A),
-        sony!("ILCE-7RM4", ILCE7RM4),
-        sony!("ILCE-7RM4A", ILCE7RM4A),
-        sony!("ILCE-7RM5", ILCE7RM5),
-        sony!("ILCE-7S", ILCE7S),
-        sony!("ILCE-7SM2", ILCE7SM2),
-        sony!("ILCE-7SM3", ILCE7SM3),
-        sony!("ILCE-9", ILCE9),
-        sony!("ILCE-9M2", ILCE9M2),
-        sony!("ILCE-9M3", ILCE9M3),
-        sony!("ILME-FX3", ILME_FX3),
-        sony!("ILME-FX30", ILME_FX30),
-        sony!("ZV-1", ZV1),
-        sony!("ZV-1M2", ZV1M2),
-        sony!("ZV-E1", ZVE1),
-        sony!("ZV-E10", ZVE10),
-        sony!("ZV-E10M2", ZVE10M2),
-        sony!("UMC-R10C", UMCR10C),
-        ("Lunar", TypeId(vendor::HASSELBLAD, hasselblad::LUNAR)),
-    ]);
+static MAKE_TO_ID_MAP: tiff::MakeToIdMap<99> = tiff::MakeToIdMap::new([
+    sony!("DSLR-A100", A100),
+    sony!("DSLR-A200", A200),
+    sony!("DSLR-A230", A230),
+    sony!("DSLR-A290", A290),
+    sony!("DSLR-A300", A300),
+    sony!("DSLR-A330", A330),
+    sony!("DSLR-A350", A350),
+    sony!("DSLR-A380", A380),
+    sony!("DSLR-A390", A390),
+    sony!("DSLR-A450", A450),
+    sony!("DSLR-A500", A500),
+    sony!("DSLR-A550", A550),
+    sony!("DSLR-A560", A560),
+    sony!("DSLR-A580", A580),
+    sony!("DSLR-A700", A700),
+    sony!("DSLR-A850", A850),
+    sony!("DSLR-A900", A900),
+    sony!("SLT-A33", SLTA33),
+    sony!("SLT-A35", SLTA35),
+    sony!("SLT-A37", SLTA37),
+    sony!("SLT-A55V", SLTA55),
+    sony!("SLT-A57", SLTA57),
+    sony!("SLT-A58", SLTA58),
+    sony!("SLT-A65V", SLTA65),
+    sony!("SLT-A77V", SLTA77),
+    sony!("SLT-A99V", SLTA99),
+    sony!("NEX-3", NEX3),
+    sony!("NEX-3N", NEX3N),
+    sony!("NEX-5", NEX5),
+    sony!("NEX-5N", NEX5N),
+    sony!("NEX-5R", NEX5R),
+    sony!("NEX-5T", NEX5T),
+    sony!("NEX-C3", NEXC3),
+    sony!("NEX-F3", NEXF3),
+    sony!("NEX-6", NEX6),
+    sony!("NEX-7", NEX7),
+    sony!("DSC-HX95", HX95),
+    sony!("DSC-HX99", HX99),
+    sony!("DSC-R1", R1),
+    sony!("DSC-RX10", RX10),
+    sony!("DSC-RX10M2", RX10M2),
+    sony!("DSC-RX10M3", RX10M3),
+    sony!("DSC-RX10M4", RX10M4),
+    sony!("DSC-RX100", RX100),
+    sony!("DSC-RX100M2", RX100M2),
+    sony!("DSC-RX100M3", RX100M3),
+    sony!("DSC-RX100M4", RX100M4),
+    sony!("DSC-RX100M5", RX100M5),
+    sony!("DSC-RX100M5A", RX100M5A),
+    sony!("DSC-RX100M6", RX100M6),
+    sony!("DSC-RX100M7", RX100M7),
+    sony!("DSC-RX0", RX0),
+    sony!("DSC-RX0M2", RX0M2),
+    sony!("DSC-RX1", RX1),
+    sony!("DSC-RX1R", RX1R),
+    sony!("DSC-RX1RM2", RX1RM2),
+    sony!("ILCA-68", ILCA68),
+    sony!("ILCA-77M2", ILCA77M2),
+    sony!("ILCA-99M2", ILCA99M2),
+    sony!("ILCE-1", ILCE1),
+    sony!("ILCE-1M2", ILCE1M2),
+    sony!("ILCE-3000", ILCE3000),
+    sony!("ILCE-3500", ILCE3500),
+    sony!("ILCE-5000", ILCE5000),
+    sony!("ILCE-5100", ILCE5100),
+    sony!("ILCE-6000", ILCE6000),
+    sony!("ILCE-6100", ILCE6100),
+    sony!("ILCE-6300", ILCE6300),
+    sony!("ILCE-6400", ILCE6400),
+    sony!("ILCE-6500", ILCE6500),
+    sony!("ILCE-6600", ILCE6600),
+    sony!("ILCE-6700", ILCE6700),
+    sony!("ILCE-7", ILCE7),
+    sony!("ILCE-7C", ILCE7C),
+    sony!("ILCE-7M2", ILCE7M2),
+    sony!("ILCE-7M3", ILCE7M3),
+    sony!("ILCE-7M4", ILCE7M4),
+    sony!("ILCE-7R", ILCE7R),
+    sony!("ILCE-7RM2", ILCE7RM2),
+    sony!("ILCE-7RM3", ILCE7RM3),
+    sony!("ILCE-7RM3A", ILCE7RM3A),
+    sony!("ILCE-7RM4", ILCE7RM4),
+    sony!("ILCE-7RM4A", ILCE7RM4A),
+    sony!("ILCE-7RM5", ILCE7RM5),
+    sony!("ILCE-7S", ILCE7S),
+    sony!("ILCE-7SM2", ILCE7SM2),
+    sony!("ILCE-7SM3", ILCE7SM3),
+    sony!("ILCE-9", ILCE9),
+    sony!("ILCE-9M2", ILCE9M2),
+    sony!("ILCE-9M3", ILCE9M3),
+    sony!("ILME-FX3", ILME_FX3),
+    sony!("ILME-FX30", ILME_FX30),
+    sony!("ZV-1", ZV1),
+    sony!("ZV-1M2", ZV1M2),
+    sony!("ZV-E1", ZVE1),
+    sony!("ZV-E10", ZVE10),
+    sony!("ZV-E10M2", ZVE10M2),
+    sony!("UMC-R10C", UMCR10C),
+    ("Lunar", TypeId(vendor::HASSELBLAD, hasselblad::LUNAR)),
+]);
 
-    static ref MATRICES: [BuiltinMatrix; 97] = [
+#[rustfmt::skip]
+static MATRICES: [BuiltinMatrix; 97] = colour::sorted_matrices([
         BuiltinMatrix::new(
             sony!(A100),
             0,
@@ -762,8 +761,7 @@ lazy_static::lazy_static! {
             128,
             0,
             [ 5491, -1192, -363, -4951, 12342, 2948, -911, 1722, 7192 ] ),
-    ];
-}
+    ]);
 
 #[derive(Default)]
 struct ArwFixup {
@@ -1037,13 +1035,15 @@ impl ArwFile {
                 }
                 // XXX This here and Pentax get the levels from the builtins.
                 // Make this in a common area.
-                let levels = MATRICES
-                    .iter()
-                    .find(|m| m.camera == type_id)
-                    .map(|m| (m.black, m.white));
+                let levels =
+                    colour::find_builtin_matrix(&MATRICES, type_id).map(|m| (m.black, m.white));
 
                 if let Some(blacks) = dir.uint_value_array(exif::ARW_TAG_BLACK_LEVELS) {
-                    rawimage.set_blacks(utils::to_quad(&blacks));
+                    // In R, G1, G2, B order.
+                    let blacks = rawimage
+                        .mosaic_pattern()
+                        .levels_from_rggb(utils::to_quad(&blacks));
+                    rawimage.set_blacks(blacks);
                 } else if let Some((black, _)) = levels {
                     rawimage.set_blacks([black; 4]);
                 }
@@ -1170,7 +1170,7 @@ impl RawFileImpl for ArwFile {
     }
 
     fn get_builtin_colour_matrix(&self) -> Result<Vec<f64>> {
-        self.builtin_colour_matrix(&*MATRICES)
+        self.builtin_colour_matrix(&MATRICES)
     }
 }
 
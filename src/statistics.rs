@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: LGPL-3.0-or-later
+/*
+ * libopenraw - statistics.rs
+ *
+ * Copyright (C) 2025 Hubert Figuière
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+//! Statistics of the raw data: histogram, min, max, mean and clipping
+//! per CFA channel.
+
+use rayon::prelude::*;
+
+use crate::mosaic::{Pattern, PatternColour};
+use crate::{Error, Result};
+
+#[derive(Clone, Debug, PartialEq)]
+/// The statistics of a channel of the raw data. The values are as
+/// stored, before linearization.
+pub struct ChannelStatistics {
+    /// The count of each value. Values past the end are counted in the
+    /// last bin.
+    pub histogram: Vec<u32>,
+    /// The minimum value. `u16::MAX` if `count` is 0.
+    pub min: u16,
+    /// The maximum value.
+    pub max: u16,
+    /// The sum of the values.
+    pub sum: u64,
+    /// The number of values.
+    pub count: u64,
+    /// The number of values at or above the white level.
+    pub clipped: u64,
+    /// The number of values below the black level.
+    pub below_black: u64,
+}
+
+impl ChannelStatistics {
+    fn new(bins: usize) -> ChannelStatistics {
+        ChannelStatistics {
+            histogram: vec![0; bins],
+            min: u16::MAX,
+            max: 0,
+            sum: 0,
+            count: 0,
+            clipped: 0,
+            below_black: 0,
+        }
+    }
+
+    /// The mean value. 0 if there is none.
+    pub fn mean(&self) -> f64 {
+        if self.count == 0 {
+            return 0.0;
+        }
+        self.sum as f64 / self.count as f64
+    }
+
+    #[inline]
+    fn add(&mut self, value: u16, black: u16, white: u16) {
+        let last = self.histogram.len() - 1;
+        self.histogram[std::cmp::min(value as usize, last)] += 1;
+        self.min = std::cmp::min(self.min, value);
+        self.max = std::cmp::max(self.max, value);
+        self.sum += value as u64;
+        self.count += 1;
+        self.clipped += (value >= white) as u64;
+        self.below_black += (value < black) as u64;
+    }
+
+    fn merge(mut self, other: ChannelStatistics) -> ChannelStatistics {
+        self.histogram
+            .iter_mut()
+            .zip(other.histogram.iter())
+            .for_each(|(a, b)| *a += b);
+        self.min = std::cmp::min(self.min, other.min);
+        self.max = std::cmp::max(self.max, other.max);
+        self.sum += other.sum;
+        self.count += other.count;
+        self.clipped += other.clipped;
+        self.below_black += other.below_black;
+
+        self
+    }
+}
+
+#[derive(Clone, Debug, PartialEq)]
+/// The statistics of the raw data. See `RawImage::statistics()`.
+pub struct Statistics {
+    channels: Vec<ChannelStatistics>,
+}
+
+impl Statistics {
+    /// The statistics per channel. For a 2x2 bayer CFA it is per
+    /// position, in row order, like the levels. For other CFA it is
+    /// per colour R, G and B. Otherwise there is a single channel, or
+    /// one per plane.
+    pub fn channels(&self) -> &[ChannelStatistics] {
+        &self.channels
+    }
+
+    pub(crate) fn from_channels(channels: Vec<ChannelStatistics>) -> Statistics {
+        Statistics { channels }
+    }
+}
+
+/// The channel of each position of `pattern`, in row order, the
+/// pattern width and height, and the number of channels.
+fn channel_map(pattern: &Pattern) -> Result<(Vec<usize>, usize, usize, usize)> {
+    match pattern {
+        Pattern::Empty => Ok((vec![0], 1, 1, 1)),
+        Pattern::NonRgb22(_) => {
+            let map = pattern
+                .pattern()
+                .iter()
+                .map(|colour| match colour {
+                    PatternColour::Unknown => {
+                        log::error!("Unknown colour in pattern {pattern:?}");
+                        Err(Error::InvalidFormat)
+                    }
+                    c => Ok(*c as usize),
+                })
+                .collect::<Result<Vec<_>>>()?;
+            if map.is_empty() || map.len() != pattern.width() * pattern.height() {
+                log::error!("Invalid pattern {pattern:?}");
+                return Err(Error::InvalidFormat);
+            }
+            Ok((map, pattern.width(), pattern.height(), 3))
+        }
+        _ => Ok((vec![0, 1, 2, 3], 2, 2, 4)),
+    }
+}
+
+/// Compute the statistics of `data`, `height` rows of `row_len`
+/// samples, with the CFA `pattern`. `blacks` and `whites` are per
+/// position of the 2x2 CFA, in row order. The histograms have
+/// `2^bpc` bins.
+pub(crate) fn channel_statistics(
+    data: &[u16],
+    row_len: usize,
+    height: usize,
+    pattern: &Pattern,
+    blacks: &[u16; 4],
+    whites: &[u16; 4],
+    bpc: u16,
+) -> Result<Vec<ChannelStatistics>> {
+    if row_len == 0 || data.len() < row_len * height {
+        log::error!("Invalid data size {} for {row_len}x{height}", data.len());
+        return Err(Error::InvalidParam);
+    }
+    let (map, pw, ph, n) = channel_map(pattern)?;
+    let bins = 1_usize << std::cmp::min(std::cmp::max(bpc, 1), 16);
+    // The channel and levels repeat every `cycle` samples of a row,
+    // and every `row_cycle` rows: 2 for a 2x2 CFA.
+    let cycle = if pw % 2 == 0 { pw } else { pw * 2 };
+    let row_cycle = if ph % 2 == 0 { ph } else { ph * 2 };
+    let row_levels: Vec<Vec<(usize, u16, u16)>> = (0..row_cycle)
+        .map(|y| {
+            (0..cycle)
+                .map(|x| {
+                    let pos = (y % 2) * 2 + x % 2;
+                    (map[(y % ph) * pw + x % pw], blacks[pos], whites[pos])
+                })
+                .collect()
+        })
+        .collect();
+    let empty = || vec![ChannelStatistics::new(bins); n];
+
+    let channels = data[..row_len * height]
+        .par_chunks(row_len)
+        .enumerate()
+        .fold(empty, |mut channels, (y, row)| {
+            let levels = &row_levels[y % row_cycle];
+            for chunk in row.chunks(cycle) {
+                for (value, (c, black, white)) in chunk.iter().zip(levels.iter()) {
+                    channels[*c].add(*value, *black, *white);
+                }
+            }
+            channels
+        })
+        .reduce(empty, |a, b| {
+            a.into_iter().zip(b).map(|(a, b)| a.merge(b)).collect()
+        });
+
+    Ok(channels)
+}
+
+#[cfg(test)]
+mod test {
+    use super::channel_statistics;
+    use crate::mosaic::{Pattern, PatternColour::*};
+
+    #[test]
+    fn test_channel_statistics() {
+        // RGGB, 4x2.
+        let data = [
+            10, 100, 20, 4095, //
+            200, 5, 300, 15,
+        ];
+        let channels = channel_statistics(
+            &data,
+            4,
+            2,
+            &Pattern::Rggb,
+            &[8, 8, 8, 8],
+            &[4095, 4000, 4000, 4000],
+            12,
+        )
+        .expect("Statistics failed");
+        assert_eq!(channels.len(), 4);
+        assert_eq!(channels[0].histogram.len(), 4096);
+        assert_eq!((channels[0].min, channels[0].max), (10, 20));
+        assert_eq!(channels[0].mean(), 15.0);
+        assert_eq!(channels[0].histogram[10], 1);
+        assert_eq!(channels[1].count, 2);
+        assert_eq!(channels[1].clipped, 1);
+        assert_eq!(channels[1].histogram[4095], 1);
+        assert_eq!((channels[2].min, channels[2].max), (200, 300));
+        assert_eq!(channels[3].below_black, 1);
+        assert_eq!(channels[3].sum, 20);
+
+        // Values past the histogram end in the last bin.
+        let channels = channel_statistics(&data, 8, 1, &Pattern::Empty, &[0; 4], &[255; 4], 8)
+            .expect("Statistics failed");
+        assert_eq!(channels.len(), 1);
+        assert_eq!(channels[0].count, 8);
+        assert_eq!(channels[0].clipped, 2);
+        assert_eq!(channels[0].histogram[255], 2);
+
+        // Per colour for other CFA.
+        let pattern = Pattern::NonRgb22(vec![
+            Green, Green, Red, Green, Green, Blue, //
+            Green, Green, Blue, Green, Green, Red, //
+            Blue, Red, Green, Red, Blue, Green, //
+            Green, Green, Blue, Green, Green, Red, //
+            Green, Green, Red, Green, Green, Blue, //
+            Red, Blue, Green, Blue, Red, Green,
+        ]);
+        let data = vec![1_u16; 12 * 12];
+        let channels =
+            channel_statistics(&data, 12, 12, &pattern, &[0; 4], &[4095; 4], 12).unwrap();
+        assert_eq!(channels.len(), 3);
+        assert_eq!(channels[0].count, 32);
+        assert_eq!(channels[1].count, 80);
+        assert_eq!(channels[2].count, 32);
+
+        assert!(channel_statistics(&data, 12, 13, &pattern, &[0; 4], &[4095; 4], 12).is_err());
+    }
+}
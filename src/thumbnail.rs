@@ -38,12 +38,14 @@ pub struct DataOffset {
 pub enum Data {
     Offset(DataOffset),
     Bytes(Vec<u8>),
+    /// JPEG XL compressed pixmap, decoded when loaded.
+    Jxl(DataOffset),
 }
 
 impl Data {
     pub fn len(&self) -> usize {
         match *self {
-            Self::Offset(ref offset) => offset.len as usize,
+            Self::Offset(ref offset) | Self::Jxl(ref offset) => offset.len as usize,
             Self::Bytes(ref v) => v.len(),
         }
     }
@@ -66,7 +68,7 @@ pub struct ThumbDesc {
 impl ThumbDesc {
     pub fn data_size(&self) -> u64 {
         match self.data {
-            Data::Offset(ref offset) => offset.len,
+            Data::Offset(ref offset) | Data::Jxl(ref offset) => offset.len,
             Data::Bytes(ref v) => v.len() as u64,
         }
     }
@@ -28,6 +28,7 @@ pub mod exif;
 mod iterator;
 
 use std::convert::TryFrom;
+use std::io::{Seek, SeekFrom};
 
 use byteorder::{BigEndian, LittleEndian};
 use num_enum::FromPrimitive;
@@ -37,6 +38,7 @@ use crate::decompress;
 use crate::io;
 use crate::jpeg;
 use crate::mosaic::Pattern;
+use crate::rows::RowSink;
 use crate::thumbnail;
 use crate::{DataType, Error, RawImage, Result, Type, TypeId};
 pub(crate) use container::{Container, DirIterator, LoaderFixup};
@@ -145,10 +147,14 @@ pub trait Ifd {
     }
 }
 
-pub(crate) type MakeToIdMap = std::collections::HashMap<&'static str, TypeId>;
+/// Map of the camera model, as found in the Exif data, to `TypeId`.
+pub(crate) type MakeToIdMap<const N: usize> = crate::lookup::TypeIdMap<&'static str, N>;
 
 /// Identify a files using the Exif data
-pub(crate) fn identify_with_exif(container: &Container, map: &MakeToIdMap) -> Option<TypeId> {
+pub(crate) fn identify_with_exif<const N: usize>(
+    container: &Container,
+    map: &MakeToIdMap<N>,
+) -> Option<TypeId> {
     container.directory(0).and_then(|dir| {
         dir.entry(exif::EXIF_TAG_MODEL)
             // Files like Black Magic's DNG don't have a Model.
@@ -207,12 +213,66 @@ pub(crate) fn tiff_get_rawdata(
     tiff_get_rawdata_with_endian(container, dir, file_type, container.endian())
 }
 
+/// Get the raw data. The uncompressed and packed samples are output
+/// to `rows` if there is one, and the data is left empty. See
+/// `RowSink`.
+pub(crate) fn tiff_get_rawdata_rows(
+    container: &Container,
+    dir: &Dir,
+    file_type: Type,
+    rows: Option<&mut RowSink>,
+) -> Result<RawImage> {
+    tiff_rawdata(container, dir, file_type, container.endian(), rows)
+}
+
 /// Get the raw data with a specific endian for the data.
 pub(crate) fn tiff_get_rawdata_with_endian(
     container: &Container,
     dir: &Dir,
     file_type: Type,
     endian: Endian,
+) -> Result<RawImage> {
+    tiff_rawdata(container, dir, file_type, endian, None)
+}
+
+/// Read the 16 bits samples at `offset`, `byte_len` bytes of `height`
+/// rows following `endian`, into `rows`, a band at a time.
+fn read_rows16(
+    container: &Container,
+    offset: u64,
+    byte_len: usize,
+    height: usize,
+    endian: Endian,
+    rows: &mut RowSink,
+) -> Result<()> {
+    let row_len = (byte_len / 2).checked_div(height).unwrap_or(0);
+    rows.start(row_len);
+    if row_len == 0 {
+        return Ok(());
+    }
+    let mut y = 0;
+    while y < height {
+        let n = std::cmp::min(rows.rows_left(), height - y);
+        {
+            // The view isn't borrowed while the band is output.
+            let mut view = container.borrow_view_mut();
+            view.seek(SeekFrom::Start(offset + (y * row_len * 2) as u64))?;
+            view.read_endian_u16_array(&mut rows.rows_mut()[..n * row_len], endian)?;
+        }
+        rows.advance(n)?;
+        y += n;
+    }
+
+    Ok(())
+}
+
+/// Get the raw data, see `tiff_get_rawdata_rows()`.
+fn tiff_rawdata(
+    container: &Container,
+    dir: &Dir,
+    file_type: Type,
+    endian: Endian,
+    rows: Option<&mut RowSink>,
 ) -> Result<RawImage> {
     let mut offset = 0_u32;
 
@@ -385,7 +445,22 @@ pub(crate) fn tiff_get_rawdata_with_endian(
             )
         }
     } else if bpc == 16 {
-        let data = if endian == Endian::Big {
+        let data = if let Some(rows) = rows {
+            let endian = if endian == Endian::Big {
+                Endian::Big
+            } else {
+                Endian::Little
+            };
+            read_rows16(
+                container,
+                offset as u64,
+                byte_len as usize,
+                y as usize,
+                endian,
+                rows,
+            )?;
+            vec![]
+        } else if endian == Endian::Big {
             container.load_buffer16_be(offset as u64, byte_len as u64)
         } else {
             container.load_buffer16_le(offset as u64, byte_len as u64)
@@ -399,15 +474,29 @@ pub(crate) fn tiff_get_rawdata_with_endian(
             mosaic_pattern.unwrap_or_default(),
         )
     } else if bpc == 10 || bpc == 12 || bpc == 14 {
-        let data = decompress::unpack(
-            container,
-            x,
-            y,
-            bpc,
-            compression,
-            offset as u64,
-            byte_len as usize,
-        )?;
+        let data = if let Some(rows) = rows {
+            decompress::unpack_to(
+                container,
+                x,
+                y,
+                bpc,
+                compression,
+                offset as u64,
+                byte_len as usize,
+                rows,
+            )?;
+            vec![]
+        } else {
+            decompress::unpack(
+                container,
+                x,
+                y,
+                bpc,
+                compression,
+                offset as u64,
+                byte_len as usize,
+            )?
+        };
         RawImage::with_data16(
             x,
             y,
@@ -491,6 +580,7 @@ pub(crate) fn ifd_locate_thumbnail(
             .unwrap_or(0);
         let mut offset = 0;
         let mut got_it = false;
+        let mut is_jxl = false;
         if let Some(v) = dir.value::<u32>(exif::EXIF_TAG_STRIP_OFFSETS) {
             offset = v;
             got_it = true;
@@ -537,6 +627,14 @@ pub(crate) fn ifd_locate_thumbnail(
                     }
                 }
             }
+        } else if compression == Compression::JepgXl as u16 {
+            // DNG 1.7 JPEG XL preview.
+            if cfg!(feature = "jxl") {
+                data_type = DataType::PixmapRgb8;
+                is_jxl = true;
+            } else {
+                log::debug!("JPEG XL preview ignored.");
+            }
         } else if photom_int == exif::PhotometricInterpretation::YCbCr as u16 {
             log::warn!("Unsupported YCbCr photometric interpretation in non JPEG.");
         } else {
@@ -571,14 +669,19 @@ pub(crate) fn ifd_locate_thumbnail(
             if dim > 0 {
                 // XXX compute
                 // offset += offset();
+                let data_offset = thumbnail::DataOffset {
+                    offset: offset as u64,
+                    len: byte_count as u64,
+                };
                 let desc = thumbnail::ThumbDesc {
                     width: x,
                     height: y,
                     data_type,
-                    data: thumbnail::Data::Offset(thumbnail::DataOffset {
-                        offset: offset as u64,
-                        len: byte_count as u64,
-                    }),
+                    data: if is_jxl {
+                        thumbnail::Data::Jxl(data_offset)
+                    } else {
+                        thumbnail::Data::Offset(data_offset)
+                    },
                 };
                 thumbnails.push((dim, desc));
             }